@@ -0,0 +1,98 @@
+"""
+Generate src/cqsdk/utils/gb18030_tables.h from the GB18030 converter of the C library's iconv,
+which is what the transcoder is checked against.
+
+Usage: python3 scripts/generate_gb18030_tables.py
+"""
+
+import ctypes
+import ctypes.util
+import os
+
+OUTPUT = os.path.join(os.path.dirname(__file__), '..', 'src', 'cqsdk', 'utils', 'gb18030_tables.h')
+
+libc = ctypes.CDLL(ctypes.util.find_library('c'))
+libc.iconv_open.restype = ctypes.c_void_p
+libc.iconv_open.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
+libc.iconv.restype = ctypes.c_size_t
+libc.iconv.argtypes = [ctypes.c_void_p,
+                       ctypes.POINTER(ctypes.c_char_p), ctypes.POINTER(ctypes.c_size_t),
+                       ctypes.POINTER(ctypes.c_char_p), ctypes.POINTER(ctypes.c_size_t)]
+
+cd = libc.iconv_open(b'UTF-32LE', b'GB18030')
+
+
+def decode(seq):
+    """Decode a GB18030 sequence to a single code point, or None if it's not mapped."""
+    libc.iconv(cd, None, None, None, None)
+    in_buf = ctypes.create_string_buffer(seq, len(seq))
+    out_buf = ctypes.create_string_buffer(16)
+    in_ptr = ctypes.c_char_p(ctypes.addressof(in_buf))
+    out_ptr = ctypes.c_char_p(ctypes.addressof(out_buf))
+    in_left = ctypes.c_size_t(len(seq))
+    out_left = ctypes.c_size_t(16)
+    ret = libc.iconv(cd, ctypes.byref(in_ptr), ctypes.byref(in_left), ctypes.byref(out_ptr), ctypes.byref(out_left))
+    if ret == ctypes.c_size_t(-1).value or in_left.value or 16 - out_left.value != 4:
+        return None
+    return int.from_bytes(out_buf.raw[:4], 'little')
+
+
+TRAILS = list(range(0x40, 0x7f)) + list(range(0x80, 0xff))
+two_byte = []
+supplementary = []
+for lead in range(0x81, 0xff):
+    for trail in TRAILS:
+        cp = decode(bytes([lead, trail]))
+        assert cp is not None, 'two-byte code %02X%02X not mapped' % (lead, trail)
+        if cp > 0xffff:
+            supplementary.append((lead << 8 | trail, cp))
+            cp = 0
+        two_byte.append(cp)
+
+FOUR_BYTE_BMP_COUNT = 39420  # 0x81308130 to 0x8439FE39
+ranges = []  # [linear index, code point, count]
+for index in range(FOUR_BYTE_BMP_COUNT):
+    seq = bytes([0x81 + index // 12600, 0x30 + index // 1260 % 10, 0x81 + index // 10 % 126, 0x30 + index % 10])
+    cp = decode(seq)
+    if cp is None:
+        continue
+    if ranges and ranges[-1][0] + ranges[-1][2] == index and ranges[-1][1] + ranges[-1][2] == cp:
+        ranges[-1][2] += 1
+    else:
+        ranges.append([index, cp, 1])
+
+
+def hex_lines(values, per_line, fmt):
+    for i in range(0, len(values), per_line):
+        yield '        ' + ' '.join(fmt % v + ',' for v in values[i:i + per_line]) + '\n'
+
+
+with open(OUTPUT, 'w', newline='\n') as f:
+    f.write('// generated by scripts/generate_gb18030_tables.py, do not edit\n\n')
+    f.write('#pragma once\n\n')
+    f.write('#include <cstdint>\n\n')
+    f.write('namespace cq::utils::gb18030::tables {\n')
+    f.write('    // code points of two-byte sequences, indexed by (lead - 0x81) * 190 + trail index,\n')
+    f.write('    // where the trail index skips 0x7F, 0 for those beyond the BMP, see TWO_BYTE_SUPPLEMENTARY\n')
+    f.write('    static constexpr uint16_t TWO_BYTE[%d] = {\n' % len(two_byte))
+    f.writelines(hex_lines(two_byte, 12, '0x%04X'))
+    f.write('    };\n\n')
+    f.write('    struct TwoByteSupplementary {\n')
+    f.write('        uint16_t code;\n')
+    f.write('        uint32_t code_point;\n')
+    f.write('    };\n\n')
+    f.write('    static constexpr TwoByteSupplementary TWO_BYTE_SUPPLEMENTARY[%d] = {\n' % len(supplementary))
+    for code, cp in supplementary:
+        f.write('        {0x%04X, 0x%05X},\n' % (code, cp))
+    f.write('    };\n\n')
+    f.write('    struct FourByteRange {\n')
+    f.write('        uint16_t index; // linear index of the four-byte sequence, from 0x81308130\n')
+    f.write('        uint16_t code_point;\n')
+    f.write('        uint16_t count;\n')
+    f.write('    };\n\n')
+    f.write('    // four-byte sequences of the BMP, sorted by index\n')
+    f.write('    static constexpr FourByteRange FOUR_BYTE_RANGES[%d] = {\n' % len(ranges))
+    for index, cp, count in ranges:
+        f.write('        {%d, 0x%04X, %d},\n' % (index, cp, count))
+    f.write('    };\n')
+    f.write('} // namespace cq::utils::gb18030::tables\n')
@@ -6,6 +6,7 @@
 #include <set>
 
 #include "cqhttp/core/core.h"
+#include "cqhttp/core/info_cache.h"
 #include "cqhttp/utils/filesystem.h"
 #include "cqhttp/utils/jsonex.h"
 #include "cqhttp/utils/string.h"
@@ -320,7 +321,7 @@ namespace cqhttp {
         const auto no_cache = params.get_bool("no_cache", false);
         if (user_id) {
             CALL_API_BEGIN
-            result.data = api::get_stranger_info(user_id, no_cache);
+            result.data = info_cache::get_stranger_info(user_id, no_cache);
             CALL_API_END
         }
     }
@@ -342,16 +343,17 @@ namespace cqhttp {
         const auto no_cache = params.get_bool("no_cache", false);
         if (group_id) {
             CALL_API_BEGIN
-            result.data = api::get_group_info(group_id, no_cache);
+            result.data = info_cache::get_group_info(group_id, no_cache);
             CALL_API_END
         }
     }
 
     HANDLER(get_group_member_list) {
         const auto group_id = params.get_integer("group_id", 0);
+        const auto no_cache = params.get_bool("no_cache", false);
         if (group_id) {
             CALL_API_BEGIN
-            result.data = api::get_group_member_list(group_id);
+            result.data = info_cache::get_group_member_list(group_id, no_cache);
             CALL_API_END
         }
     }
@@ -362,7 +364,7 @@ namespace cqhttp {
         const auto no_cache = params.get_bool("no_cache", false);
         if (group_id && user_id) {
             CALL_API_BEGIN
-            result.data = api::get_group_member_info(group_id, user_id, no_cache);
+            result.data = info_cache::get_group_member_info(group_id, user_id, no_cache);
             CALL_API_END
         }
     }
@@ -441,6 +443,7 @@ namespace cqhttp {
             {"plugins_good", app.plugins_good()},
             {"app_good", app.good()},
             {"online", nullptr},
+            {"info_cache", info_cache::stats()},
         };
 
         auto online_status_detection_method =
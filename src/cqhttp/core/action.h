@@ -13,6 +13,7 @@ namespace cqhttp {
             static const int OPERATION_FAILED = 103; // insufficient user privilege or filesystem error
             static const int CREDENTIAL_INVALID = 104; // the cookies and/or csrf token are expired or invalid
             static const int BAD_THREAD_POOL = 201; // thread pool not correctly created
+            static const int QUEUE_FULL = 202; // too many tasks waiting in a queue
 
             // retcodes that represent HTTP status codes
             // these should not be set mannually in action handlers
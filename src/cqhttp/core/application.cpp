@@ -1,5 +1,7 @@
 #include "./application.h"
 
+#include "cqhttp/core/event_ingestion.h"
+
 using namespace std;
 
 namespace cqhttp {
@@ -7,7 +9,7 @@ namespace cqhttp {
 
     void Application::on_initialize() {
         initialized_ = true;
-        iterate_hooks(&Plugin::hook_initialize, Context());
+        iterate_hooks<Hook::initialize>(Context());
     }
 
     void Application::on_enable() {
@@ -17,13 +19,20 @@ namespace cqhttp {
         config_ = utils::JsonEx();
         store_ = utils::JsonEx();
 
-        worker_thread_pool_ = make_shared<ctpl::thread_pool>(1);
+        worker_thread_pool_ = make_shared<Executor>(1);
         logging::debug(TAG, u8"全局线程池创建成功");
 
         scheduler_ = make_shared<Bosma::Scheduler>(4);
         logging::debug(TAG, u8"计划任务调度器创建成功");
 
-        iterate_hooks(&Plugin::hook_enable, Context());
+        iterate_hooks<Hook::enable>(Context());
+
+        // the config has been loaded by the config loaders' enable hooks
+        event_ingestion::Options ingestion_options;
+        ingestion_options.queue_size = max(config_.get_integer("event_queue_size", 1024), static_cast<int64_t>(0));
+        ingestion_options.block_timeout = chrono::milliseconds(config_.get_integer("event_block_timeout", 5000));
+        event_ingestion::configure(ingestion_options);
+
         emit_lifecycle_meta_event(MetaEvent::LIFECYCLE_ENABLE);
     }
 
@@ -44,10 +53,10 @@ namespace cqhttp {
             logging::debug(TAG, u8"计划任务调度器关闭成功");
         }
 
-        iterate_hooks(&Plugin::hook_disable, Context());
+        iterate_hooks<Hook::disable>(Context());
     }
 
-    void Application::on_coolq_start() { iterate_hooks(&Plugin::hook_coolq_start, Context()); }
+    void Application::on_coolq_start() { iterate_hooks<Hook::coolq_start>(Context()); }
 
     void Application::on_coolq_exit() {
         if (enabled_) {
@@ -55,6 +64,6 @@ namespace cqhttp {
             // this leads to a lifecycle change, check plugin.h for the lifecycle graph
             on_disable();
         }
-        iterate_hooks(&Plugin::hook_coolq_exit, Context());
+        iterate_hooks<Hook::coolq_exit>(Context());
     }
 } // namespace cqhttp
@@ -2,11 +2,13 @@
 
 #include "cqhttp/core/common.h"
 
+#include <array>
+
 #include "cqhttp/core/action.h"
 #include "cqhttp/core/context.h"
 #include "cqhttp/core/event.h"
+#include "cqhttp/core/executor.h"
 #include "cqhttp/core/plugin.h"
-#include "cqhttp/core/vendor/ctpl/ctpl_stl.h"
 #include "cqhttp/core/vendor/scheduler/Scheduler.h"
 
 namespace cqhttp {
@@ -18,40 +20,50 @@ namespace cqhttp {
         void on_coolq_start();
         void on_coolq_exit();
 
-        void on_before_event(const cq::Event &event, json &data) {
-            iterate_hooks(&Plugin::hook_before_event, EventContext<cq::Event>(event, data));
+        void on_before_event(const cq::Event &event, EventPayload &payload) {
+            iterate_hooks<Hook::before_event>(EventContext<cq::Event>(event, payload));
         }
 
-        void on_message_event(const cq::MessageEvent &event, json &data) {
-            iterate_hooks(&Plugin::hook_message_event, EventContext<cq::MessageEvent>(event, data));
+        void on_message_event(const cq::MessageEvent &event, EventPayload &payload) {
+            if (!payload.dropped()) {
+                iterate_hooks<Hook::message_event>(EventContext<cq::MessageEvent>(event, payload));
+            }
         }
 
-        void on_notice_event(const cq::NoticeEvent &event, json &data) {
-            iterate_hooks(&Plugin::hook_notice_event, EventContext<cq::NoticeEvent>(event, data));
+        void on_notice_event(const cq::NoticeEvent &event, EventPayload &payload) {
+            if (!payload.dropped()) {
+                iterate_hooks<Hook::notice_event>(EventContext<cq::NoticeEvent>(event, payload));
+            }
         }
 
-        void on_request_event(const cq::RequestEvent &event, json &data) {
-            iterate_hooks(&Plugin::hook_request_event, EventContext<cq::RequestEvent>(event, data));
+        void on_request_event(const cq::RequestEvent &event, EventPayload &payload) {
+            if (!payload.dropped()) {
+                iterate_hooks<Hook::request_event>(EventContext<cq::RequestEvent>(event, payload));
+            }
         }
 
-        void on_meta_event(const cqhttp::MetaEvent &event, json &data) {
-            iterate_hooks(&Plugin::hook_meta_event, EventContext<cqhttp::MetaEvent>(event, data));
+        void on_meta_event(const cqhttp::MetaEvent &event, EventPayload &payload) {
+            if (!payload.dropped()) {
+                iterate_hooks<Hook::meta_event>(EventContext<cqhttp::MetaEvent>(event, payload));
+            }
         }
 
-        void on_after_event(const cq::Event &event, json &data) {
-            iterate_hooks(&Plugin::hook_after_event, EventContext<cq::Event>(event, data));
+        void on_after_event(const cq::Event &event, EventPayload &payload) {
+            if (!payload.dropped()) {
+                iterate_hooks<Hook::after_event>(EventContext<cq::Event>(event, payload));
+            }
         }
 
         void on_before_action(const std::string &action, utils::JsonEx &params, ActionResult &result) {
-            iterate_hooks(&Plugin::hook_before_action, ActionContext(action, params, result));
+            iterate_hooks<Hook::before_action>(ActionContext(action, params, result));
         }
 
         void on_missed_action(const std::string &action, utils::JsonEx &params, ActionResult &result) {
-            iterate_hooks(&Plugin::hook_missed_action, ActionContext(action, params, result));
+            iterate_hooks<Hook::missed_action>(ActionContext(action, params, result));
         }
 
         void on_after_action(const std::string &action, utils::JsonEx &params, ActionResult &result) {
-            iterate_hooks(&Plugin::hook_after_action, ActionContext(action, params, result));
+            iterate_hooks<Hook::after_action>(ActionContext(action, params, result));
         }
 
         bool initialized() const { return initialized_; }
@@ -84,13 +96,18 @@ namespace cqhttp {
             return true;
         }
 
+        /**
+         * Run a task in the worker thread pool.
+         * Tasks with the same non-empty key run in the order they are pushed, for example, those sending messages
+         * to the same group, see helpers::get_target_key().
+         */
         template <typename F>
-        bool push_async_task(F &&task) const {
+        bool push_async_task(F &&task, const TaskPriority priority = TaskPriority::ACTION,
+                             const std::string &key = "") const {
             if (!worker_thread_pool_) {
                 return false;
             }
-            worker_thread_pool_->push([task = std::forward<F>(task)](int) { task(); });
-            return true;
+            return worker_thread_pool_->push(std::forward<F>(task), priority, key);
         }
 
         utils::JsonEx &config() { return config_; }
@@ -106,28 +123,53 @@ namespace cqhttp {
         std::vector<std::shared_ptr<Plugin>> plugins_;
         utils::JsonEx config_;
         utils::JsonEx store_;
-        std::shared_ptr<ctpl::thread_pool> worker_thread_pool_;
+        std::shared_ptr<Executor> worker_thread_pool_;
         std::shared_ptr<Bosma::Scheduler> scheduler_;
 
         bool initialized_ = false;
         bool enabled_ = false;
 
-        template <typename HookFunc, typename Ctx>
-        void iterate_hooks(const HookFunc hook_func, Ctx ctx) {
-            ctx.config = &config_;
+        // for each hook, the plugins that actually implement it, in the order they are used
+        std::array<std::vector<Plugin *>, static_cast<size_t>(Hook::_COUNT)> hook_table_;
+
+        template <typename P>
+        void add_plugin(const std::shared_ptr<P> &plugin) {
+            static_assert(std::is_base_of_v<Plugin, P>, "P must be a subclass of Plugin");
 
-            auto it = plugins_.begin();
-            Context::Next next = [&] {
-                if (it == plugins_.end()) {
-                    return;
-                }
+            plugins_.push_back(plugin);
 
-                ctx.next = next;
-                (**it++.*hook_func)(ctx);
-            };
-            next();
+            // with a bare Plugin pointer the concrete type is unknown, so it has to take part in every hook
+#define HOOK(Name, ContextType)                                                              \
+    if constexpr (std::is_same_v<P, Plugin> || HookTraits<Hook::Name>::overridden_by<P>()) { \
+        hook_table_[static_cast<size_t>(Hook::Name)].push_back(plugin.get());                \
+    }
+            CQHTTP_PLUGIN_HOOKS(HOOK)
+#undef HOOK
+        }
+
+        template <Hook H>
+        static void call_next_hook(Context &ctx) {
+            if (ctx.cursor_ == ctx.end_) {
+                return;
+            }
+
+            const auto plugin = *ctx.cursor_++;
+            (plugin->*HookTraits<H>::func)(static_cast<typename HookTraits<H>::ContextT &>(ctx));
+        }
+
+        template <Hook H, typename Ctx>
+        void iterate_hooks(Ctx ctx) {
+            static_assert(std::is_same_v<Ctx, typename HookTraits<H>::ContextT>, "context type mismatches the hook");
+
+            const auto &plugins = hook_table_[static_cast<size_t>(H)];
+            ctx.config = &config_;
+            ctx.cursor_ = plugins.data();
+            ctx.end_ = plugins.data() + plugins.size();
+            ctx.next_ = &call_next_hook<H>;
+            ctx.next();
         }
 
-        friend void use(std::shared_ptr<Plugin> plugin);
+        template <typename P>
+        friend void use(std::shared_ptr<P> plugin);
     };
 } // namespace cqhttp
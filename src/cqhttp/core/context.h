@@ -3,12 +3,13 @@
 #include "cqhttp/core/common.h"
 
 #include "cqhttp/core/action.h"
+#include "cqhttp/core/event_payload.h"
 #include "cqhttp/utils/jsonex.h"
 
 namespace cqhttp {
-    struct Context {
-        using Next = std::function<void()>;
+    struct Plugin;
 
+    struct Context {
         /**
          * This is granted to be non-null during calling plugins' hook functions.
          */
@@ -17,7 +18,19 @@ namespace cqhttp {
         /**
          * Should be called by plugins' hook funtions if they want to let other plugins play.
          */
-        Next next = nullptr;
+        void next() {
+            if (next_) {
+                next_(*this);
+            }
+        }
+
+    private:
+        friend class Application;
+
+        // set up by Application::iterate_hooks, walking over the plugins that implement the current hook
+        void (*next_)(Context &) = nullptr;
+        Plugin *const *cursor_ = nullptr;
+        Plugin *const *end_ = nullptr;
     };
 
     template <typename E>
@@ -27,12 +40,18 @@ namespace cqhttp {
          */
         const E &event;
 
+        /**
+         * The event data, prefer its typed accessors when only the hot fields are needed.
+         */
+        EventPayload &payload;
+
         /**
          * The jsonified event data. It may be modified by plugins' hook functions.
+         * It's built on the first call, use "payload.patch()" to modify it without forcing that.
          */
-        json &data;
+        json &data() { return payload.data(); }
 
-        EventContext(const E &event, json &data) : event(event), data(data) {}
+        EventContext(const E &event, EventPayload &payload) : event(event), payload(payload) {}
     };
 
     struct ActionContext : Context {
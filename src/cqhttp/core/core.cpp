@@ -1,5 +1,7 @@
 #include "./core.h"
 
+#include "cqhttp/core/event_ingestion.h"
+
 using namespace std;
 
 namespace cqhttp {
@@ -31,6 +33,33 @@ namespace cqhttp {
     LIFECYCLE(coolq_start);
     LIFECYCLE(coolq_exit);
 
+/**
+ * Run the hooks for events from CoolQ, which are handed over to the worker threads by event_ingestion::ingest().
+ */
+    template <typename E>
+    static void handle_message_event(const E &e) {
+        EventPayload payload(e);
+        app.on_before_event(e, payload);
+        app.on_message_event(e, payload);
+        app.on_after_event(e, payload);
+    }
+
+    template <typename E>
+    static void handle_notice_event(const E &e) {
+        EventPayload payload(e);
+        app.on_before_event(e, payload);
+        app.on_notice_event(e, payload);
+        app.on_after_event(e, payload);
+    }
+
+    template <typename E>
+    static void handle_request_event(const E &e) {
+        EventPayload payload(e);
+        app.on_before_event(e, payload);
+        app.on_request_event(e, payload);
+        app.on_after_event(e, payload);
+    }
+
 /**
  * Generate event callbacks.
  */
@@ -40,79 +69,46 @@ namespace cqhttp {
     static void __##Name##_event(__VA_ARGS__)
 
     EVENT(on_private_msg, const cq::PrivateMessageEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_message_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_message_event<cq::PrivateMessageEvent>);
     }
 
     EVENT(on_group_msg, const cq::GroupMessageEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_message_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_message_event<cq::GroupMessageEvent>);
     }
 
     EVENT(on_discuss_msg, const cq::DiscussMessageEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_message_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_message_event<cq::DiscussMessageEvent>);
     }
 
     EVENT(on_group_upload, const cq::GroupUploadEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_notice_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_notice_event<cq::GroupUploadEvent>);
     }
 
     EVENT(on_group_admin, const cq::GroupAdminEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_notice_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_notice_event<cq::GroupAdminEvent>);
     }
 
     EVENT(on_group_member_decrease, const cq::GroupMemberDecreaseEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_notice_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_notice_event<cq::GroupMemberDecreaseEvent>);
     }
 
     EVENT(on_group_member_increase, const cq::GroupMemberIncreaseEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_notice_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_notice_event<cq::GroupMemberIncreaseEvent>);
     }
 
     EVENT(on_group_ban, const cq::GroupBanEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_notice_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_notice_event<cq::GroupBanEvent>);
     }
 
     EVENT(on_friend_add, const cq::FriendAddEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_notice_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_notice_event<cq::FriendAddEvent>);
     }
 
     EVENT(on_friend_request, const cq::FriendRequestEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_request_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_request_event<cq::FriendRequestEvent>);
     }
 
     EVENT(on_group_request, const cq::GroupRequestEvent &e) {
-        json data = e;
-        app.on_before_event(e, data);
-        app.on_request_event(e, data);
-        app.on_after_event(e, data);
+        event_ingestion::ingest(e, handle_request_event<cq::GroupRequestEvent>);
     }
 } // namespace cqhttp
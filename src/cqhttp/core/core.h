@@ -14,5 +14,8 @@ namespace cqhttp {
      */
     void init();
 
-    inline void use(const std::shared_ptr<Plugin> plugin) { app.plugins_.push_back(plugin); }
+    template <typename P>
+    inline void use(const std::shared_ptr<P> plugin) {
+        app.add_plugin(plugin);
+    }
 } // namespace cqhttp
@@ -10,11 +10,11 @@ namespace cqhttp {
         // emit the event in thread pool
         app.push_async_task([=] {
             const auto e = event;
-            auto d = data;
-            app.on_before_event(e, d);
-            (app.*on_event)(e, d);
-            app.on_after_event(e, d);
-        });
+            EventPayload payload(e, data);
+            app.on_before_event(e, payload);
+            (app.*on_event)(e, payload);
+            app.on_after_event(e, payload);
+        }, TaskPriority::EVENT);
     }
 
     void emit_event(const cq::MessageEvent &event, json &data) {
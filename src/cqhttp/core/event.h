@@ -90,7 +90,8 @@ namespace cqhttp {
 
     template <typename E, typename = typename std::enable_if<std::is_base_of<cq::Event, E>::value>::type>
     void emit_event(E event) {
-        emit_event(event, json(event));
+        json data = event;
+        emit_event(event, data);
     }
 
     void emit_lifecycle_meta_event(
@@ -0,0 +1,160 @@
+#include "./event_ingestion.h"
+
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+#include "cqhttp/core/core.h"
+
+using namespace std;
+
+namespace cqhttp::event_ingestion {
+    static const auto TAG = u8"事件队列";
+
+    static mutex options_mutex;
+    static Options options;
+
+    static mutex slots_mutex;
+    static condition_variable slots_cv;
+    static size_t slots_taken = 0;
+
+    /**
+     * A slot in the queue, released when the task holding it is gone, whether it has run or been dropped.
+     */
+    struct Slot {
+        Slot() = default;
+        Slot(const Slot &) = delete;
+        Slot &operator=(const Slot &) = delete;
+
+        ~Slot() {
+            {
+                lock_guard<mutex> lock(slots_mutex);
+                slots_taken--;
+            }
+            slots_cv.notify_one();
+        }
+    };
+
+    static shared_ptr<Slot> take_slot(const size_t queue_size) {
+        unique_lock<mutex> lock(slots_mutex);
+        if (slots_taken >= queue_size) {
+            lock.unlock();
+            logging::warning(TAG, u8"事件队列已满，等待已有事件处理完成");
+            lock.lock();
+            slots_cv.wait(lock, [queue_size] { return slots_taken < queue_size; });
+        }
+        slots_taken++;
+        return make_shared<Slot>();
+    }
+
+    /**
+     * The verdict of an event, which CoolQ's thread waits for.
+     */
+    struct Verdict {
+        promise<cq::event::Operation> operation;
+        bool handled = false; // guarded by overdue_mutex
+        bool overdue = false; // guarded by overdue_mutex, whether it's counted in "overdue_counts"
+    };
+
+    // conversations with events not handled within the block timeout, and how many of such events each has
+    static mutex overdue_mutex;
+    static unordered_map<string, size_t> overdue_counts;
+
+    static bool has_overdue(const string &key) {
+        lock_guard<mutex> lock(overdue_mutex);
+        return overdue_counts.find(key) != overdue_counts.end();
+    }
+
+    static void mark_overdue(const string &key, Verdict &verdict) {
+        lock_guard<mutex> lock(overdue_mutex);
+        if (!verdict.handled) {
+            verdict.overdue = true;
+            overdue_counts[key]++;
+        }
+    }
+
+    static void mark_handled(const string &key, Verdict &verdict) {
+        lock_guard<mutex> lock(overdue_mutex);
+        verdict.handled = true;
+        if (verdict.overdue) {
+            if (const auto it = overdue_counts.find(key); it != overdue_counts.end() && --it->second == 0) {
+                overdue_counts.erase(it);
+            }
+        }
+    }
+
+    void configure(const Options &opts) {
+        lock_guard<mutex> lock(options_mutex);
+        options = opts;
+    }
+
+    size_t pending() {
+        lock_guard<mutex> lock(slots_mutex);
+        return slots_taken;
+    }
+
+    void ingest(const cq::Event &event, const string &key, function<cq::event::Operation()> handle) {
+        Options opts;
+        {
+            lock_guard<mutex> lock(options_mutex);
+            opts = options;
+        }
+
+        if (opts.queue_size == 0) {
+            event.operation = handle();
+            return;
+        }
+
+        const auto wait_for_verdict = opts.block_timeout > chrono::milliseconds::zero();
+        const auto verdict = make_shared<Verdict>();
+        auto future = verdict->operation.get_future();
+        auto task = make_shared<function<cq::event::Operation()>>(move(handle));
+
+        const auto pushed = app.push_async_task(
+            [task, verdict, key, wait_for_verdict, slot = take_slot(opts.queue_size)] {
+                cq::event::Operation operation;
+                try {
+                    operation = (*task)();
+                } catch (...) {
+                    mark_handled(key, *verdict);
+                    verdict->operation.set_exception(current_exception());
+                    throw;
+                }
+                if (operation == cq::event::BLOCK && !wait_for_verdict) {
+                    logging::debug(TAG, u8"事件在后台处理，无法拦截，如需拦截请设置 event_block_timeout");
+                }
+                mark_handled(key, *verdict);
+                verdict->operation.set_value(operation);
+            },
+            TaskPriority::EVENT,
+            key);
+        if (!pushed) {
+            // no worker threads, e.g. the plugin is being disabled
+            event.operation = (*task)();
+            return;
+        }
+
+        if (!wait_for_verdict) {
+            return;
+        }
+        // events without a key don't wait behind others, so they are always waited for
+        if (!key.empty() && has_overdue(key)) {
+            // it would wait behind the overdue one, leave CoolQ's thread to other conversations
+            logging::debug(TAG, u8"同一会话中有事件未能在 event_block_timeout 内处理完成，此事件将不会被拦截");
+            return;
+        }
+        if (future.wait_for(opts.block_timeout) == future_status::ready) {
+            try {
+                event.operation = future.get();
+            } catch (exception &) {
+                // the handling failed with an exception, leave the event unblocked
+            }
+        } else {
+            if (!key.empty()) {
+                mark_overdue(key, *verdict);
+            }
+            logging::debug(TAG, u8"事件未能在 event_block_timeout 内处理完成，将不会被拦截");
+        }
+    }
+} // namespace cqhttp::event_ingestion
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "cqhttp/core/common.h"
+
+#include <chrono>
+
+namespace cqhttp::event_ingestion {
+    struct Options {
+        /**
+         * The max number of events queued or being handled, CoolQ's thread waits when it's reached.
+         * Zero means to handle events right on CoolQ's thread.
+         */
+        size_t queue_size = 1024;
+
+        /**
+         * How long CoolQ's thread waits for an event to be handled, so that it can be blocked.
+         * Zero means to return to CoolQ at once, and never block events.
+         *
+         * An event waits behind the earlier ones of its conversation, so once one of them is past the timeout,
+         * the later ones are not waited for until it's handled, which bounds the wait to one timeout
+         * for each backlog of a conversation.
+         */
+        std::chrono::milliseconds block_timeout{5000};
+    };
+
+    void configure(const Options &options);
+
+    /**
+     * Get the number of events queued or being handled.
+     */
+    size_t pending();
+
+    /**
+     * Hand an event from CoolQ over to the worker threads, where "handle" runs on a copy of the event.
+     * Events of the same conversation are handled in the order they come.
+     * The event is blocked if the copy is blocked within the block timeout.
+     */
+    void ingest(const cq::Event &event, const std::string &key, std::function<cq::event::Operation()> handle);
+
+    template <typename E>
+    void ingest(const E &event, void (*handle)(const E &)) {
+        // in the form of helpers::get_target_key(), so that quick operations keep their order with the events
+        std::string key;
+        if constexpr (std::is_base_of_v<cq::event::GroupIdMixin, E>) {
+            key = "group_id=" + std::to_string(event.group_id);
+        } else if constexpr (std::is_base_of_v<cq::event::DiscussIdMixin, E>) {
+            key = "discuss_id=" + std::to_string(event.discuss_id);
+        } else if constexpr (std::is_base_of_v<cq::event::UserIdMixin, E>) {
+            key = "user_id=" + std::to_string(event.user_id);
+        }
+        ingest(event, key, [copy = event, handle] {
+            handle(copy);
+            return copy.operation;
+        });
+    }
+} // namespace cqhttp::event_ingestion
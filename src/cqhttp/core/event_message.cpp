@@ -0,0 +1,72 @@
+#include "./event_message.h"
+
+#include "cqsdk/message_parser.h"
+
+using namespace std;
+
+namespace cqhttp {
+    using cq::message::MessageParser;
+    using cq::message::SegmentView;
+
+    EventMessage::EventMessage(const string &raw, const cq::Message &parsed) : raw_(raw) {
+        segments_.reserve(parsed.size());
+        for (const auto &segment : parsed) {
+            segments_.push_back(&segment);
+        }
+    }
+
+    void EventMessage::replace(const size_t index, cq::MessageSegment segment) {
+        if (index >= segments_.size()) {
+            throw out_of_range("segment index " + std::to_string(index) + " out of range, the message has "
+                               + std::to_string(segments_.size()) + " segments");
+        }
+        if (replaced_.empty()) {
+            replaced_.resize(segments_.size());
+        }
+        replaced_[index] = move(segment);
+    }
+
+    string EventMessage::to_string() const {
+        if (!modified()) {
+            return raw_;
+        }
+
+        // find where each segment starts in the original string, segments are contiguous in it
+        vector<size_t> offsets;
+        offsets.reserve(segments_.size() + 1);
+        MessageParser parser(raw_);
+        SegmentView view;
+        while (parser.next(view)) {
+            const auto begin = view.cq_code ? view.type.data() - 4 /* "[CQ:" */ : view.raw.data();
+            offsets.push_back(begin - raw_.data());
+        }
+        offsets.push_back(raw_.size());
+
+        string result;
+        result.reserve(raw_.size() + 64);
+        if (offsets.size() != segments_.size() + 1) {
+            // the parsed segments don't come from the original string as is, so serialize them all
+            for (size_t i = 0; i < size(); i++) {
+                cq::message::append_segment(result, (*this)[i]);
+            }
+            return result;
+        }
+
+        for (size_t i = 0; i < size(); i++) {
+            if (replaced_[i]) {
+                cq::message::append_segment(result, *replaced_[i]);
+            } else {
+                result.append(raw_, offsets[i], offsets[i + 1] - offsets[i]);
+            }
+        }
+        return result;
+    }
+
+    json EventMessage::to_json() const {
+        auto result = json::array();
+        for (size_t i = 0; i < size(); i++) {
+            result.push_back((*this)[i]);
+        }
+        return result;
+    }
+} // namespace cqhttp
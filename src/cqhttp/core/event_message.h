@@ -0,0 +1,49 @@
+#pragma once
+
+#include "cqhttp/core/common.h"
+
+namespace cqhttp {
+    /**
+     * Message of a message event, kept as both the original message string and the parsed segments.
+     *
+     * Plugins change segments with "replace()", which marks them dirty, and only the dirty ones are serialized
+     * again when the message string is asked for, the rest are copied from the original string as they are.
+     * So the message string of an unmodified message is just the original one, byte for byte.
+     */
+    class EventMessage {
+    public:
+        /**
+         * Both are referred to, not copied, so they must outlive this object, as the event does its payload.
+         */
+        EventMessage(const std::string &raw, const cq::Message &parsed);
+
+        size_t size() const { return segments_.size(); }
+
+        const cq::MessageSegment &operator[](const size_t index) const {
+            return index < replaced_.size() && replaced_[index] ? *replaced_[index] : *segments_[index];
+        }
+
+        /**
+         * Replace a segment, marking it dirty.
+         * Throw std::out_of_range if there is no segment at the index, leaving the message unchanged.
+         */
+        void replace(size_t index, cq::MessageSegment segment);
+
+        bool modified() const { return !replaced_.empty(); }
+
+        /**
+         * Get the message string.
+         */
+        std::string to_string() const;
+
+        /**
+         * Get the array form, as the "message" field of the jsonified event has it.
+         */
+        json to_json() const;
+
+    private:
+        const std::string &raw_;
+        std::vector<const cq::MessageSegment *> segments_;
+        std::vector<std::optional<cq::MessageSegment>> replaced_; // empty until a segment is replaced
+    };
+} // namespace cqhttp
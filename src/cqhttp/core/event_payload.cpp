@@ -0,0 +1,98 @@
+#include "./event_payload.h"
+
+#include "cqhttp/utils/json_writer.h"
+
+using namespace std;
+
+namespace cqhttp {
+    void EventPayload::materialize() {
+        if (build_) {
+            build_(event_, data_);
+            build_ = nullptr;
+
+            // the built data has the parsed message in array form already
+            if (message_ && (message_->modified() || message_format_ != MessageFormat::ARRAY)) {
+                write_message();
+            }
+
+            if (!pending_patches_.empty()) {
+                message_synced_ = false; // the "message" field may be changed by the patches
+            }
+            for (const auto &patch : pending_patches_) {
+                patch(data_);
+            }
+            pending_patches_.clear();
+        }
+    }
+
+    json &EventPayload::data() {
+        materialize();
+        serialized_ = nullptr;
+        message_synced_ = false; // the "message" field may be changed through the reference
+        return data_;
+    }
+
+    const json &EventPayload::const_data() {
+        materialize();
+        return data_;
+    }
+
+    EventPayload::Buffer EventPayload::serialized() {
+        if (!serialized_) {
+            serialized_ = make_shared<const string>(const_data().dump());
+        }
+        return serialized_;
+    }
+
+    void EventPayload::patch(Patch func) {
+        if (materialized()) {
+            serialized_ = nullptr;
+            message_synced_ = false;
+            func(data_);
+        } else {
+            pending_patches_.push_back(move(func));
+        }
+    }
+
+    void EventPayload::patch_message(const function<void(EventMessage &)> &func) {
+        if (!message_) {
+            return;
+        }
+        func(*message_);
+        if (materialized()) {
+            serialized_ = nullptr;
+            write_message();
+        }
+    }
+
+    void EventPayload::set_message_format(const MessageFormat format) {
+        if (format == message_format_) {
+            return;
+        }
+        message_format_ = format;
+        if (!materialized()) {
+            return; // it's written when the data is built
+        }
+
+        serialized_ = nullptr;
+        if (message_ && message_synced_) {
+            write_message();
+            return;
+        }
+
+        // the "message" field may have been changed by others, so convert what it is now
+        auto &message = data_["message"];
+        if (format == MessageFormat::STRING) {
+            string str;
+            utils::append_cq_string(str, message);
+            message = move(str);
+        } else {
+            message = message.get<cq::Message>();
+        }
+    }
+
+    void EventPayload::write_message() {
+        data_["message"] = message_format_ == MessageFormat::STRING ? json(message_->to_string()) : message_->to_json();
+        message_synced_ = true;
+    }
+} // namespace cqhttp
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "cqhttp/core/common.h"
+
+#include "cqhttp/core/event.h"
+#include "cqhttp/core/event_message.h"
+
+namespace cqhttp {
+    /**
+     * Data of an event flowing through the plugins.
+     *
+     * The hot fields are available as typed values taken from the event object,
+     * while the jsonified data is only built on the first call of "data()",
+     * so that events dropped early never pay for JSON construction.
+     */
+    class EventPayload {
+    public:
+        enum class PostType {
+            UNKNOWN,
+            MESSAGE,
+            NOTICE,
+            REQUEST,
+            META_EVENT,
+        };
+
+        enum class MessageFormat {
+            ARRAY,
+            STRING,
+        };
+
+        using Patch = std::function<void(json &)>;
+        using Buffer = std::shared_ptr<const std::string>;
+
+        template <typename E, typename = typename std::enable_if<std::is_base_of<cq::Event, E>::value>::type>
+        explicit EventPayload(const E &event) : event_(event), build_(&build<E>) {
+            extract_hot_fields(event);
+        }
+
+        /**
+         * Create a payload whose jsonified data is already there.
+         */
+        template <typename E, typename = typename std::enable_if<std::is_base_of<cq::Event, E>::value>::type>
+        EventPayload(const E &event, json data) : event_(event), build_(nullptr), data_(std::move(data)) {
+            extract_hot_fields(event);
+        }
+
+        EventPayload(const EventPayload &) = delete;
+        EventPayload &operator=(const EventPayload &) = delete;
+
+        // typed accessors, note that they reflect the original event, not modifications on the jsonified data
+
+        PostType post_type() const { return post_type_; }
+        cq::message::Type message_type() const { return message_type_; }
+        MetaEvent::Type meta_event_type() const { return meta_event_type_; }
+        std::optional<int64_t> user_id() const { return user_id_; }
+        std::optional<int64_t> group_id() const { return group_id_; }
+
+        /**
+         * Whether the jsonified data has been built.
+         */
+        bool materialized() const { return build_ == nullptr; }
+
+        /**
+         * Get the jsonified data, building it (and applying pending patches) if not yet.
+         * Since the data may be modified through the returned reference, the serialized buffer is dropped.
+         */
+        json &data();
+
+        /**
+         * Same as "data()", but for reading only, so the serialized buffer is kept.
+         */
+        const json &const_data();
+
+        /**
+         * Get the serialized jsonified data.
+         * It's dumped once and shared by all transports (and signature computing),
+         * until the data is modified again.
+         */
+        Buffer serialized();
+
+        /**
+         * Modify the jsonified data. If it's not built yet, the patch is deferred until it is.
+         */
+        void patch(Patch func);
+
+        /**
+         * Get the message of a message event, or nullptr for other events.
+         *
+         * The "message" field of the jsonified data is generated from it, in the format set by "set_message_format()",
+         * so plugins should change the message with "patch_message()", rather than patching the field.
+         */
+        const EventMessage *message() const { return message_ ? &*message_ : nullptr; }
+
+        /**
+         * Modify the message of a message event, the "message" field is regenerated if the data is already built.
+         */
+        void patch_message(const std::function<void(EventMessage &)> &func);
+
+        /**
+         * Set the format of the "message" field, array by default.
+         * For an unmodified message in string format, that's the original message string, with no conversion at all.
+         */
+        void set_message_format(MessageFormat format);
+
+        /**
+         * Drop the event, so that the stages after the current one are skipped, along with the work in their hooks.
+         */
+        void drop() { dropped_ = true; }
+
+        bool dropped() const { return dropped_; }
+
+    private:
+        const cq::Event &event_;
+        void (*build_)(const cq::Event &, json &);
+        json data_;
+        std::vector<Patch> pending_patches_;
+        Buffer serialized_;
+        bool dropped_ = false;
+
+        std::optional<EventMessage> message_;
+        MessageFormat message_format_ = MessageFormat::ARRAY;
+        bool message_synced_ = true; // whether the "message" field is still what "message_" generates
+
+        void write_message();
+
+        PostType post_type_ = PostType::UNKNOWN;
+        cq::message::Type message_type_ = cq::message::UNKNOWN;
+        MetaEvent::Type meta_event_type_ = MetaEvent::UNKNOWN;
+        std::optional<int64_t> user_id_;
+        std::optional<int64_t> group_id_;
+
+        void materialize();
+
+        template <typename E>
+        static void build(const cq::Event &event, json &data) {
+            data = static_cast<const E &>(event);
+        }
+
+        template <typename E>
+        void extract_hot_fields(const E &event) {
+            if constexpr (std::is_base_of_v<MetaEvent, E>) {
+                post_type_ = PostType::META_EVENT;
+                meta_event_type_ = event.meta_event_type;
+            } else {
+                switch (event.type) {
+                case cq::event::MESSAGE:
+                    post_type_ = PostType::MESSAGE;
+                    break;
+                case cq::event::NOTICE:
+                    post_type_ = PostType::NOTICE;
+                    break;
+                case cq::event::REQUEST:
+                    post_type_ = PostType::REQUEST;
+                    break;
+                default:
+                    break;
+                }
+            }
+            if constexpr (std::is_base_of_v<cq::MessageEvent, E>) {
+                message_type_ = event.message_type;
+                message_.emplace(event.raw_message, event.message);
+            }
+            if constexpr (std::is_base_of_v<cq::event::UserIdMixin, E>) {
+                user_id_ = event.user_id;
+            }
+            if constexpr (std::is_base_of_v<cq::event::GroupIdMixin, E>) {
+                group_id_ = event.group_id;
+            }
+        }
+    };
+} // namespace cqhttp
@@ -0,0 +1,214 @@
+#include "./executor.h"
+
+using namespace std;
+
+namespace cqhttp {
+    static const int SPINS_BEFORE_PARKING = 16;
+
+    // the executor and the index of the worker running on the current thread, if any
+    static thread_local const Executor *current_executor = nullptr;
+    static thread_local size_t current_worker_index = 0;
+
+    static void run_task(const Executor::Task &task) {
+        try {
+            task();
+        } catch (...) {
+            // same as the previous thread pool, where exceptions ended up in futures nobody waited on
+        }
+    }
+
+    Executor::Executor(const size_t n_workers) { resize(n_workers); }
+
+    Executor::~Executor() { stop(); }
+
+    bool Executor::push(Task task, const TaskPriority priority, const string &key) {
+        if (stopping_.load()) {
+            return false;
+        }
+        if (key.empty()) {
+            return push_to_worker(move(task), priority);
+        }
+
+        auto &shard = strands_[hash<string>()(key) % STRAND_SHARDS];
+        {
+            unique_lock<mutex> lock(shard.mutex);
+            auto [it, inserted] = shard.queues.try_emplace(key);
+            it->second.push_back(Keyed{move(task), priority});
+            if (!inserted) {
+                // an earlier task of the key is queued or running, this one will follow it
+                return true;
+            }
+        }
+        return push_to_worker([this, key] { run_strand(key); }, priority);
+    }
+
+    void Executor::run_strand(const string &key) {
+        auto &shard = strands_[hash<string>()(key) % STRAND_SHARDS];
+        Task task;
+        {
+            unique_lock<mutex> lock(shard.mutex);
+            auto &queue = shard.queues.at(key);
+            task = move(queue.front().task);
+            queue.pop_front();
+        }
+
+        run_task(task);
+
+        TaskPriority next_priority;
+        {
+            unique_lock<mutex> lock(shard.mutex);
+            const auto it = shard.queues.find(key);
+            if (it->second.empty()) {
+                shard.queues.erase(it);
+                return;
+            }
+            next_priority = it->second.front().priority;
+        }
+        // go back to the deques instead of running the next one at once, so that a busy key doesn't starve others
+        push_to_worker([this, key] { run_strand(key); }, next_priority);
+    }
+
+    bool Executor::push_to_worker(Task task, const TaskPriority priority) {
+        if (stopping_.load()) {
+            return false;
+        }
+
+        const auto active_count = active_count_.load();
+        const auto index = current_executor == this && current_worker_index < active_count
+                               ? current_worker_index
+                               : next_worker_.fetch_add(1, memory_order_relaxed) % active_count;
+        auto &worker = *workers_[index];
+        {
+            unique_lock<mutex> lock(worker.mutex);
+            worker.queues[static_cast<size_t>(priority)].push_back(move(task));
+        }
+        pending_count_.fetch_add(1);
+        wake();
+        return true;
+    }
+
+    bool Executor::take(const size_t index, Task &out) {
+        const auto allocated_count = allocated_count_.load();
+        for (size_t p = 0; p < PRIORITY_COUNT; p++) {
+            // own deque first, then steal from the others, starting from the next worker to spread the contention.
+            // a busy deque is skipped rather than waited for, even if it may hold a task of this priority
+            for (size_t i = 0; i < allocated_count; i++) {
+                auto &worker = *workers_[(index + i) % allocated_count];
+                unique_lock<mutex> lock(worker.mutex, defer_lock);
+                if (i == 0) {
+                    lock.lock();
+                } else if (!lock.try_lock()) {
+                    continue;
+                }
+                auto &queue = worker.queues[p];
+                if (!queue.empty()) {
+                    out = move(queue.front());
+                    queue.pop_front();
+                    pending_count_.fetch_sub(1);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void Executor::work(const size_t index) {
+        current_executor = this;
+        current_worker_index = index;
+
+        const auto should_leave = [&] { return stopping_.load() || index >= active_count_.load(); };
+        while (!should_leave()) {
+            if (Task task; take(index, task)) {
+                run_task(task);
+                continue;
+            }
+
+            // someone may be just pushing, or holding the lock of the deque we tried to steal from
+            auto ready = false;
+            for (auto i = 0; i < SPINS_BEFORE_PARKING && !ready; i++) {
+                this_thread::yield();
+                ready = pending_count_.load() > 0;
+            }
+            if (ready) {
+                continue;
+            }
+
+            unique_lock<mutex> lock(park_mutex_);
+            parked_count_.fetch_add(1);
+            // pairs with the fence in "wake()", so that either we see the new task, or the pusher sees us parked
+            atomic_thread_fence(memory_order_seq_cst);
+            park_cv_.wait(lock, [&] { return pending_count_.load() > 0 || should_leave(); });
+            parked_count_.fetch_sub(1);
+        }
+    }
+
+    void Executor::wake(const bool all) {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (all || parked_count_.load(memory_order_relaxed) > 0) {
+            // taking the lock makes sure a worker is either before checking the predicate, or already waiting
+            { unique_lock<mutex> lock(park_mutex_); }
+            if (all) {
+                park_cv_.notify_all();
+            } else {
+                park_cv_.notify_one();
+            }
+        }
+    }
+
+    void Executor::resize(size_t n_workers) {
+        unique_lock<mutex> lock(resize_mutex_);
+        if (stopping_.load()) {
+            return;
+        }
+
+        n_workers = min(max<size_t>(n_workers, 1), MAX_WORKERS);
+        const auto old_count = active_count_.load();
+        if (n_workers <= old_count) {
+            // the workers removed see it when they wake up, their threads are joined when reused or stopped
+            active_count_.store(n_workers);
+            wake(true);
+            return;
+        }
+
+        for (auto i = old_count; i < n_workers; i++) {
+            if (!workers_[i]) {
+                workers_[i] = make_unique<Worker>();
+                allocated_count_.store(i + 1);
+            } else if (workers_[i]->thread.joinable()) {
+                // a worker removed earlier, which must be leaving
+                workers_[i]->thread.join();
+            }
+        }
+        active_count_.store(n_workers);
+        for (auto i = old_count; i < n_workers; i++) {
+            workers_[i]->thread = thread([this, i] { work(i); });
+        }
+    }
+
+    void Executor::stop() {
+        unique_lock<mutex> lock(resize_mutex_);
+        if (stopping_.exchange(true)) {
+            return;
+        }
+        wake(true);
+
+        const auto allocated_count = allocated_count_.load();
+        for (size_t i = 0; i < allocated_count; i++) {
+            if (workers_[i]->thread.joinable()) {
+                workers_[i]->thread.join();
+            }
+        }
+
+        for (size_t i = 0; i < allocated_count; i++) {
+            unique_lock<mutex> worker_lock(workers_[i]->mutex);
+            for (auto &queue : workers_[i]->queues) {
+                queue.clear();
+            }
+        }
+        for (auto &shard : strands_) {
+            unique_lock<mutex> shard_lock(shard.mutex);
+            shard.queues.clear();
+        }
+        pending_count_.store(0);
+    }
+} // namespace cqhttp
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "cqhttp/core/common.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace cqhttp {
+    /**
+     * Priority of a task in the executor. Workers look for tasks of higher priority first, but it's best effort:
+     * stealing skips the deques of workers that are locked at the moment, so a task may be taken while
+     * there is one of higher priority queued in such a deque.
+     */
+    enum class TaskPriority {
+        EVENT, // emitting events
+        ACTION, // async actions, API requests of reverse websocket, quick operations
+        BACKGROUND, // update checks and so on
+        _COUNT,
+    };
+
+    /**
+     * A work-stealing thread pool.
+     *
+     * Each worker owns a deque for each priority. Tasks pushed by a worker go to its own deques, while tasks pushed
+     * by other threads are spread over the workers in round-robin order. A worker out of tasks steals from the
+     * others, so that a worker stuck in a long task doesn't hold up the tasks behind it.
+     *
+     * Tasks with the same serialization key run one at a time, in the order they are pushed, while tasks with
+     * different keys (or no key at all) run in parallel.
+     */
+    class Executor {
+    public:
+        using Task = std::function<void()>;
+
+        static constexpr size_t MAX_WORKERS = 256;
+
+        explicit Executor(size_t n_workers);
+        ~Executor();
+
+        Executor(const Executor &) = delete;
+        Executor &operator=(const Executor &) = delete;
+
+        /**
+         * Push a task. Return false if the executor is stopped.
+         */
+        bool push(Task task, TaskPriority priority = TaskPriority::ACTION, const std::string &key = "");
+
+        /**
+         * Change the number of workers. Workers removed leave after their current task, and the tasks left in
+         * their deques are stolen by the others.
+         */
+        void resize(size_t n_workers);
+
+        /**
+         * Stop all workers after their current task. Tasks still queued are dropped.
+         */
+        void stop();
+
+        size_t size() const { return active_count_.load(); }
+
+    private:
+        static constexpr size_t PRIORITY_COUNT = static_cast<size_t>(TaskPriority::_COUNT);
+        static constexpr size_t STRAND_SHARDS = 16;
+
+        struct Worker {
+            std::mutex mutex;
+            std::array<std::deque<Task>, PRIORITY_COUNT> queues;
+            std::thread thread;
+        };
+
+        struct Keyed {
+            Task task;
+            TaskPriority priority;
+        };
+
+        // a key is present as long as one of its tasks is queued in a worker or running
+        struct StrandShard {
+            std::mutex mutex;
+            std::unordered_map<std::string, std::deque<Keyed>> queues;
+        };
+
+        std::array<std::unique_ptr<Worker>, MAX_WORKERS> workers_;
+        std::atomic<size_t> allocated_count_{0}; // workers ever created, which may have tasks to steal
+        std::atomic<size_t> active_count_{0}; // workers with smaller indices are running
+        std::atomic<size_t> next_worker_{0};
+        std::atomic<int64_t> pending_count_{0}; // tasks in the deques of all workers
+        std::atomic_bool stopping_{false};
+        std::mutex resize_mutex_;
+
+        std::mutex park_mutex_;
+        std::condition_variable park_cv_;
+        std::atomic<size_t> parked_count_{0};
+
+        std::array<StrandShard, STRAND_SHARDS> strands_;
+
+        bool push_to_worker(Task task, TaskPriority priority);
+        bool take(size_t index, Task &out);
+        void work(size_t index);
+        void run_strand(const std::string &key);
+        void wake(bool all = false);
+    };
+} // namespace cqhttp
@@ -18,4 +18,16 @@ namespace cqhttp::helpers {
 
         return url + rel_path;
     }
+
+    string get_target_key(const json &data) {
+        if (!data.is_object()) {
+            return "";
+        }
+        for (const auto key : {"group_id", "discuss_id", "user_id"}) {
+            if (const auto it = data.find(key); it != data.end() && !it->is_null()) {
+                return string(key) + "=" + (it->is_string() ? it->get<string>() : it->dump());
+            }
+        }
+        return "";
+    }
 } // namespace cqhttp::helpers
@@ -5,4 +5,10 @@
 namespace cqhttp::helpers {
     std::string get_update_source_url(std::string rel_path = "");
     inline std::string get_asset_url(std::string asset_name) { return get_update_source_url("assets/" + asset_name); }
+
+    /**
+     * Get the target of an event or action params, that is, the conversation or user it's about,
+     * in the form of "group_id=123". Return an empty string if there is none.
+     */
+    std::string get_target_key(const json &data);
 } // namespace cqhttp::helpers
@@ -0,0 +1,166 @@
+#include "./info_cache.h"
+
+#include <atomic>
+#include <mutex>
+
+#include "cqhttp/utils/lru_cache.h"
+#include "cqhttp/utils/single_flight.h"
+
+using namespace std;
+namespace api = cq::api;
+
+namespace cqhttp::info_cache {
+    using MemberKey = pair<int64_t, int64_t>; // group id, user id
+
+    struct MemberKeyHash {
+        size_t operator()(const MemberKey &key) const noexcept {
+            return hash<int64_t>()(key.first) ^ hash<int64_t>()(key.second) * 0x9E3779B97F4A7C15ull;
+        }
+    };
+
+    template <typename Key, typename Value, typename Hash = hash<Key>>
+    struct Store {
+        using FlightKey = pair<uint64_t, Key>; // generation, key
+
+        struct FlightKeyHash {
+            size_t operator()(const FlightKey &key) const noexcept {
+                return Hash()(key.second) ^ hash<uint64_t>()(key.first) * 0x9E3779B97F4A7C15ull;
+            }
+        };
+
+        utils::LruCache<Key, Value, Hash> cache;
+        utils::SingleFlight<FlightKey, Value, FlightKeyHash> flights;
+
+        Store(const chrono::seconds ttl, const size_t capacity) : cache(ttl, capacity), flights() {}
+
+        uint64_t generation() {
+            lock_guard<mutex> lock(generation_mutex_);
+            return generation_;
+        }
+
+        /**
+         * Put what was fetched in the given generation, unless the store has been invalidated since.
+         */
+        void put(const Key &key, const Value &value, const uint64_t generation) {
+            lock_guard<mutex> lock(generation_mutex_);
+            if (generation == generation_) {
+                cache.put(key, value);
+            }
+        }
+
+        /**
+         * Erase entries with "erase", and start a new generation, so that the fetches in flight
+         * neither fill the cache nor are joined by later callers.
+         */
+        template <typename Erase>
+        void invalidate(Erase &&erase) {
+            lock_guard<mutex> lock(generation_mutex_);
+            ++generation_;
+            erase(cache);
+        }
+
+    private:
+        mutex generation_mutex_;
+        uint64_t generation_ = 0;
+    };
+
+    static const chrono::seconds DEFAULT_TTL(60);
+    static const size_t DEFAULT_CAPACITY = 10000;
+
+    static Store<int64_t, cq::User> strangers(DEFAULT_TTL, DEFAULT_CAPACITY);
+    static Store<int64_t, cq::Group> groups(DEFAULT_TTL, DEFAULT_CAPACITY);
+    static Store<int64_t, vector<cq::GroupMember>> member_lists(DEFAULT_TTL, DEFAULT_CAPACITY);
+    static Store<MemberKey, cq::GroupMember, MemberKeyHash> members(DEFAULT_TTL, DEFAULT_CAPACITY);
+
+    static atomic<uint64_t> cache_hits{0};
+    static atomic<uint64_t> api_calls{0};
+    static atomic<uint64_t> coalesced_waits{0};
+
+    /**
+     * Serve from the cache, or join the same fetch in flight, or fetch and put it into the cache.
+     * Fetches with "no_cache" are never shared, for they are meant to get the latest.
+     */
+    template <typename Key, typename Value, typename Hash, typename Fetch>
+    static Value get(Store<Key, Value, Hash> &store, const Key &key, const bool no_cache, Fetch &&fetch) {
+        const auto generation = store.generation();
+        const auto fetch_and_put = [&] {
+            ++api_calls;
+            auto value = fetch(no_cache);
+            store.put(key, value, generation);
+            return value;
+        };
+
+        if (no_cache) {
+            return fetch_and_put();
+        }
+        if (auto value = store.cache.get(key)) {
+            ++cache_hits;
+            return move(*value);
+        }
+        auto shared = false;
+        auto value = store.flights.run({generation, key}, fetch_and_put, shared);
+        if (shared) {
+            ++coalesced_waits;
+        }
+        return value;
+    }
+
+    void configure(const chrono::seconds ttl, const size_t capacity) {
+        strangers.cache.set_limits(ttl, capacity);
+        groups.cache.set_limits(ttl, capacity);
+        // member lists are big, keep fewer of them
+        member_lists.cache.set_limits(ttl, capacity > 0 ? max(capacity / 10, static_cast<size_t>(1)) : 0);
+        members.cache.set_limits(ttl, capacity);
+    }
+
+    void clear() {
+        const auto clear_all = [](auto &cache) { cache.clear(); };
+        strangers.invalidate(clear_all);
+        groups.invalidate(clear_all);
+        member_lists.invalidate(clear_all);
+        members.invalidate(clear_all);
+    }
+
+    json stats() {
+        return {
+            {"cache_hits", cache_hits.load()},
+            {"api_calls", api_calls.load()},
+            {"coalesced_waits", coalesced_waits.load()},
+        };
+    }
+
+    cq::User get_stranger_info(const int64_t user_id, const bool no_cache) {
+        return get(strangers, user_id, no_cache, [&](const bool nc) { return api::get_stranger_info(user_id, nc); });
+    }
+
+    cq::Group get_group_info(const int64_t group_id, const bool no_cache) {
+        return get(groups, group_id, no_cache, [&](const bool nc) { return api::get_group_info(group_id, nc); });
+    }
+
+    vector<cq::GroupMember> get_group_member_list(const int64_t group_id, const bool no_cache) {
+        // the list lacks some fields (area, title, etc.), so it doesn't answer the member queries
+        return get(member_lists, group_id, no_cache, [&](bool) { return api::get_group_member_list(group_id); });
+    }
+
+    cq::GroupMember get_group_member_info(const int64_t group_id, const int64_t user_id, const bool no_cache) {
+        return get(members, {group_id, user_id}, no_cache, [&](const bool nc) {
+            return api::get_group_member_info(group_id, user_id, nc);
+        });
+    }
+
+    void invalidate_group(const int64_t group_id) {
+        const auto erase_group = [group_id](auto &cache) { cache.erase(group_id); };
+        groups.invalidate(erase_group);
+        member_lists.invalidate(erase_group);
+        members.invalidate([group_id](auto &cache) {
+            cache.erase_if([group_id](const MemberKey &key) { return key.first == group_id; });
+        });
+    }
+
+    void invalidate_group_member(const int64_t group_id, const int64_t user_id) {
+        const auto erase_group = [group_id](auto &cache) { cache.erase(group_id); };
+        groups.invalidate(erase_group); // the member count changes
+        member_lists.invalidate(erase_group);
+        members.invalidate([group_id, user_id](auto &cache) { cache.erase({group_id, user_id}); });
+    }
+} // namespace cqhttp::info_cache
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "cqhttp/core/common.h"
+
+#include <chrono>
+
+namespace cqhttp::info_cache {
+    /**
+     * Set how long the info is kept and how many entries of each kind at most.
+     * A zero TTL or capacity turns the cache off.
+     */
+    void configure(std::chrono::seconds ttl, size_t capacity);
+
+    void clear();
+
+    /**
+     * Get the counters of cache hits, calls to CoolQ, and waits for the same calls in flight.
+     */
+    json stats();
+
+    // the same as those in cq::api, but served from the cache if possible, and concurrent calls for the same info
+    // share one call to CoolQ, "no_cache" skips the cache (and CoolQ's own cache) and refreshes it
+
+    cq::User get_stranger_info(int64_t user_id, bool no_cache = false) noexcept(false);
+    cq::Group get_group_info(int64_t group_id, bool no_cache = false) noexcept(false);
+    std::vector<cq::GroupMember> get_group_member_list(int64_t group_id, bool no_cache = false) noexcept(false);
+    cq::GroupMember get_group_member_info(int64_t group_id, int64_t user_id, bool no_cache = false) noexcept(false);
+
+    /**
+     * Forget everything about the group, e.g. after leaving it.
+     */
+    void invalidate_group(int64_t group_id);
+
+    /**
+     * Forget the member, and the group info and member list including it, e.g. after someone joins or leaves.
+     */
+    void invalidate_group_member(int64_t group_id, int64_t user_id);
+} // namespace cqhttp::info_cache
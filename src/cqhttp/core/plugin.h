@@ -57,4 +57,52 @@ namespace cqhttp {
 
         virtual bool good() const { return true; }
     };
+
+/**
+ * All hooks of the Plugin class, in the form of HOOK(Name, ContextType).
+ */
+#define CQHTTP_PLUGIN_HOOKS(HOOK)                       \
+    HOOK(initialize, Context)                           \
+    HOOK(enable, Context)                               \
+    HOOK(disable, Context)                              \
+    HOOK(coolq_start, Context)                          \
+    HOOK(coolq_exit, Context)                           \
+    HOOK(before_event, EventContext<cq::Event>)         \
+    HOOK(message_event, EventContext<cq::MessageEvent>) \
+    HOOK(notice_event, EventContext<cq::NoticeEvent>)   \
+    HOOK(request_event, EventContext<cq::RequestEvent>) \
+    HOOK(meta_event, EventContext<cqhttp::MetaEvent>)   \
+    HOOK(after_event, EventContext<cq::Event>)          \
+    HOOK(before_action, ActionContext)                  \
+    HOOK(missed_action, ActionContext)                  \
+    HOOK(after_action, ActionContext)
+
+    enum class Hook : size_t {
+#define HOOK(Name, ContextType) Name,
+        CQHTTP_PLUGIN_HOOKS(HOOK)
+#undef HOOK
+        _COUNT
+    };
+
+    /**
+     * Compile-time information of a hook.
+     * "overridden_by<P>()" works because "&P::hook_xxx" stays a pointer to Plugin's member,
+     * unless P (or one of its bases) overrides the hook.
+     */
+    template <Hook H>
+    struct HookTraits;
+
+#define HOOK(Name, ContextType)                                                \
+    template <>                                                                \
+    struct HookTraits<Hook::Name> {                                            \
+        using ContextT = ContextType;                                          \
+        static constexpr auto func = &Plugin::hook_##Name;                     \
+                                                                               \
+        template <typename P>                                                  \
+        static constexpr bool overridden_by() {                                \
+            return !std::is_same_v<decltype(&P::hook_##Name), decltype(func)>; \
+        }                                                                      \
+    };
+    CQHTTP_PLUGIN_HOOKS(HOOK)
+#undef HOOK
 } // namespace cqhttp
@@ -1,6 +1,7 @@
 #include "./async_actions.h"
 
 #include "cqhttp/core/core.h"
+#include "cqhttp/core/helpers.h"
 
 using namespace std;
 
@@ -13,10 +14,14 @@ namespace cqhttp::plugins {
         if (boost::ends_with(ctx.action, suffix)) {
             const auto action = ctx.action.substr(0, ctx.action.length() - suffix_len);
             if (!boost::ends_with(action, suffix)) {
-                const auto ok = app.push_async_task([action, params = ctx.params] {
-                    call_action(action, params);
-                    logging::debug(TAG, u8"成功执行一个异步动作");
-                });
+                // actions on the same target are executed in order, e.g. messages sent to a group
+                const auto ok = app.push_async_task(
+                    [action, params = ctx.params] {
+                        call_action(action, params);
+                        logging::debug(TAG, u8"成功执行一个异步动作");
+                    },
+                    TaskPriority::ACTION,
+                    helpers::get_target_key(ctx.params.raw));
                 if (ok) {
                     logging::debug(TAG, u8"异步动作 " + ctx.action + " 已进入全局线程池等待执行");
                     ctx.result.code = ActionResult::Codes::ASYNC;
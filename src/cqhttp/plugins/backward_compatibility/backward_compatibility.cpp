@@ -15,27 +15,33 @@ namespace cqhttp::plugins {
                 auto &e = static_cast<const cq::MessageEvent &>(ctx.event);
                 if (e.message_type == cq::message::GROUP) {
                     auto &gme = static_cast<const cq::GroupMessageEvent &>(ctx.event);
-                    if (gme.is_anonymous()) {
-                        ctx.data["anonymous"] = gme.anonymous.name;
-                        ctx.data["anonymous_flag"] = gme.anonymous.flag;
-                    } else {
-                        ctx.data["anonymous"] = "";
-                        ctx.data["anonymous_flag"] = "";
-                    }
+                    ctx.payload.patch([&gme](json &data) {
+                        if (gme.is_anonymous()) {
+                            data["anonymous"] = gme.anonymous.name;
+                            data["anonymous_flag"] = gme.anonymous.flag;
+                        } else {
+                            data["anonymous"] = "";
+                            data["anonymous_flag"] = "";
+                        }
+                    });
                 }
                 break;
             }
             case cq::event::NOTICE: {
                 auto &e = static_cast<const cq::NoticeEvent &>(ctx.event);
-                ctx.data["post_type"] = "event";
-                ctx.data["event"] = e.notice_type;
-                ctx.data.erase("notice_type");
+                ctx.payload.patch([&e](json &data) {
+                    data["post_type"] = "event";
+                    data["event"] = e.notice_type;
+                    data.erase("notice_type");
+                });
                 break;
             }
             case cq::event::REQUEST: {
                 auto &e = static_cast<const cq::RequestEvent &>(ctx.event);
-                ctx.data["message"] = e.comment;
-                ctx.data.erase("comment");
+                ctx.payload.patch([&e](json &data) {
+                    data["message"] = e.comment;
+                    data.erase("comment");
+                });
                 break;
             }
             default:
@@ -2,49 +2,61 @@
 
 #include <ctime>
 
+#include "cqhttp/core/info_cache.h"
+
 namespace cqhttp::plugins {
-    void EventDataPatcher::hook_after_event(EventContext<cq::Event> &ctx) {
-        ctx.data["self_id"] = cq::api::get_login_user_id();
-        if (ctx.data.find("time") == ctx.data.end()) {
-            ctx.data["time"] = time(nullptr);
+    using PostType = EventPayload::PostType;
+
+    static json get_sender(const int64_t user_id, const std::optional<int64_t> group_id) {
+        json sender = {
+            {"user_id", user_id},
+        };
+
+        if (group_id) {
+            try {
+                auto info = info_cache::get_group_member_info(*group_id, user_id);
+                sender.update({
+                    {"nickname", info.nickname},
+                    {"card", info.card},
+                    {"sex", info.sex},
+                    {"age", info.age},
+                    {"area", info.area},
+                    {"level", info.level},
+                    {"role", info.role},
+                    {"title", info.title},
+                });
+            } catch (const cq::exception::ApiError &) {
+            }
         }
 
-        if (ctx.data["post_type"] == "message") {
-            json sender = {
-                {"user_id", ctx.data["user_id"]},
-            };
-
-            if (ctx.data["message_type"] == "group") {
-                try {
-                    auto info = cq::api::get_group_member_info(ctx.data["group_id"], ctx.data["user_id"]);
-                    sender.update({
-                        {"nickname", info.nickname},
-                        {"card", info.card},
-                        {"sex", info.sex},
-                        {"age", info.age},
-                        {"area", info.area},
-                        {"level", info.level},
-                        {"role", info.role},
-                        {"title", info.title},
-                    });
-                } catch (const cq::exception::ApiError &) {
-                }
+        if (sender.count("nickname") == 0) {
+            try {
+                auto info = info_cache::get_stranger_info(user_id);
+                sender.update({
+                    {"nickname", info.nickname},
+                    {"sex", info.sex},
+                    {"age", info.age},
+                });
+            } catch (const cq::exception::ApiError &) {
             }
+        }
 
-            if (sender.count("nickname") == 0) {
-                try {
-                    auto info = cq::api::get_stranger_info(ctx.data["user_id"]);
-                    sender.update({
-                        {"nickname", info.nickname},
-                        {"sex", info.sex},
-                        {"age", info.age},
-                    });
-                } catch (const cq::exception::ApiError &) {
-                }
+        return sender;
+    }
+
+    void EventDataPatcher::hook_after_event(EventContext<cq::Event> &ctx) {
+        // the patch (and the api calls for sender info in it) only runs if the jsonified data is really needed
+        ctx.payload.patch([&payload = ctx.payload](json &data) {
+            data["self_id"] = cq::api::get_login_user_id();
+            if (data.find("time") == data.end()) {
+                data["time"] = time(nullptr);
             }
 
-            ctx.data.emplace("sender", sender);
-        }
+            if (payload.post_type() == PostType::MESSAGE && payload.user_id()) {
+                const auto group_id = payload.message_type() == cq::message::GROUP ? payload.group_id() : std::nullopt;
+                data.emplace("sender", get_sender(*payload.user_id(), group_id));
+            }
+        });
 
         ctx.next();
     }
@@ -0,0 +1,90 @@
+#include "./aho_corasick.h"
+
+#include <deque>
+#include <stdexcept>
+
+using namespace std;
+
+namespace cqhttp::plugins {
+    // the root is state 0, so 0 also means "no transition" in the trie
+    static const uint32_t ROOT = 0;
+
+    size_t AhoCorasick::add(const string_view keyword) {
+        if (built_) {
+            throw logic_error("keywords can't be added after the automaton is built");
+        }
+
+        auto state = ROOT;
+        for (const auto c : keyword) {
+            auto &next = next_[state][static_cast<uint8_t>(c)];
+            if (next == ROOT) {
+                next = static_cast<uint32_t>(next_.size());
+                next_.emplace_back();
+                outputs_.emplace_back();
+            }
+            state = next;
+        }
+        outputs_[state].push_back(static_cast<uint32_t>(keyword_count_));
+        return keyword_count_++;
+    }
+
+    void AhoCorasick::build() {
+        if (built_) {
+            return;
+        }
+        built_ = true;
+
+        // breadth first, so that the failure state of each state is done before it
+        vector<uint32_t> fail(next_.size(), ROOT);
+        deque<uint32_t> queue;
+        for (auto &next : next_[ROOT]) {
+            if (next != ROOT) {
+                queue.push_back(next);
+            }
+        }
+        while (!queue.empty()) {
+            const auto state = queue.front();
+            queue.pop_front();
+
+            // a keyword ending at the failure state also ends here, as a suffix (empty ones are reported only once)
+            if (fail[state] != ROOT) {
+                const auto &fail_outputs = outputs_[fail[state]];
+                outputs_[state].insert(outputs_[state].end(), fail_outputs.cbegin(), fail_outputs.cend());
+            }
+
+            for (size_t c = 0; c < 256; c++) {
+                auto &next = next_[state][c];
+                if (next != ROOT) {
+                    fail[next] = next_[fail[state]][c];
+                    queue.push_back(next);
+                } else {
+                    // a missing edge goes where the failure state goes
+                    next = next_[fail[state]][c];
+                }
+            }
+        }
+    }
+
+    void AhoCorasick::search(const string_view text, const function<bool(size_t)> &on_match) const {
+        if (!built_) {
+            throw logic_error("the automaton must be built before searching");
+        }
+
+        // empty keywords
+        for (const auto id : outputs_[ROOT]) {
+            if (!on_match(id)) {
+                return;
+            }
+        }
+
+        auto state = ROOT;
+        for (const auto c : text) {
+            state = next_[state][static_cast<uint8_t>(c)];
+            for (const auto id : outputs_[state]) {
+                if (!on_match(id)) {
+                    return;
+                }
+            }
+        }
+    }
+} // namespace cqhttp::plugins
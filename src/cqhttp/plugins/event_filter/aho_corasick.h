@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cqhttp::plugins {
+    /**
+     * Find which of a set of keywords appear in a text, in one pass over the text.
+     *
+     * The Aho-Corasick automaton is turned into a full DFA on bytes when built, so scanning takes exactly one
+     * table lookup per byte, no matter how many keywords there are.
+     */
+    class AhoCorasick {
+    public:
+        /**
+         * Add a keyword, return its id. Keywords can't be added after "build()".
+         */
+        size_t add(std::string_view keyword);
+
+        void build();
+
+        size_t size() const { return keyword_count_; }
+
+        /**
+         * Call "on_match" with the id of each keyword found in the text, possibly more than once.
+         * Stop scanning as soon as "on_match" returns false.
+         */
+        void search(std::string_view text, const std::function<bool(size_t)> &on_match) const;
+
+    private:
+        std::vector<std::array<uint32_t, 256>> next_{{}}; // the trie before "build()", and the DFA after it
+        std::vector<std::vector<uint32_t>> outputs_{{}}; // keywords ending at each state
+        size_t keyword_count_ = 0;
+        bool built_ = false;
+    };
+} // namespace cqhttp::plugins
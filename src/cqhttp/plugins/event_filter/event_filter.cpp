@@ -9,7 +9,28 @@ namespace fs = std::filesystem;
 namespace cqhttp::plugins {
     static const auto TAG = u8"事件过滤器";
 
+    // keys filled in or changed by EventDataPatcher and MessageEnhancer, after the "before_event" stage
+    static bool available_before_enriching(const string &key) {
+        return key != "self_id" && key != "time" && key != "sender" && key != "message";
+    }
+
+    static void split_filter(const json &filter_json, shared_ptr<Filter> &early_filter, shared_ptr<Filter> &filter) {
+        filter = construct_filter(filter_json);
+        early_filter = nullptr;
+
+        auto exact = false;
+        if (const auto early_json = pushdown_filter(filter_json, available_before_enriching, exact)) {
+            early_filter = construct_filter(*early_json);
+            if (exact) {
+                // all rules are decidable early
+                filter = nullptr;
+            }
+            logging::debug(TAG, exact ? u8"过滤规则将在事件数据补充之前执行" : u8"部分过滤规则将在事件数据补充之前执行");
+        }
+    }
+
     void EventFilter::hook_enable(Context &ctx) {
+        early_filter_ = nullptr;
         filter_ = nullptr;
 
         const auto filter_filename = ctx.config->get_string("event_filter", "");
@@ -17,12 +38,12 @@ namespace cqhttp::plugins {
             // should load and use filter
             const auto path = cq::dir::app() + filter_filename;
             if (const auto ws_path = s2ws(path); fs::is_regular_file(ws_path)) {
-                if (ifstream f(ws_path); f.is_open()) {
+                if (ifstream f{fs::path(ws_path)}; f.is_open()) {
                     try {
                         json filter_json;
                         f >> filter_json;
                         if (filter_json.is_object()) {
-                            filter_ = construct_filter(filter_json);
+                            split_filter(filter_json, early_filter_, filter_);
                             logging::debug(TAG, u8"过滤规则加载成功");
                         } else {
                             logging::error(TAG, u8"过滤规则必须是 JSON 对象");
@@ -37,16 +58,10 @@ namespace cqhttp::plugins {
                 logging::error(TAG, u8"没有找到过滤规则文件 " + filter_filename);
             }
 
-            if (!filter_) {
+            if (!early_filter_ && !filter_) {
                 // we was expecting to load a filter, but failed
                 // so we should block all event by default
-
-                class BlockAllFilter : public Filter {
-                public:
-                    bool eval(const json &) override { return false; }
-                };
-
-                filter_ = make_shared<BlockAllFilter>();
+                early_filter_ = make_shared<Filter>(Filter::block_all());
                 logging::warning(TAG, u8"过滤规则加载失败，将暂停所有事件上报");
             }
         }
@@ -55,13 +70,23 @@ namespace cqhttp::plugins {
     }
 
     void EventFilter::hook_disable(Context &ctx) {
+        early_filter_ = nullptr;
         filter_ = nullptr;
         ctx.next();
     }
 
+    void EventFilter::hook_before_event(EventContext<cq::Event> &ctx) {
+        // drop the event before the sender info is fetched and the images are enhanced, if the filter allows
+        if (early_filter_ && !early_filter_->eval(ctx.payload.const_data())) {
+            ctx.payload.drop();
+            return;
+        }
+        ctx.next();
+    }
+
     void EventFilter::hook_after_event(EventContext<cq::Event> &ctx) {
         // use hook_after_event here because we want it to work just before the web things
-        if (!filter_ || filter_->eval(ctx.data)) {
+        if (!filter_ || filter_->eval(ctx.payload.const_data())) {
             // filter not used, or filter passed
             ctx.next();
         }
@@ -9,9 +9,13 @@ namespace cqhttp::plugins {
         std::string name() const override { return "event_filter"; }
         void hook_enable(Context &ctx) override;
         void hook_disable(Context &ctx) override;
+        void hook_before_event(EventContext<cq::Event> &ctx) override;
         void hook_after_event(EventContext<cq::Event> &ctx) override;
 
     private:
+        // the rules decidable from the raw event, checked before it's enriched (null if there are none)
+        std::shared_ptr<Filter> early_filter_;
+        // the whole rules, checked at last (null if the early filter already decides)
         std::shared_ptr<Filter> filter_;
     };
 
@@ -1,38 +1,137 @@
 #include "./filter.h"
 
-#include <regex>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string_view>
 
 using namespace std;
 
 namespace cqhttp::plugins {
-    static shared_ptr<Filter> construct_op(const string &op_name, const json &op_argument);
+    using Opcode = Filter::Opcode;
+    using Instruction = Filter::Instruction;
 
-    class NotOperator : public Filter {
+    class FilterCompiler {
     public:
-        static shared_ptr<NotOperator> construct(const json &argument) {
-            if (!argument.is_object()) {
-                throw FilterSyntexError("the argument of 'not' operator must be an object");
+        explicit FilterCompiler(Filter &filter) : filter_(filter) {}
+
+        void compile_op(const string &op_name, const json &argument, const uint8_t reg) {
+            static const map<string, void (FilterCompiler::*)(const json &, uint8_t)> op_compiler_map = {
+                {"not", &FilterCompiler::compile_not},
+                {"and", &FilterCompiler::compile_and},
+                {"or", &FilterCompiler::compile_or},
+                {"eq", &FilterCompiler::compile_eq},
+                {"neq", &FilterCompiler::compile_neq},
+                {"in", &FilterCompiler::compile_in},
+                {"contains", &FilterCompiler::compile_contains},
+                {"regex", &FilterCompiler::compile_regex},
+            };
+
+            const auto it = op_compiler_map.find(op_name);
+            if (it == op_compiler_map.end()) {
+                throw FilterSyntexError("the operator '" + op_name + "' is not supported");
             }
-            auto op = make_shared<NotOperator>();
-            op->operand_ = construct_op("and", argument);
-            return op;
+            (this->*it->second)(argument, reg);
         }
 
-        bool eval(const json &payload) override { return !operand_->eval(payload); }
+        /**
+         * Let jumps go straight to where they end up, skipping the jumps they would take or skip next.
+         */
+        void thread_jumps() {
+            auto &code = filter_.code_;
+            for (auto &ins : code) {
+                if (ins.opcode != Opcode::JUMP_IF_FALSE && ins.opcode != Opcode::JUMP_IF_TRUE
+                    && ins.opcode != Opcode::LOAD_FIELD) {
+                    continue;
+                }
+                // the accumulator is known when the jump is taken, and all jumps go forward
+                const auto acc = ins.opcode == Opcode::JUMP_IF_TRUE;
+                auto target = ins.target;
+                while (target < code.size()) {
+                    const auto &next = code[target];
+                    if (next.opcode == Opcode::JUMP_IF_FALSE) {
+                        target = acc ? target + 1 : next.target;
+                    } else if (next.opcode == Opcode::JUMP_IF_TRUE) {
+                        target = acc ? next.target : target + 1;
+                    } else {
+                        break;
+                    }
+                }
+                ins.target = target;
+            }
+        }
+
+        /**
+         * Build the automatons, and give each rule on text its bit in the matches.
+         */
+        void finish() {
+            size_t bit = 0;
+            for (auto &field : filter_.text_fields_) {
+                field.keywords.build();
+                field.first_bit = bit;
+                bit += 1 + field.keywords.size() + field.regexes.size();
+            }
+            filter_.match_bits_ = bit;
+
+            for (auto &ins : filter_.code_) {
+                if (ins.opcode == Opcode::MATCH) {
+                    const auto &field = filter_.text_fields_[ins.arg];
+                    const auto id = ins.target & ~REGEX_FLAG;
+                    ins.target = static_cast<uint32_t>(field.first_bit + 1 + id
+                                                       + (ins.target & REGEX_FLAG ? field.keywords.size() : 0));
+                }
+            }
+        }
 
     private:
-        shared_ptr<Filter> operand_;
-    };
+        Filter &filter_;
+        unordered_map<string, uint32_t> key_indices_;
+        vector<string> path_; // keys from the event to the value being compiled for
+        map<vector<string>, uint32_t> text_field_indices_;
 
-    class AndOperator : public Filter {
-    public:
-        static shared_ptr<AndOperator> construct(const json &argument) {
+        // before "finish()", the target of MATCH is the id in the keyword automaton or (with this flag) the NFA
+        static const uint32_t REGEX_FLAG = 0x80000000;
+
+        size_t emit(const Opcode opcode, const uint8_t src = 0, const uint32_t arg = 0) {
+            filter_.code_.push_back(Instruction{opcode, src, 0, arg, 0});
+            return filter_.code_.size() - 1;
+        }
+
+        void patch(const size_t index) { filter_.code_[index].target = static_cast<uint32_t>(filter_.code_.size()); }
+
+        uint32_t intern_key(const string &key) {
+            const auto [it, inserted] = key_indices_.try_emplace(key, static_cast<uint32_t>(filter_.keys_.size()));
+            if (inserted) {
+                filter_.keys_.push_back(key);
+            }
+            return it->second;
+        }
+
+        uint32_t add_constant(const json &value) {
+            filter_.constants_.push_back(value);
+            return static_cast<uint32_t>(filter_.constants_.size() - 1);
+        }
+
+        uint32_t add_string(const json &value) {
+            filter_.strings_.push_back(value.get<string>());
+            return static_cast<uint32_t>(filter_.strings_.size() - 1);
+        }
+
+        void compile_not(const json &argument, const uint8_t reg) {
             if (!argument.is_object()) {
-                throw FilterSyntexError("the argument of 'and' operator must be an object");
+                throw FilterSyntexError("the argument of 'not' operator must be an object");
             }
+            compile_and(argument, reg);
+            emit(Opcode::NOT);
+        }
 
-            auto op = make_shared<AndOperator>();
+        void compile_and(const json &argument, const uint8_t reg) {
+            if (!argument.is_object()) {
+                throw FilterSyntexError("the argument of 'and' operator must be an object");
+            }
 
+            vector<size_t> exits;
+            auto empty = true;
             for (auto it = argument.begin(); it != argument.end(); ++it) {
                 const auto &key = it.key();
                 const auto &value = it.value();
@@ -40,211 +139,437 @@ namespace cqhttp::plugins {
                 if (key.empty()) {
                     continue;
                 }
+                if (!empty) {
+                    exits.push_back(emit(Opcode::JUMP_IF_FALSE));
+                }
+                empty = false;
 
                 if (key.front() == '.') {
                     // is an operator
                     //   ".foo": {
                     //       "bar": "baz"
                     //   }
-                    op->operands_.push_back({"", construct_op(key.substr(1), value)});
-                } else if (value.is_object()) {
+                    compile_op(key.substr(1), value, reg);
+                    continue;
+                }
+
+                if (static_cast<size_t>(reg) + 1 >= Filter::MAX_DEPTH) {
+                    throw FilterSyntexError("the filter is nested too deeply");
+                }
+                const auto sub_reg = static_cast<uint8_t>(reg + 1);
+
+                const auto load = emit(Opcode::LOAD_FIELD, reg, intern_key(key));
+                filter_.code_[load].dst = sub_reg;
+                path_.push_back(key);
+                if (value.is_object()) {
                     // is an normal key with an object as the value
                     //   "foo": {
                     //       ".bar": "baz"
                     //   }
-                    op->operands_.push_back({key, construct_op("and", value)});
+                    compile_and(value, sub_reg);
                 } else {
                     // is an normal key with a non-object as the value
                     //   "foo": "bar"
-                    op->operands_.push_back({key, construct_op("eq", value)});
+                    compile_eq(value, sub_reg);
                 }
+                path_.pop_back();
+                // a missing key fails this operand
+                patch(load);
             }
 
-            return op;
+            if (empty) {
+                emit(Opcode::SET, 0, 1);
+            }
+            for (const auto exit : exits) {
+                patch(exit);
+            }
         }
 
-        bool eval(const json &payload) override {
-            auto res = true;
-
-            for (const auto &operand : operands_) {
-                if (operand.first.empty()) {
-                    // is an operator
-                    res = res && operand.second->eval(payload);
-                } else {
-                    // is an normal key
-                    try {
-                        auto &sub_payload = payload.at(operand.first);
-                        res = res && operand.second->eval(sub_payload);
-                    } catch (exception &) {
-                        res = false;
-                    }
-                }
+        void compile_or(const json &argument, const uint8_t reg) {
+            if (!argument.is_array()) {
+                throw FilterSyntexError("the argument of 'or' operator must be an array");
+            }
 
-                if (res == false) {
-                    break;
+            vector<size_t> exits;
+            for (size_t i = 0; i < argument.size(); i++) {
+                if (i > 0) {
+                    exits.push_back(emit(Opcode::JUMP_IF_TRUE));
                 }
+                compile_and(argument[i], reg);
             }
 
-            return res;
+            if (argument.empty()) {
+                emit(Opcode::SET, 0, 0);
+            }
+            for (const auto exit : exits) {
+                patch(exit);
+            }
         }
 
-    private:
-        vector<pair<string, shared_ptr<Filter>>> operands_;
-    };
-
-    class OrOperator : public Filter {
-    public:
-        static shared_ptr<OrOperator> construct(const json &argument) {
-            if (!argument.is_array()) {
-                throw FilterSyntexError("the argument of 'or' operator must be an array");
+        uint32_t text_field() {
+            const auto [it, inserted] =
+                text_field_indices_.try_emplace(path_, static_cast<uint32_t>(filter_.text_fields_.size()));
+            if (inserted) {
+                filter_.text_fields_.emplace_back();
+                filter_.text_fields_.back().path = path_;
             }
+            return it->second;
+        }
 
-            auto op = make_shared<OrOperator>();
+        void compile_keyword(const string &keyword, const uint8_t reg) {
+            const auto field = text_field();
+            const auto id = filter_.text_fields_[field].keywords.add(keyword);
+            filter_.code_[emit(Opcode::MATCH, reg, field)].target = static_cast<uint32_t>(id);
+        }
 
-            for (auto &elem : argument) {
-                op->operands_.push_back(construct_op("and", elem));
-            }
+        void compile_eq(const json &argument, const uint8_t reg) { emit(Opcode::EQ, reg, add_constant(argument)); }
 
-            return op;
-        }
+        void compile_neq(const json &argument, const uint8_t reg) { emit(Opcode::NEQ, reg, add_constant(argument)); }
 
-        bool eval(const json &payload) override {
-            auto res = false;
+        void compile_in(const json &argument, const uint8_t reg) {
+            if (argument.is_string()) {
+                emit(Opcode::IN_STRING, reg, add_string(argument));
+                return;
+            }
+            if (!argument.is_array()) {
+                throw FilterSyntexError("the argument of 'in' operator must be a string or an array");
+            }
 
-            for (const auto &operand : operands_) {
-                res = res || operand->eval(payload);
+            if (!argument.empty()
+                && all_of(argument.begin(), argument.end(), [](const json &elem) { return elem.is_string(); })) {
+                compile_in_strings(argument, reg);
+                return;
+            }
 
-                if (res == true) {
+            // lists of ids are the most common, which can be searched much faster
+            vector<int64_t> integers;
+            for (const auto &elem : argument) {
+                if (elem.is_number_integer() && !(elem.is_number_unsigned() && elem.get<uint64_t>() > INT64_MAX)) {
+                    integers.push_back(elem.get<int64_t>());
+                } else {
                     break;
                 }
             }
-
-            return res;
+            if (!argument.empty() && integers.size() == argument.size()) {
+                sort(integers.begin(), integers.end());
+                filter_.integer_sets_.push_back(move(integers));
+                emit(Opcode::IN_INTEGERS, reg, static_cast<uint32_t>(filter_.integer_sets_.size() - 1));
+            } else {
+                emit(Opcode::IN_ARRAY, reg, add_constant(argument));
+            }
         }
 
-    private:
-        vector<shared_ptr<Filter>> operands_;
-    };
+        void compile_in_strings(const json &argument, const uint8_t reg) {
+            vector<string> strings;
+            for (const auto &elem : argument) {
+                strings.push_back(elem.get<string>());
+            }
+            sort(strings.begin(), strings.end());
+            filter_.string_sets_.push_back(move(strings));
+            emit(Opcode::IN_STRINGS, reg, static_cast<uint32_t>(filter_.string_sets_.size() - 1));
+        }
 
-    class EqualOperator : public Filter {
-    public:
-        static shared_ptr<EqualOperator> construct(const json &argument) {
-            auto op = make_shared<EqualOperator>();
-            op->value_ = argument;
-            return op;
+        void compile_contains(const json &argument, const uint8_t reg) {
+            if (!argument.is_string()) {
+                throw FilterSyntexError("the argument of 'contains' operator must be a string");
+            }
+            compile_keyword(argument.get<string>(), reg);
         }
 
-        bool eval(const json &payload) override { return payload == value_; }
+        void compile_regex(const json &argument, const uint8_t reg) {
+            if (!argument.is_string()) {
+                throw FilterSyntexError("the argument of 'regex' operator must be a string");
+            }
+            const auto pattern = argument.get<string>();
+
+            // std::regex still decides what is valid, as it used to
+            regex std_regex;
+            try {
+                std_regex = regex(pattern);
+            } catch (regex_error &e) {
+                throw FilterSyntexError(string("the argument of 'regex' operator is not a valid regex: ") + e.what());
+            }
 
-    private:
-        json value_;
-    };
+            if (pattern.find_first_of("\\^$.|?*+()[]{}") == string::npos) {
+                // plain text, e.g. "通知"
+                compile_keyword(pattern, reg);
+                return;
+            }
 
-    class NotEqualOperator : public Filter {
-    public:
-        static shared_ptr<NotEqualOperator> construct(const json &argument) {
-            auto op = make_shared<NotEqualOperator>();
-            op->value_ = argument;
-            return op;
+            const auto field = text_field();
+            try {
+                const auto id = filter_.text_fields_[field].regexes.add(pattern);
+                filter_.code_[emit(Opcode::MATCH, reg, field)].target = static_cast<uint32_t>(id) | REGEX_FLAG;
+            } catch (MultiRegex::Unsupported &) {
+                // backreferences or lookaheads, which only a backtracking engine can do
+                filter_.regexes_.push_back(move(std_regex));
+                emit(Opcode::REGEX, reg, static_cast<uint32_t>(filter_.regexes_.size() - 1));
+            }
         }
+    };
 
-        bool eval(const json &payload) override { return payload != value_; }
+    Filter Filter::compile(const json &root_filter) {
+        Filter filter;
+        FilterCompiler compiler(filter);
+        compiler.compile_op("and", root_filter, 0);
+        compiler.thread_jumps();
+        compiler.finish();
+        return filter;
+    }
 
-    private:
-        json value_;
-    };
+    Filter Filter::block_all() {
+        Filter filter;
+        filter.code_.push_back(Instruction{Opcode::SET, 0, 0, 0, 0});
+        return filter;
+    }
 
-    class InOperator : public Filter {
-    public:
-        static shared_ptr<InOperator> construct(const json &argument) {
-            if (!(argument.is_string() || argument.is_array())) {
-                throw FilterSyntexError("the argument of 'in' operator must be a string or an array");
+    static const string *string_of(const json &value) {
+        return value.is_string() ? value.get_ptr<const string *>() : nullptr;
+    }
+
+    static bool integer_set_contains(const vector<int64_t> &set, const json &value) {
+        int64_t integer;
+        if (value.is_number_unsigned()) {
+            const auto u = value.get<uint64_t>();
+            if (u > INT64_MAX) {
+                return false;
             }
+            integer = static_cast<int64_t>(u);
+        } else if (value.is_number_integer()) {
+            integer = value.get<int64_t>();
+        } else if (value.is_number_float()) {
+            // equal to an integer only if it has no fractional part
+            const auto f = value.get<double>();
+            if (!(trunc(f) == f && f >= -9.2e18 && f <= 9.2e18)) {
+                return false;
+            }
+            integer = static_cast<int64_t>(f);
+        } else {
+            return false;
+        }
+        return binary_search(set.begin(), set.end(), integer);
+    }
 
-            auto op = make_shared<InOperator>();
-            op->range_ = argument;
-            return op;
+    static bool regex_matches(const regex &re, const string &input) noexcept {
+        try {
+            return regex_search(input.cbegin(), input.cend(), re);
+        } catch (...) {
+            // e.g. the input is too complex for the regex engine
+            return false;
         }
+    }
 
-        bool eval(const json &payload) override {
-            if (range_.is_string()) {
-                return payload.is_string() && boost::algorithm::contains(range_.get<string>(), payload.get<string>());
+    static bool test_bit(const vector<uint64_t> &bits, const size_t bit) { return bits[bit / 64] >> bit % 64 & 1; }
+
+    static void set_bit(vector<uint64_t> &bits, const size_t bit) { bits[bit / 64] |= uint64_t(1) << bit % 64; }
+
+    bool Filter::match(const TextField &field, const json &value, const uint32_t bit, vector<uint64_t> &bits) const
+        noexcept {
+        if (!test_bit(bits, field.first_bit)) {
+            set_bit(bits, field.first_bit);
+            if (const auto str = string_of(value)) {
+                // packed, so that the callbacks fit in std::function without allocating
+                struct {
+                    vector<uint64_t> &bits;
+                    size_t first_keyword_bit, first_regex_bit, keywords_left;
+                } scan{bits, field.first_bit + 1, field.first_bit + 1 + field.keywords.size(), field.keywords.size()};
+
+                if (scan.keywords_left > 0) {
+                    field.keywords.search(*str, [&scan](const size_t id) {
+                        if (!test_bit(scan.bits, scan.first_keyword_bit + id)) {
+                            set_bit(scan.bits, scan.first_keyword_bit + id);
+                            scan.keywords_left--;
+                        }
+                        return scan.keywords_left > 0;
+                    });
+                }
+                field.regexes.search(*str, [&scan](const size_t id) {
+                    set_bit(scan.bits, scan.first_regex_bit + id);
+                    return true;
+                });
             }
-
-            return find(range_.begin(), range_.end(), payload) != range_.end();
         }
+        return test_bit(bits, bit);
+    }
 
-    private:
-        json range_;
-    };
-
-    class ContainsOperator : public Filter {
-    public:
-        static shared_ptr<ContainsOperator> construct(const json &argument) {
-            if (!argument.is_string()) {
-                throw FilterSyntexError("the argument of 'contains' operator must be a string");
-            }
+    bool Filter::eval(const json &payload) const noexcept {
+        const json *regs[MAX_DEPTH];
+        regs[0] = &payload;
+        auto acc = true;
 
-            auto op = make_shared<ContainsOperator>();
-            op->test_ = argument;
-            return op;
+        // which text fields are scanned, and which rules on them match, reused to avoid allocating
+        thread_local vector<uint64_t> match_bits;
+        if (match_bits_ > 0) {
+            match_bits.assign((match_bits_ + 63) / 64, 0);
         }
 
-        bool eval(const json &payload) override {
-            if (!payload.is_string()) {
-                return false;
+        const auto size = code_.size();
+        for (size_t pc = 0; pc < size; pc++) {
+            const auto &ins = code_[pc];
+            switch (ins.opcode) {
+            case Opcode::SET:
+                acc = ins.arg != 0;
+                break;
+            case Opcode::NOT:
+                acc = !acc;
+                break;
+            case Opcode::JUMP_IF_FALSE:
+                if (!acc) {
+                    pc = ins.target - 1;
+                }
+                break;
+            case Opcode::JUMP_IF_TRUE:
+                if (acc) {
+                    pc = ins.target - 1;
+                }
+                break;
+            case Opcode::LOAD_FIELD: {
+                const auto object = regs[ins.src]->get_ptr<const json::object_t *>();
+                if (object) {
+                    if (const auto it = object->find(keys_[ins.arg]); it != object->end()) {
+                        regs[ins.dst] = &it->second;
+                        break;
+                    }
+                }
+                acc = false;
+                pc = ins.target - 1;
+                break;
+            }
+            case Opcode::EQ:
+                acc = *regs[ins.src] == constants_[ins.arg];
+                break;
+            case Opcode::NEQ:
+                acc = *regs[ins.src] != constants_[ins.arg];
+                break;
+            case Opcode::IN_ARRAY: {
+                const auto &range = constants_[ins.arg];
+                acc = find(range.begin(), range.end(), *regs[ins.src]) != range.end();
+                break;
+            }
+            case Opcode::IN_INTEGERS:
+                acc = integer_set_contains(integer_sets_[ins.arg], *regs[ins.src]);
+                break;
+            case Opcode::IN_STRINGS: {
+                const auto str = string_of(*regs[ins.src]);
+                const auto &set = string_sets_[ins.arg];
+                acc = str && binary_search(set.begin(), set.end(), *str);
+                break;
+            }
+            case Opcode::IN_STRING: {
+                const auto str = string_of(*regs[ins.src]);
+                acc = str && string_view(strings_[ins.arg]).find(*str) != string_view::npos;
+                break;
+            }
+            case Opcode::MATCH:
+                acc = match(text_fields_[ins.arg], *regs[ins.src], ins.target, match_bits);
+                break;
+            case Opcode::REGEX: {
+                const auto str = string_of(*regs[ins.src]);
+                acc = str && regex_matches(regexes_[ins.arg], *str);
+                break;
+            }
             }
-            return boost::algorithm::contains(payload.get<string>(), test_.get<string>());
         }
+        return acc;
+    }
 
-    private:
-        json test_;
-    };
+    string Filter::disassemble() const {
+        static const char *const names[] = {
+            "SET", "NOT", "JUMP_IF_FALSE", "JUMP_IF_TRUE", "LOAD_FIELD", "EQ",
+            "NEQ", "IN_ARRAY", "IN_INTEGERS", "IN_STRINGS", "IN_STRING", "MATCH", "REGEX",
+        };
 
-    class RegexOperator : public Filter {
-    public:
-        static shared_ptr<RegexOperator> construct(const json &argument) {
-            if (!argument.is_string()) {
-                throw FilterSyntexError("the argument of 'regex' operator must be a string");
+        stringstream ss;
+        for (size_t pc = 0; pc < code_.size(); pc++) {
+            const auto &ins = code_[pc];
+            ss << pc << "\t" << names[static_cast<size_t>(ins.opcode)];
+            switch (ins.opcode) {
+            case Opcode::SET:
+                ss << " " << ins.arg;
+                break;
+            case Opcode::NOT:
+                break;
+            case Opcode::JUMP_IF_FALSE:
+            case Opcode::JUMP_IF_TRUE:
+                ss << " -> " << ins.target;
+                break;
+            case Opcode::LOAD_FIELD:
+                ss << " r" << +ins.dst << " = r" << +ins.src << "[\"" << keys_[ins.arg] << "\"] else -> " << ins.target;
+                break;
+            case Opcode::EQ:
+            case Opcode::NEQ:
+            case Opcode::IN_ARRAY:
+                ss << " r" << +ins.src << ", " << constants_[ins.arg].dump();
+                break;
+            case Opcode::IN_INTEGERS:
+                ss << " r" << +ins.src << ", " << json(integer_sets_[ins.arg]).dump();
+                break;
+            case Opcode::IN_STRINGS:
+                ss << " r" << +ins.src << ", " << json(string_sets_[ins.arg]).dump();
+                break;
+            case Opcode::IN_STRING:
+                ss << " r" << +ins.src << ", " << json(strings_[ins.arg]).dump();
+                break;
+            case Opcode::MATCH:
+                ss << " r" << +ins.src << ", " << json(text_fields_[ins.arg].path).dump() << " bit " << ins.target;
+                break;
+            case Opcode::REGEX:
+                ss << " r" << +ins.src << ", regexes[" << ins.arg << "]";
+                break;
             }
-
-            auto op = make_shared<RegexOperator>();
-            op->regex_ = regex(argument.get<string>());
-            return op;
+            ss << "\n";
         }
+        return ss.str();
+    }
 
-        bool eval(const json &payload) override {
-            if (!payload.is_string()) {
-                return false;
-            }
-
-            smatch m;
-            const auto input = payload.get<string>();
-            return regex_search(input.cbegin(), input.cend(), m, regex_);
-        }
+    shared_ptr<Filter> construct_filter(const json &root_filter) {
+        return make_shared<Filter>(Filter::compile(root_filter));
+    }
 
-    private:
-        regex regex_;
-    };
+    static json pushdown_and(const json &rules, const function<bool(const string &)> &available, const bool negated,
+                             bool &exact, size_t &key_count) {
+        // replacing a rule with "false" makes its parent "and" fail as a whole
+        static const json FALSE = {{".not", json::object()}};
 
-    static shared_ptr<Filter> construct_op(const string &op_name, const json &op_argument) {
-        static const map<string, function<shared_ptr<Filter>(const json &)>> op_constructor_map = {
-            {"not", NotOperator::construct},
-            {"and", AndOperator::construct},
-            {"or", OrOperator::construct},
-            {"eq", EqualOperator::construct},
-            {"neq", NotEqualOperator::construct},
-            {"in", InOperator::construct},
-            {"contains", ContainsOperator::construct},
-            {"regex", RegexOperator::construct},
-        };
+        auto result = json::object();
+        for (auto it = rules.begin(); it != rules.end(); ++it) {
+            const auto &key = it.key();
+            const auto &value = it.value();
 
-        if (op_constructor_map.find(op_name) == op_constructor_map.end()) {
-            throw FilterSyntexError("the operator '" + op_name + "'" + "is not supported");
+            if (key.empty()) {
+                continue;
+            }
+            if (key == ".and" || key == ".not") {
+                result[key] = pushdown_and(value, available, negated != (key == ".not"), exact, key_count);
+            } else if (key == ".or") {
+                auto operands = json::array();
+                for (const auto &operand : value) {
+                    operands.push_back(pushdown_and(operand, available, negated, exact, key_count));
+                }
+                result[key] = move(operands);
+            } else if (key.front() != '.' && available(key)) {
+                result[key] = value;
+                key_count++;
+            } else {
+                // a rule on a key not available yet, or on the event as a whole,
+                // is assumed to be whatever lets more events pass
+                exact = false;
+                if (negated) {
+                    return FALSE;
+                }
+            }
         }
-
-        return op_constructor_map.at(op_name)(op_argument);
+        return result;
     }
 
-    shared_ptr<Filter> construct_filter(const json &root_filter) { return construct_op("and", root_filter); }
+    optional<json> pushdown_filter(const json &root_filter, const function<bool(const string &)> &available,
+                                   bool &exact) {
+        exact = true;
+        size_t key_count = 0;
+        auto rules = pushdown_and(root_filter, available, false, exact, key_count);
+        if (key_count == 0) {
+            return nullopt;
+        }
+        return rules;
+    }
 } // namespace cqhttp::plugins
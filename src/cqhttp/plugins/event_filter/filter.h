@@ -1,12 +1,96 @@
 #pragma once
 
-#include "cqhttp/core/plugin.h"
+#include "cqhttp/core/common.h"
+
+#include <regex>
+
+#include "cqhttp/plugins/event_filter/aho_corasick.h"
+#include "cqhttp/plugins/event_filter/regex.h"
 
 namespace cqhttp::plugins {
+    /**
+     * A filter compiled into a flat program.
+     *
+     * The program runs on a small interpreter with a boolean accumulator and a few value registers, each holding
+     * the part of the event that a nested rule works on. "and", "or" and missing keys jump past the rest of the
+     * rules as soon as the result is known. Field names, constants and regexes live in tables indexed by the
+     * instructions, so evaluating never throws.
+     *
+     * All "contains" and "regex" rules on the same field are matched together: the first time one of them runs,
+     * the text is scanned once by a keyword automaton and a regex NFA, and which rules match is remembered for the
+     * rest of the evaluation.
+     */
     class Filter {
     public:
-        virtual ~Filter() = default;
-        virtual bool eval(const json &payload) = 0;
+        enum class Opcode : uint8_t {
+            SET, // acc = arg
+            NOT, // acc = !acc
+            JUMP_IF_FALSE, // if !acc, goto target
+            JUMP_IF_TRUE, // if acc, goto target
+            LOAD_FIELD, // reg[dst] = reg[src][keys[arg]], or acc = false and goto target if there is no such key
+            EQ, // acc = reg[src] == constants[arg]
+            NEQ, // acc = reg[src] != constants[arg]
+            IN_ARRAY, // acc = constants[arg] (an array) contains reg[src]
+            IN_INTEGERS, // same as IN_ARRAY, for arrays of integers only, with integer_sets[arg] sorted for search
+            IN_STRINGS, // same as IN_ARRAY, for arrays of strings only, with string_sets[arg] sorted for search
+            IN_STRING, // acc = reg[src] is a substring of strings[arg]
+            MATCH, // acc = rule "target" of text_fields[arg] matches reg[src], "target" being a bit of the matches
+            REGEX, // acc = regexes[arg] matches part of reg[src], for regexes the NFA doesn't support
+        };
+
+        struct Instruction {
+            Opcode opcode;
+            uint8_t src;
+            uint8_t dst;
+            uint32_t arg;
+            uint32_t target;
+        };
+
+        /**
+         * The "contains" and "regex" rules on a field, that is, a path of keys from the event.
+         */
+        struct TextField {
+            std::vector<std::string> path;
+            AhoCorasick keywords;
+            MultiRegex regexes;
+            size_t first_bit; // the "scanned" flag, followed by a bit for each keyword and then each regex
+        };
+
+        // the registers live on the stack of "eval()", one for each level of nested keys
+        static constexpr size_t MAX_DEPTH = 64;
+
+        /**
+         * Compile the filter rules. Throw FilterSyntexError if the rules are invalid.
+         */
+        static Filter compile(const json &root_filter);
+
+        /**
+         * A filter that blocks all events.
+         */
+        static Filter block_all();
+
+        bool eval(const json &payload) const noexcept;
+
+        /**
+         * Dump the program in a human readable form, for debugging.
+         */
+        std::string disassemble() const;
+
+    private:
+        std::vector<Instruction> code_;
+        std::vector<std::string> keys_;
+        std::vector<json> constants_;
+        std::vector<std::vector<int64_t>> integer_sets_;
+        std::vector<std::vector<std::string>> string_sets_;
+        std::vector<std::string> strings_;
+        std::vector<TextField> text_fields_;
+        std::vector<std::regex> regexes_;
+        size_t match_bits_ = 0;
+
+        bool match(const TextField &field, const json &value, uint32_t bit, std::vector<uint64_t> &bits) const
+            noexcept;
+
+        friend class FilterCompiler;
     };
 
     struct FilterSyntexError : std::invalid_argument {
@@ -14,4 +98,15 @@ namespace cqhttp::plugins {
     };
 
     std::shared_ptr<Filter> construct_filter(const json &root_filter);
+
+    /**
+     * Derive from (valid) filter rules the ones that only refer to keys of the event satisfying "available", so
+     * that they can run before the other keys are filled in.
+     *
+     * Rules on other keys are assumed to pass (or to fail, under "not"), so every event passing the original rules
+     * also passes the derived ones. "exact" is set to false if anything was assumed, otherwise the derived rules are
+     * just the original ones. Return null if the derived rules refer to no key at all, that is, they decide nothing.
+     */
+    std::optional<json> pushdown_filter(const json &root_filter,
+                                        const std::function<bool(const std::string &)> &available, bool &exact);
 } // namespace cqhttp::plugins
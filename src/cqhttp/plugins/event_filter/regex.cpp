@@ -0,0 +1,698 @@
+#include "./regex.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace cqhttp::plugins {
+    using Opcode = MultiRegex::Opcode;
+    using Instruction = MultiRegex::Instruction;
+    using CharClass = MultiRegex::CharClass;
+
+    static const uint32_t MAX_BYTE = 0xFF;
+    static const size_t MAX_INSTRUCTIONS = 100000;
+    static const int MAX_REPEAT = 1000;
+
+    static bool is_word_byte(const char c) { return isalnum(static_cast<uint8_t>(c)) || c == '_'; }
+
+    static bool is_line_terminator(const uint8_t byte) { return byte == '\n' || byte == '\r'; }
+
+    using Ranges = vector<pair<uint32_t, uint32_t>>;
+
+    static Ranges normalize(Ranges ranges) {
+        sort(ranges.begin(), ranges.end());
+        Ranges result;
+        for (const auto &r : ranges) {
+            if (!result.empty() && r.first <= result.back().second + 1) {
+                result.back().second = max(result.back().second, r.second);
+            } else {
+                result.push_back(r);
+            }
+        }
+        return result;
+    }
+
+    static Ranges complement(const Ranges &ranges) {
+        Ranges result;
+        uint32_t next = 0;
+        for (const auto &r : normalize(ranges)) {
+            if (r.first > next) {
+                result.emplace_back(next, r.first - 1);
+            }
+            next = r.second + 1;
+        }
+        if (next <= MAX_BYTE) {
+            result.emplace_back(next, MAX_BYTE);
+        }
+        return result;
+    }
+
+    // the classes of "\d", "\w" and "\s" of std::regex in the "C" locale
+    static const Ranges DIGIT_RANGES = {{'0', '9'}};
+    static const Ranges WORD_RANGES = {{'0', '9'}, {'A', 'Z'}, {'_', '_'}, {'a', 'z'}};
+    static const Ranges SPACE_RANGES = {{'\t', '\r'}, {' ', ' '}};
+
+    struct Node {
+        enum Kind {
+            EMPTY,
+            CHAR,
+            ANY,
+            CLASS,
+            BEGIN,
+            END,
+            WORD_BOUNDARY,
+            NOT_WORD_BOUNDARY,
+            CONCAT,
+            ALTERNATE,
+            REPEAT,
+        };
+
+        Kind kind = EMPTY;
+        uint32_t value = 0; // the byte of CHAR, or the index of CLASS
+        int min = 0, max = 0; // of REPEAT, a negative max means unlimited
+        vector<Node> children;
+
+        bool is_assertion() const { return kind >= BEGIN && kind <= NOT_WORD_BOUNDARY; }
+    };
+
+    class RegexParser {
+    public:
+        RegexParser(MultiRegex &regex, const string_view pattern) : regex_(regex) {
+            for (const auto c : pattern) {
+                bytes_.push_back(static_cast<uint8_t>(c));
+            }
+        }
+
+        Node parse() {
+            auto node = parse_alternation();
+            if (pos_ < bytes_.size()) {
+                throw MultiRegex::Unsupported("unmatched ')'");
+            }
+            return node;
+        }
+
+        void emit(const Node &node) {
+            auto &code = regex_.code_;
+            if (code.size() > MAX_INSTRUCTIONS) {
+                throw MultiRegex::Unsupported("the regex is too large");
+            }
+
+            switch (node.kind) {
+            case Node::EMPTY:
+                break;
+            case Node::CHAR:
+                code.push_back({Opcode::CHAR, node.value, 0});
+                break;
+            case Node::ANY:
+                code.push_back({Opcode::ANY, 0, 0});
+                break;
+            case Node::CLASS:
+                code.push_back({Opcode::CLASS, node.value, 0});
+                break;
+            case Node::BEGIN:
+                code.push_back({Opcode::ASSERT_BEGIN, 0, 0});
+                break;
+            case Node::END:
+                code.push_back({Opcode::ASSERT_END, 0, 0});
+                break;
+            case Node::WORD_BOUNDARY:
+                code.push_back({Opcode::ASSERT_WORD_BOUNDARY, 0, 0});
+                break;
+            case Node::NOT_WORD_BOUNDARY:
+                code.push_back({Opcode::ASSERT_NOT_WORD_BOUNDARY, 0, 0});
+                break;
+            case Node::CONCAT:
+                for (const auto &child : node.children) {
+                    emit(child);
+                }
+                break;
+            case Node::ALTERNATE: {
+                //     SPLIT L1, L2
+                // L1: child 1
+                //     JUMP end
+                // L2: SPLIT L3, L4
+                // ...
+                vector<size_t> jumps;
+                for (size_t i = 0; i + 1 < node.children.size(); i++) {
+                    const auto split = code.size();
+                    code.push_back({Opcode::SPLIT, static_cast<uint32_t>(split + 1), 0});
+                    emit(node.children[i]);
+                    jumps.push_back(code.size());
+                    code.push_back({Opcode::JUMP, 0, 0});
+                    code[split].y = static_cast<uint32_t>(code.size());
+                }
+                emit(node.children.back());
+                for (const auto jump : jumps) {
+                    code[jump].x = static_cast<uint32_t>(code.size());
+                }
+                break;
+            }
+            case Node::REPEAT: {
+                const auto &child = node.children.front();
+                for (auto i = 0; i + (node.max < 0 && node.min > 0 ? 1 : 0) < node.min; i++) {
+                    emit(child);
+                }
+                if (node.max < 0 && node.min > 0) {
+                    // L: child
+                    //    SPLIT L, end
+                    const auto loop = code.size();
+                    emit(child);
+                    code.push_back({Opcode::SPLIT, static_cast<uint32_t>(loop), static_cast<uint32_t>(code.size() + 1)});
+                } else if (node.max < 0) {
+                    // L: SPLIT body, end
+                    //    child
+                    //    JUMP L
+                    const auto loop = code.size();
+                    code.push_back({Opcode::SPLIT, static_cast<uint32_t>(loop + 1), 0});
+                    emit(child);
+                    code.push_back({Opcode::JUMP, static_cast<uint32_t>(loop), 0});
+                    code[loop].y = static_cast<uint32_t>(code.size());
+                } else {
+                    // each optional copy skips the rest once it doesn't match
+                    vector<size_t> splits;
+                    for (auto i = node.min; i < node.max; i++) {
+                        splits.push_back(code.size());
+                        code.push_back({Opcode::SPLIT, static_cast<uint32_t>(code.size() + 1), 0});
+                        emit(child);
+                    }
+                    for (const auto split : splits) {
+                        code[split].y = static_cast<uint32_t>(code.size());
+                    }
+                }
+                break;
+            }
+            }
+        }
+
+    private:
+        MultiRegex &regex_;
+        vector<uint32_t> bytes_;
+        size_t pos_ = 0;
+
+        bool at_end() const { return pos_ >= bytes_.size(); }
+
+        bool peek_is(const uint32_t c) const { return !at_end() && bytes_[pos_] == c; }
+
+        uint32_t next() {
+            if (at_end()) {
+                throw MultiRegex::Unsupported("unexpected end of the regex");
+            }
+            return bytes_[pos_++];
+        }
+
+        Node make_class(const Ranges &ranges, const bool negated) {
+            CharClass cls;
+            for (const auto &r : ranges) {
+                for (auto byte = r.first; byte <= r.second; byte++) {
+                    cls.bytes[byte] = true;
+                }
+            }
+            if (negated) {
+                cls.bytes.flip();
+            }
+            regex_.classes_.push_back(cls);
+
+            Node node;
+            node.kind = Node::CLASS;
+            node.value = static_cast<uint32_t>(regex_.classes_.size() - 1);
+            return node;
+        }
+
+        static Node make_char(const uint32_t byte) {
+            Node node;
+            node.kind = Node::CHAR;
+            node.value = byte;
+            return node;
+        }
+
+        Node parse_alternation() {
+            vector<Node> alternatives;
+            alternatives.push_back(parse_concatenation());
+            while (peek_is('|')) {
+                pos_++;
+                alternatives.push_back(parse_concatenation());
+            }
+            if (alternatives.size() == 1) {
+                return move(alternatives.front());
+            }
+            Node node;
+            node.kind = Node::ALTERNATE;
+            node.children = move(alternatives);
+            return node;
+        }
+
+        Node parse_concatenation() {
+            Node node;
+            node.kind = Node::CONCAT;
+            while (!at_end() && !peek_is('|') && !peek_is(')')) {
+                node.children.push_back(parse_repetition());
+            }
+            return node;
+        }
+
+        /**
+         * Parse "{n}", "{n,}" or "{n,m}" if it's there, otherwise leave the position unchanged.
+         */
+        bool parse_braces(int &min, int &max) {
+            const auto start = pos_;
+            const auto parse_int = [&](int &out) {
+                auto digits = 0;
+                out = 0;
+                while (!at_end() && bytes_[pos_] >= '0' && bytes_[pos_] <= '9') {
+                    out = std::min(out * 10 + static_cast<int>(bytes_[pos_++] - '0'), MAX_REPEAT + 1);
+                    digits++;
+                }
+                return digits > 0;
+            };
+
+            pos_++; // "{"
+            if (parse_int(min)) {
+                max = min;
+                if (peek_is(',')) {
+                    pos_++;
+                    if (!parse_int(max)) {
+                        max = -1;
+                    }
+                }
+                if (peek_is('}')) {
+                    pos_++;
+                    if (min > MAX_REPEAT || max > MAX_REPEAT) {
+                        throw MultiRegex::Unsupported("the repetition count is too large");
+                    }
+                    if (max >= 0 && max < min) {
+                        throw MultiRegex::Unsupported("the repetition range is out of order");
+                    }
+                    return true;
+                }
+            }
+            pos_ = start;
+            return false;
+        }
+
+        Node parse_repetition() {
+            auto atom = parse_atom();
+
+            int min, max;
+            if (peek_is('*')) {
+                pos_++;
+                min = 0, max = -1;
+            } else if (peek_is('+')) {
+                pos_++;
+                min = 1, max = -1;
+            } else if (peek_is('?')) {
+                pos_++;
+                min = 0, max = 1;
+            } else if (!(peek_is('{') && parse_braces(min, max))) {
+                return atom;
+            }
+
+            if (atom.is_assertion()) {
+                throw MultiRegex::Unsupported("an assertion can't be repeated");
+            }
+            if (peek_is('?')) {
+                pos_++; // being lazy makes no difference to whether it matches
+            }
+            if (peek_is('*') || peek_is('+') || peek_is('?')) {
+                throw MultiRegex::Unsupported("nothing to repeat");
+            }
+
+            Node node;
+            node.kind = Node::REPEAT;
+            node.min = min;
+            node.max = max;
+            node.children.push_back(move(atom));
+            return node;
+        }
+
+        Node parse_atom() {
+            const auto c = next();
+            Node node;
+            switch (c) {
+            case '(':
+                if (peek_is('?')) {
+                    pos_++;
+                    if (!peek_is(':')) {
+                        throw MultiRegex::Unsupported("lookaheads are not supported");
+                    }
+                    pos_++;
+                }
+                node = parse_alternation();
+                if (!peek_is(')')) {
+                    throw MultiRegex::Unsupported("missing ')'");
+                }
+                pos_++;
+                return node;
+            case '.':
+                node.kind = Node::ANY;
+                return node;
+            case '^':
+                node.kind = Node::BEGIN;
+                return node;
+            case '$':
+                node.kind = Node::END;
+                return node;
+            case '[':
+                return parse_class();
+            case '\\':
+                return parse_escape();
+            case '*':
+            case '+':
+            case '?':
+                throw MultiRegex::Unsupported("nothing to repeat");
+            case '{': {
+                pos_--;
+                int min, max;
+                if (parse_braces(min, max)) {
+                    throw MultiRegex::Unsupported("nothing to repeat");
+                }
+                pos_++;
+                return make_char(c);
+            }
+            default:
+                return make_char(c);
+            }
+        }
+
+        /**
+         * Parse the escape after "\" that stands for a single byte, return false if it's not one of them.
+         */
+        bool parse_char_escape(const uint32_t c, uint32_t &byte) {
+            const auto parse_hex = [&](const int digits) {
+                uint32_t value = 0;
+                for (auto i = 0; i < digits; i++) {
+                    const auto h = next();
+                    if (h >= '0' && h <= '9') {
+                        value = value * 16 + (h - '0');
+                    } else if (h >= 'a' && h <= 'f') {
+                        value = value * 16 + (h - 'a' + 10);
+                    } else if (h >= 'A' && h <= 'F') {
+                        value = value * 16 + (h - 'A' + 10);
+                    } else {
+                        throw MultiRegex::Unsupported("invalid hex escape");
+                    }
+                }
+                return value;
+            };
+
+            switch (c) {
+            case 't':
+                byte = '\t';
+                return true;
+            case 'n':
+                byte = '\n';
+                return true;
+            case 'r':
+                byte = '\r';
+                return true;
+            case 'f':
+                byte = '\f';
+                return true;
+            case 'v':
+                byte = '\v';
+                return true;
+            case 'x':
+                byte = parse_hex(2);
+                return true;
+            case 'u':
+                byte = parse_hex(4);
+                if (byte > MAX_BYTE) {
+                    // std::regex narrows it to a char, which is not worth imitating
+                    throw MultiRegex::Unsupported("\\u escapes beyond a byte are not supported");
+                }
+                return true;
+            case 'c': {
+                const auto letter = next();
+                if (!((letter >= 'a' && letter <= 'z') || (letter >= 'A' && letter <= 'Z'))) {
+                    throw MultiRegex::Unsupported("invalid control escape");
+                }
+                byte = letter % 32;
+                return true;
+            }
+            case '0':
+                if (!at_end() && bytes_[pos_] >= '0' && bytes_[pos_] <= '9') {
+                    throw MultiRegex::Unsupported("octal escapes are not supported");
+                }
+                byte = 0;
+                return true;
+            default:
+                if (c >= '1' && c <= '9') {
+                    throw MultiRegex::Unsupported("backreferences are not supported");
+                }
+                return false;
+            }
+        }
+
+        /**
+         * Get the ranges of "\d", "\w", "\s" and their negations.
+         */
+        static bool class_escape_ranges(const uint32_t c, Ranges &ranges) {
+            switch (c) {
+            case 'd':
+                ranges = DIGIT_RANGES;
+                return true;
+            case 'D':
+                ranges = complement(DIGIT_RANGES);
+                return true;
+            case 'w':
+                ranges = WORD_RANGES;
+                return true;
+            case 'W':
+                ranges = complement(WORD_RANGES);
+                return true;
+            case 's':
+                ranges = SPACE_RANGES;
+                return true;
+            case 'S':
+                ranges = complement(SPACE_RANGES);
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        Node parse_escape() {
+            const auto c = next();
+            Node node;
+            if (c == 'b') {
+                node.kind = Node::WORD_BOUNDARY;
+                return node;
+            }
+            if (c == 'B') {
+                node.kind = Node::NOT_WORD_BOUNDARY;
+                return node;
+            }
+            if (Ranges ranges; class_escape_ranges(c, ranges)) {
+                return make_class(move(ranges), false);
+            }
+            uint32_t byte;
+            if (parse_char_escape(c, byte)) {
+                return make_char(byte);
+            }
+            return make_char(c); // e.g. "\." and "\\"
+        }
+
+        Node parse_class() {
+            auto negated = false;
+            if (peek_is('^')) {
+                pos_++;
+                negated = true;
+            }
+
+            Ranges ranges;
+            // parse a single byte, or add the ranges of a class escape and return false
+            const auto parse_class_atom = [&](uint32_t &byte) {
+                byte = next();
+                if (byte != '\\') {
+                    return true;
+                }
+                const auto c = next();
+                if (c == 'b') {
+                    byte = '\b';
+                    return true;
+                }
+                if (Ranges escape_ranges; class_escape_ranges(c, escape_ranges)) {
+                    ranges.insert(ranges.end(), escape_ranges.cbegin(), escape_ranges.cend());
+                    return false;
+                }
+                if (!parse_char_escape(c, byte)) {
+                    byte = c;
+                }
+                return true;
+            };
+
+            while (!peek_is(']')) {
+                uint32_t lo;
+                if (!parse_class_atom(lo)) {
+                    continue;
+                }
+                if (peek_is('-') && pos_ + 1 < bytes_.size() && bytes_[pos_ + 1] != ']') {
+                    pos_++;
+                    uint32_t hi;
+                    if (!parse_class_atom(hi)) {
+                        throw MultiRegex::Unsupported("a class escape can't be the end of a range");
+                    }
+                    if (hi < lo) {
+                        throw MultiRegex::Unsupported("the class range is out of order");
+                    }
+                    ranges.emplace_back(lo, hi);
+                } else {
+                    ranges.emplace_back(lo, lo);
+                }
+            }
+            pos_++; // "]"
+            return make_class(move(ranges), negated);
+        }
+    };
+
+    size_t MultiRegex::add(const string_view pattern) {
+        const auto code_size = code_.size();
+        const auto class_count = classes_.size();
+        try {
+            RegexParser parser(*this, pattern);
+            const auto node = parser.parse();
+            parser.emit(node);
+        } catch (...) {
+            code_.resize(code_size);
+            classes_.resize(class_count);
+            throw;
+        }
+
+        const auto id = static_cast<uint32_t>(starts_.size());
+        code_.push_back({Opcode::MATCH, id, 0});
+        starts_.push_back(static_cast<uint32_t>(code_size));
+        return id;
+    }
+
+    /**
+     * A set of NFA states, which can be cleared in constant time.
+     */
+    struct StateSet {
+        vector<uint32_t> dense;
+        vector<uint32_t> sparse;
+        size_t size = 0;
+
+        void reset(const size_t capacity) {
+            if (dense.size() < capacity) {
+                dense.resize(capacity);
+                sparse.resize(capacity);
+            }
+            size = 0;
+        }
+
+        bool insert(const uint32_t state) {
+            if (sparse[state] < size && dense[sparse[state]] == state) {
+                return false;
+            }
+            sparse[state] = static_cast<uint32_t>(size);
+            dense[size++] = state;
+            return true;
+        }
+    };
+
+    void MultiRegex::search(const string_view text, const function<bool(size_t)> &on_match) const {
+        if (starts_.empty()) {
+            return;
+        }
+
+        // reused across searches, so that searching doesn't allocate once they are large enough
+        thread_local StateSet current, next;
+        thread_local vector<uint32_t> stack;
+        thread_local vector<bool> matched;
+        current.reset(code_.size());
+        next.reset(code_.size());
+        matched.assign(starts_.size(), false);
+        auto remaining = starts_.size();
+
+        // follow the jumps and assertions from "state" at "pos", adding the states reached to "set"
+        const auto add = [&](StateSet &set, const uint32_t state, const size_t pos) {
+            stack.clear();
+            stack.push_back(state);
+            while (!stack.empty()) {
+                const auto s = stack.back();
+                stack.pop_back();
+                if (!set.insert(s)) {
+                    continue;
+                }
+                const auto &ins = code_[s];
+                switch (ins.opcode) {
+                case Opcode::SPLIT:
+                    stack.push_back(ins.y);
+                    stack.push_back(ins.x);
+                    break;
+                case Opcode::JUMP:
+                    stack.push_back(ins.x);
+                    break;
+                case Opcode::ASSERT_BEGIN:
+                    if (pos == 0) {
+                        stack.push_back(s + 1);
+                    }
+                    break;
+                case Opcode::ASSERT_END:
+                    if (pos == text.size()) {
+                        stack.push_back(s + 1);
+                    }
+                    break;
+                case Opcode::ASSERT_WORD_BOUNDARY:
+                case Opcode::ASSERT_NOT_WORD_BOUNDARY: {
+                    const auto before = pos > 0 && is_word_byte(text[pos - 1]);
+                    const auto after = pos < text.size() && is_word_byte(text[pos]);
+                    if ((before != after) == (ins.opcode == Opcode::ASSERT_WORD_BOUNDARY)) {
+                        stack.push_back(s + 1);
+                    }
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+        };
+
+        for (size_t pos = 0;;) {
+            // the search is unanchored, so every regex not matched yet may start here
+            for (size_t id = 0; id < starts_.size(); id++) {
+                if (!matched[id]) {
+                    add(current, starts_[id], pos);
+                }
+            }
+
+            const auto at_end = pos >= text.size();
+            const uint8_t byte = at_end ? 0 : static_cast<uint8_t>(text[pos]);
+            for (size_t i = 0; i < current.size; i++) {
+                const auto s = current.dense[i];
+                const auto &ins = code_[s];
+                auto step = false;
+                switch (ins.opcode) {
+                case Opcode::MATCH:
+                    if (!matched[ins.x]) {
+                        matched[ins.x] = true;
+                        if (!on_match(ins.x) || --remaining == 0) {
+                            return;
+                        }
+                    }
+                    break;
+                case Opcode::CHAR:
+                    step = byte == ins.x;
+                    break;
+                case Opcode::ANY:
+                    step = !is_line_terminator(byte);
+                    break;
+                case Opcode::CLASS:
+                    step = classes_[ins.x].contains(byte);
+                    break;
+                default:
+                    break;
+                }
+                if (step && !at_end) {
+                    add(next, s + 1, pos + 1);
+                }
+            }
+
+            if (at_end) {
+                return;
+            }
+            swap(current, next);
+            next.size = 0;
+            pos++;
+        }
+    }
+} // namespace cqhttp::plugins
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cqhttp::plugins {
+    /**
+     * A set of regexes searched at once, in time linear to the text.
+     *
+     * The regexes are compiled into one NFA (Thompson's construction), whose states are all tracked together while
+     * the text is read, so there is no backtracking. The syntax is that of ECMAScript, except backreferences and
+     * lookaheads, which can't be matched this way.
+     *
+     * Both the regexes and the text are read as bytes, the way std::regex reads std::string, so that a regex matches
+     * exactly what it matches with std::regex, which the event filter falls back to. For example, "." matches one byte
+     * of a multi-byte UTF-8 character, and "\w", "\s" and "\b" only know ASCII.
+     */
+    class MultiRegex {
+    public:
+        struct Unsupported : std::invalid_argument {
+            using invalid_argument::invalid_argument;
+        };
+
+        /**
+         * Add a regex, return its id. Throw Unsupported if the regex is invalid or uses features not supported.
+         */
+        size_t add(std::string_view pattern);
+
+        size_t size() const { return starts_.size(); }
+
+        /**
+         * Call "on_match" with the id of each regex matching some part of the text, possibly more than once.
+         * Stop searching as soon as "on_match" returns false.
+         */
+        void search(std::string_view text, const std::function<bool(size_t)> &on_match) const;
+
+        // instructions of the NFA
+        enum class Opcode : uint8_t {
+            CHAR, // match byte "x"
+            ANY, // match any byte except "\n" and "\r"
+            CLASS, // match a byte in classes[x]
+            SPLIT, // go to both "x" and "y"
+            JUMP, // go to "x"
+            ASSERT_BEGIN, // at the beginning of the text
+            ASSERT_END, // at the end of the text
+            ASSERT_WORD_BOUNDARY,
+            ASSERT_NOT_WORD_BOUNDARY,
+            MATCH, // regex "x" matches
+        };
+
+        struct Instruction {
+            Opcode opcode;
+            uint32_t x;
+            uint32_t y;
+        };
+
+        struct CharClass {
+            std::bitset<256> bytes; // negation is already applied
+
+            bool contains(const uint8_t byte) const { return bytes[byte]; }
+        };
+
+    private:
+        std::vector<Instruction> code_;
+        std::vector<CharClass> classes_;
+        std::vector<uint32_t> starts_; // the first instruction of each regex
+
+        friend class RegexParser;
+    };
+} // namespace cqhttp::plugins
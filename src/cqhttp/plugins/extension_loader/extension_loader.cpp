@@ -50,7 +50,7 @@ namespace cqhttp::plugins {
 
     template <typename E>
     static ext::EventContext convert_context(EventContext<E> &ctx) {
-        ext::EventContext ext_ctx(ctx.data);
+        ext::EventContext ext_ctx(ctx.data());
         make_bridge(ctx, ext_ctx);
         return ext_ctx;
     }
@@ -0,0 +1,62 @@
+#include "./info_cache_invalidator.h"
+
+#include <unordered_set>
+
+#include "cqhttp/core/info_cache.h"
+
+using namespace std;
+
+namespace cqhttp::plugins {
+    using PostType = EventPayload::PostType;
+
+    void InfoCacheInvalidator::hook_enable(Context &ctx) {
+        info_cache::clear();
+        info_cache::configure(chrono::seconds(max(ctx.config->get_integer("info_cache_ttl", 60), int64_t{0})),
+                              max(ctx.config->get_integer("info_cache_size", 10000), int64_t{0}));
+        ctx.next();
+    }
+
+    void InfoCacheInvalidator::hook_disable(Context &ctx) {
+        info_cache::clear();
+        ctx.next();
+    }
+
+    void InfoCacheInvalidator::hook_before_event(EventContext<cq::Event> &ctx) {
+        // this runs before the event filter, so that dropped events still keep the cache fresh
+        if (ctx.payload.post_type() == PostType::NOTICE && ctx.payload.group_id() && ctx.payload.user_id()) {
+            const auto group_id = *ctx.payload.group_id();
+            const auto user_id = *ctx.payload.user_id();
+            switch (static_cast<const cq::NoticeEvent &>(ctx.event).notice_type) {
+            case cq::notice::GROUP_MEMBER_INCREASE:
+            case cq::notice::GROUP_MEMBER_DECREASE:
+            case cq::notice::GROUP_ADMIN:
+                if (user_id == cq::api::get_login_user_id()) {
+                    // the bot itself joined, left or got its role changed
+                    info_cache::invalidate_group(group_id);
+                } else {
+                    info_cache::invalidate_group_member(group_id, user_id);
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        ctx.next();
+    }
+
+    void InfoCacheInvalidator::hook_after_action(ActionContext &ctx) {
+        // the actions changing members don't cause events in CoolQ, so they have to be watched here
+        static const unordered_set<string> MEMBER_ACTIONS = {
+            "set_group_kick", "set_group_admin", "set_group_card", "set_group_special_title"};
+
+        if (ctx.result.code == ActionResult::Codes::OK) {
+            const auto group_id = ctx.params.get_integer("group_id", 0);
+            if (ctx.action == "set_group_leave") {
+                info_cache::invalidate_group(group_id);
+            } else if (MEMBER_ACTIONS.count(ctx.action)) {
+                info_cache::invalidate_group_member(group_id, ctx.params.get_integer("user_id", 0));
+            }
+        }
+        ctx.next();
+    }
+} // namespace cqhttp::plugins
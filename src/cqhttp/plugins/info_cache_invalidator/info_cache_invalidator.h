@@ -0,0 +1,15 @@
+#pragma once
+
+#include "cqhttp/core/plugin.h"
+
+namespace cqhttp::plugins {
+    struct InfoCacheInvalidator : Plugin {
+        std::string name() const override { return "info_cache_invalidator"; }
+        void hook_enable(Context &ctx) override;
+        void hook_disable(Context &ctx) override;
+        void hook_before_event(EventContext<cq::Event> &ctx) override;
+        void hook_after_action(ActionContext &ctx) override;
+    };
+
+    static std::shared_ptr<InfoCacheInvalidator> info_cache_invalidator = std::make_shared<InfoCacheInvalidator>();
+} // namespace cqhttp::plugins
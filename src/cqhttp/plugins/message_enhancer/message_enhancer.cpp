@@ -2,6 +2,7 @@
 
 #include <boost/property_tree/ini_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <condition_variable>
 #include <filesystem>
 #include <mutex>
 #include <unordered_set>
@@ -31,9 +32,9 @@ namespace cqhttp::plugins {
     namespace base64 = cq::utils::base64;
 
     static MessageSegment enhance_send_file(const MessageSegment &raw, const string &data_dir);
-    static MessageSegment enhance_receive_image(const MessageSegment &raw);
+    static optional<MessageSegment> enhance_receive_image(const MessageSegment &raw);
 
-    static struct FileType {
+    struct FileType {
         string ext;
         string mime;
     };
@@ -60,15 +61,16 @@ namespace cqhttp::plugins {
     }
 
     void MessageEnhancer::hook_message_event(EventContext<cq::MessageEvent> &ctx) {
-        Message msg;
-        for (const auto &segment : ctx.event.message) {
-            if (segment.type == "image") {
-                msg.push_back(enhance_receive_image(segment));
-            } else {
-                msg.push_back(segment);
+        // only the images that get a "url" are changed, the rest of the message stays as it came
+        ctx.payload.patch_message([](EventMessage &msg) {
+            for (size_t i = 0; i < msg.size(); i++) {
+                if (msg[i].type == "image") {
+                    if (auto segment = enhance_receive_image(msg[i])) {
+                        msg.replace(i, move(*segment));
+                    }
+                }
             }
-        }
-        ctx.data["message"] = msg;
+        });
 
         ctx.next();
     }
@@ -103,7 +105,7 @@ namespace cqhttp::plugins {
         function<bool()> make_file = nullptr;
 
         const static auto check_ext = [](const auto &name) -> string {
-            if (smatch m; regex_search(name, m, regex(R"(\.(png|jpg|jpeg|gif|bmp)$)", regex::flag_type::icase))) {
+            if (smatch m; regex_search(name, m, regex(R"(\.(png|jpg|jpeg|gif|bmp)$)", regex::icase))) {
                 return m.str(1);
             }
             return "tmp";
@@ -160,15 +162,16 @@ namespace cqhttp::plugins {
             filename = md5_hash_hex("from_base64_" + to_string(time(nullptr)) + "_"
                                     + to_string(random_int(1, 10000))); // note that there isn't an extension yet
             make_file = [=, &file, &filename] {
-                const auto base64_encoded = file.substr(strlen("base64://"));
-                const auto raw = base64::decode(base64_encoded);
-                const auto file_type = detect_file_type(raw);
+                const auto base64_encoded = string_view(file).substr(strlen("base64://"));
+                // the leading bytes are enough to tell the file type, the rest is decoded straight into the file
+                char header[base64::max_decoded_size(16)];
+                const auto header_size = base64::decode(base64_encoded.substr(0, 16), header);
+                const auto file_type = detect_file_type(string(header, header_size));
                 filename = filename + "." + (file_type.ext.empty() ? "tmp" : file_type.ext);
                 const auto filepath = data_file_full_path(data_dir, filename);
 
                 if (ofstream f(ansi(filepath), ios::binary | ios::out); f.is_open()) {
-                    f << raw;
-                    return true;
+                    return base64::decode(base64_encoded, f);
                 }
                 return false;
             };
@@ -222,20 +225,19 @@ namespace cqhttp::plugins {
         return segment;
     }
 
-    static MessageSegment enhance_receive_image(const MessageSegment &raw) {
+    static optional<MessageSegment> enhance_receive_image(const MessageSegment &raw) {
         if (raw.data.find("url") != raw.data.end()) {
             // already has "url" parameter, skip it
-            return raw;
+            return nullopt;
         }
 
         const auto file_it = raw.data.find("file");
         if (file_it == raw.data.end()) {
             // there is no "file" parameter, skip it
-            return raw;
+            return nullopt;
         }
 
-        auto segment = raw;
-        const auto filename = (*file_it).second;
+        const auto &filename = (*file_it).second;
 
         if (!filename.empty()) {
             const auto cqimg_filename = filename + ".cqimg";
@@ -246,10 +248,12 @@ namespace cqhttp::plugins {
                 read_ini(istrm, pt);
                 auto url = pt.get_optional<string>("image.url");
                 if (url && !url->empty()) {
+                    auto segment = raw;
                     segment.data["url"] = url.value();
+                    return segment;
                 }
             }
         }
-        return segment;
+        return nullopt;
     }
 } // namespace cqhttp::plugins
@@ -17,7 +17,7 @@ namespace cqhttp::plugins {
         // which will post data to backends in their hook_after_event,
         // and after other irrelevant plugins
         if (ctx.event.type == cq::event::MESSAGE && post_message_format_ == "string") {
-            ctx.data["message"] = std::to_string(ctx.data["message"].get<cq::Message>());
+            ctx.payload.set_message_format(EventPayload::MessageFormat::STRING);
         }
 
         ctx.next();
@@ -1,31 +1,31 @@
 #include "./rate_limited_actions.h"
 
 #include "cqhttp/core/core.h"
-#include "cqhttp/utils/mutex.h"
 
 using namespace std;
 
 namespace cqhttp::plugins {
     const auto TAG = u8"限速动作";
 
-    using utils::mutex::with_unique_lock;
-
     void RateLimitedActions::hook_enable(Context &ctx) {
         enabled_ = ctx.config->get_bool("enable_rate_limited_actions", false);
         if (enabled_) {
-            interval_ = chrono::milliseconds(ctx.config->get_integer("rate_limit_interval", 500));
-            chan_ = make_shared<Channel<QueuedContext>>();
+            ActionScheduler::Options options;
+            options.interval = chrono::milliseconds(ctx.config->get_integer("rate_limit_interval", 500));
+            options.burst = max(ctx.config->get_integer("rate_limit_burst", 1), static_cast<int64_t>(1));
+            options.per_target_interval =
+                chrono::milliseconds(ctx.config->get_integer("rate_limit_per_target_interval", 0));
+            options.per_target_burst =
+                max(ctx.config->get_integer("rate_limit_per_target_burst", 1), static_cast<int64_t>(1));
+            scheduler_ = make_shared<ActionScheduler>(options);
+
             worker_thread_ = thread([&]() {
                 worker_running_ = true;
-                for (;;) {
+                while (const auto task = scheduler_->pop()) {
                     try {
-                        if (QueuedContext queued_ctx; chan_->get(queued_ctx)) {
-                            call_action(queued_ctx.action, queued_ctx.params);
-                            logging::debug(TAG, u8"成功执行一个限速动作");
-                            this_thread::sleep_for(interval_);
-                        }
+                        call_action(task->action, task->params);
+                        logging::debug(TAG, u8"成功执行一个限速动作");
                     } catch (...) {
-                        break;
                     }
                 }
                 worker_running_ = false;
@@ -37,7 +37,7 @@ namespace cqhttp::plugins {
 
     void RateLimitedActions::hook_disable(Context &ctx) {
         if (enabled_) {
-            chan_->close();
+            scheduler_->close(); // the actions left are dropped
             if (worker_thread_.joinable()) {
                 worker_thread_.join();
             }
@@ -52,13 +52,25 @@ namespace cqhttp::plugins {
             if (boost::ends_with(ctx.action, suffix)) {
                 const auto action = ctx.action.substr(0, ctx.action.length() - suffix_len);
                 if (!boost::ends_with(action, suffix)) {
-                    chan_->put(QueuedContext{action, ctx.params});
-                    logging::debug(TAG, u8"限速动作已进入限速队列等待执行");
-                    ctx.result.code = ActionResult::Codes::ASYNC;
+                    if (scheduler_->push({action, ctx.params.raw})) {
+                        logging::debug(TAG, u8"限速动作已进入限速队列等待执行");
+                        ctx.result.code = ActionResult::Codes::ASYNC;
+                    } else {
+                        logging::warning(TAG, u8"限速队列已满，限速动作被拒绝");
+                        ctx.result.code = ActionResult::Codes::QUEUE_FULL;
+                    }
                 }
             }
         }
 
         ctx.next();
     }
+
+    void RateLimitedActions::hook_after_action(ActionContext &ctx) {
+        if (enabled_ && ctx.action == "get_status" && ctx.result.code == ActionResult::Codes::OK) {
+            ctx.result.data["rate_limited_actions"] = scheduler_->stats();
+        }
+
+        ctx.next();
+    }
 } // namespace cqhttp::plugins
@@ -0,0 +1,178 @@
+#include "./scheduler.h"
+
+#include "cqhttp/core/helpers.h"
+
+using namespace std;
+
+namespace cqhttp::plugins {
+    static const size_t MAX_IDLE_BUCKETS = 1024;
+
+    void TokenBucket::refill(const Clock::time_point now) {
+        if (tokens_ >= burst_) {
+            last_refill_ = now;
+            return;
+        }
+        if (interval_ <= Clock::duration::zero()) {
+            tokens_ = burst_;
+            last_refill_ = now;
+            return;
+        }
+        const auto gained = static_cast<size_t>((now - last_refill_) / interval_);
+        if (gained > 0) {
+            tokens_ = min(burst_, tokens_ + gained);
+            last_refill_ = tokens_ >= burst_ ? now : last_refill_ + static_cast<Clock::rep>(gained) * interval_;
+        }
+    }
+
+    TokenBucket::Clock::time_point TokenBucket::next_available(const Clock::time_point now) {
+        refill(now);
+        return tokens_ > 0 ? now : last_refill_ + interval_;
+    }
+
+    void TokenBucket::take(const Clock::time_point now) {
+        refill(now);
+        if (tokens_ > 0) {
+            tokens_--;
+        }
+    }
+
+    bool TokenBucket::full(const Clock::time_point now) {
+        refill(now);
+        return tokens_ >= burst_;
+    }
+
+    bool ActionScheduler::push(Task task) {
+        auto target = helpers::get_target_key(task.params);
+        auto bucket_key = task.action + "@" + target;
+
+        unique_lock<mutex> lock(mutex_);
+        if (closed_ || queued_count_ >= options_.max_queued) {
+            rejected_count_++;
+            return false;
+        }
+
+        auto &queue = queues_[target];
+        if (queue.empty()) {
+            round_robin_.push_back(target);
+        }
+        queue.push_back(Queued{move(task), move(bucket_key), Clock::now()});
+        queued_count_++;
+        lock.unlock();
+
+        cv_.notify_one();
+        return true;
+    }
+
+    TokenBucket &ActionScheduler::target_bucket(const string &key, const Clock::time_point now) {
+        auto it = target_buckets_.find(key);
+        if (it == target_buckets_.end()) {
+            it = target_buckets_.emplace(key, TokenBucket(options_.per_target_interval, options_.per_target_burst, now))
+                     .first;
+        }
+        return it->second;
+    }
+
+    void ActionScheduler::collect_idle_buckets(const Clock::time_point now) {
+        if (target_buckets_.size() <= MAX_IDLE_BUCKETS) {
+            return;
+        }
+        // a full bucket is no different from a new one, so it's safe to forget it
+        for (auto it = target_buckets_.begin(); it != target_buckets_.end();) {
+            if (it->second.full(now)) {
+                it = target_buckets_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    optional<ActionScheduler::Task> ActionScheduler::pop() {
+        unique_lock<mutex> lock(mutex_);
+        while (true) {
+            if (closed_) {
+                return nullopt;
+            }
+            if (queued_count_ == 0) {
+                cv_.wait(lock);
+                continue;
+            }
+
+            const auto now = Clock::now();
+            auto wake_at = global_bucket_.next_available(now);
+            if (wake_at > now) {
+                cv_.wait_until(lock, wake_at);
+                continue;
+            }
+
+            // find the next target in round-robin order whose first task is allowed to run
+            wake_at = Clock::time_point::max();
+            for (size_t i = 0; i < round_robin_.size(); i++) {
+                auto target = move(round_robin_.front());
+                round_robin_.pop_front();
+                auto &queue = queues_.at(target);
+
+                auto &bucket = target_bucket(queue.front().bucket_key, now);
+                if (const auto available_at = bucket.next_available(now); available_at > now) {
+                    wake_at = min(wake_at, available_at);
+                    round_robin_.push_back(move(target));
+                    continue;
+                }
+
+                bucket.take(now);
+                global_bucket_.take(now);
+
+                auto queued = move(queue.front());
+                queue.pop_front();
+                if (queue.empty()) {
+                    queues_.erase(target);
+                } else {
+                    round_robin_.push_back(move(target));
+                }
+                queued_count_--;
+
+                const auto wait_time = now - queued.queued_at;
+                executed_count_++;
+                total_wait_time_ += wait_time;
+                max_wait_time_ = max(max_wait_time_, wait_time);
+                collect_idle_buckets(now);
+                return move(queued.task);
+            }
+
+            // every target is waiting for its own bucket
+            if (wake_at == Clock::time_point::max()) {
+                cv_.wait(lock);
+            } else {
+                cv_.wait_until(lock, wake_at);
+            }
+        }
+    }
+
+    void ActionScheduler::close() {
+        {
+            unique_lock<mutex> lock(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    json ActionScheduler::stats() const {
+        const auto to_ms = [](const Clock::duration d) {
+            return chrono::duration_cast<chrono::duration<double, milli>>(d).count();
+        };
+
+        unique_lock<mutex> lock(mutex_);
+        size_t max_queue_depth = 0;
+        for (const auto &[target, queue] : queues_) {
+            max_queue_depth = max(max_queue_depth, queue.size());
+        }
+        return {
+            {"queued", queued_count_},
+            {"queued_targets", queues_.size()},
+            {"max_target_queue_depth", max_queue_depth},
+            {"executed", executed_count_},
+            {"rejected", rejected_count_},
+            {"avg_wait_time_ms", executed_count_ > 0 ? to_ms(total_wait_time_) / executed_count_ : 0.0},
+            {"max_wait_time_ms", to_ms(max_wait_time_)},
+        };
+    }
+} // namespace cqhttp::plugins
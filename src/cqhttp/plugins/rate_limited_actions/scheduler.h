@@ -0,0 +1,117 @@
+#pragma once
+
+#include "cqhttp/core/common.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace cqhttp::plugins {
+    /**
+     * A token bucket, which gains a token every "interval", and holds at most "burst" tokens.
+     */
+    class TokenBucket {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        TokenBucket(const Clock::duration interval, const size_t burst, const Clock::time_point now)
+            : interval_(interval), burst_(std::max<size_t>(burst, 1)), tokens_(burst_), last_refill_(now) {}
+
+        /**
+         * The time when a token is available, which is "now" if there is one already.
+         */
+        Clock::time_point next_available(Clock::time_point now);
+
+        /**
+         * Take a token, which must be available.
+         */
+        void take(Clock::time_point now);
+
+        /**
+         * Whether the bucket is full, that is, it behaves the same as a new one.
+         */
+        bool full(Clock::time_point now);
+
+    private:
+        Clock::duration interval_;
+        size_t burst_;
+        size_t tokens_;
+        Clock::time_point last_refill_;
+
+        void refill(Clock::time_point now);
+    };
+
+    /**
+     * Schedule rate limited actions.
+     *
+     * All actions share a global token bucket. Besides, each action kind on each target (group, discuss or user)
+     * has its own token bucket, so that a busy target can't use up the whole rate. Targets with actions waiting
+     * are served in round-robin order, while actions on the same target run in FIFO order.
+     */
+    class ActionScheduler {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Options {
+            std::chrono::milliseconds interval{500};
+            size_t burst = 1;
+            std::chrono::milliseconds per_target_interval{0}; // 0 means no limit for each target
+            size_t per_target_burst = 1;
+            size_t max_queued = 4096;
+        };
+
+        struct Task {
+            std::string action;
+            json params;
+        };
+
+        explicit ActionScheduler(const Options &options)
+            : options_(options), global_bucket_(options.interval, options.burst, Clock::now()) {}
+
+        /**
+         * Queue a task. Return false if there are too many tasks queued.
+         */
+        bool push(Task task);
+
+        /**
+         * Wait until a task is allowed to run, and take it out. Return nullopt if the scheduler is closed.
+         */
+        std::optional<Task> pop();
+
+        void close();
+
+        /**
+         * Get the metrics, including the queue depth and the time tasks wait in the queue.
+         */
+        json stats() const;
+
+    private:
+        struct Queued {
+            Task task;
+            std::string bucket_key;
+            Clock::time_point queued_at;
+        };
+
+        Options options_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        bool closed_ = false;
+
+        TokenBucket global_bucket_;
+        std::unordered_map<std::string, TokenBucket> target_buckets_;
+        std::unordered_map<std::string, std::deque<Queued>> queues_; // target -> tasks
+        std::deque<std::string> round_robin_; // targets with tasks queued
+        size_t queued_count_ = 0;
+
+        uint64_t executed_count_ = 0;
+        uint64_t rejected_count_ = 0;
+        Clock::duration total_wait_time_{0};
+        Clock::duration max_wait_time_{0};
+
+        TokenBucket &target_bucket(const std::string &key, Clock::time_point now);
+        void collect_idle_buckets(Clock::time_point now);
+    };
+} // namespace cqhttp::plugins
@@ -38,7 +38,7 @@ namespace cqhttp::plugins {
         }
 
         const auto automatic = ctx.params.get_bool("automatic", false);
-        app.push_async_task([automatic, this] { check_update(automatic); });
+        app.push_async_task([automatic, this] { check_update(automatic); }, TaskPriority::BACKGROUND);
         ctx.result.code = ActionResult::Codes::ASYNC;
     }
 
@@ -2,10 +2,14 @@
 
 #include <filesystem>
 #include <fstream>
+#include <future>
 
+#include "cqhttp/core/core.h"
+#include "cqhttp/core/helpers.h"
 #include "cqhttp/plugins/web/server_common.h"
 #include "cqhttp/utils/crypt.h"
 #include "cqhttp/utils/http.h"
+#include "cqhttp/utils/spool.h"
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -186,8 +190,40 @@ namespace cqhttp::plugins {
             post_url_ = "";
         }
         post_timeout_ = ctx.config->get_integer("post_timeout", 0);
+        post_async_ = ctx.config->get_bool("post_async", false);
         secret_ = ctx.config->get_string("secret", "");
 
+        if (!post_url_.empty()) {
+            utils::http::AsyncClient::Options options;
+            options.max_in_flight = max(ctx.config->get_integer("post_max_concurrency", 16), static_cast<int64_t>(1));
+            post_client_ = make_shared<utils::http::AsyncClient>(options);
+
+            post_batch_size_ = max(ctx.config->get_integer("post_batch_size", 1), static_cast<int64_t>(1));
+            post_batch_interval_ = chrono::milliseconds(ctx.config->get_integer("post_batch_interval", 50));
+            if (post_batch_size_ > 1) {
+                post_batch_stopping_ = false;
+                post_batch_thread_ = thread([this] { run_post_batch_flusher(); });
+            }
+
+            if (ctx.config->get_bool("enable_spool", false)) {
+                utils::spool::Spool::Options spool_options;
+                spool_options.max_size = ctx.config->get_integer("spool_max_size", 256) * 1024 * 1024;
+                utils::spool::Replayer::Options replayer_options;
+                replayer_options.rate = max(ctx.config->get_integer("spool_replay_rate", 500), static_cast<int64_t>(1));
+                try {
+                    const auto spool =
+                        make_shared<utils::spool::Spool>(cq::dir::app_per_account("spool") + "http", spool_options);
+                    if (!spool->empty()) {
+                        logging::info(TAG, u8"磁盘缓存中有 " + to_string(spool->size()) + u8" 个事件尚未上报，将开始重新上报");
+                    }
+                    post_spool_ = make_shared<utils::spool::Replayer>(
+                        spool, [this](const string &event) { return replay_event(event); }, replayer_options);
+                } catch (exception &e) {
+                    logging::warning(TAG, u8"打开 HTTP 上报磁盘缓存失败，错误信息：" + string(e.what()));
+                }
+            }
+        }
+
         use_http_ = ctx.config->get_bool("use_http", true);
         access_token_ = ctx.config->get_string("access_token", "");
         serve_data_files_ = ctx.config->get_bool("serve_data_files", false);
@@ -227,6 +263,26 @@ namespace cqhttp::plugins {
 
         server_ = nullptr;
 
+        if (post_spool_) {
+            post_spool_->stop(); // events failed from now on are still spooled, and replayed next time
+        }
+
+        if (post_batch_thread_.joinable()) {
+            {
+                unique_lock<mutex> lock(post_batch_mutex_);
+                post_batch_stopping_ = true;
+            }
+            post_batch_cv_.notify_one();
+            post_batch_thread_.join(); // the events left are flushed before the thread exits
+        }
+
+        if (post_client_) {
+            // give the events already accepted a chance to be delivered
+            post_client_->stop(chrono::seconds(3));
+            post_client_ = nullptr;
+        }
+        post_spool_ = nullptr;
+
         ctx.next();
     }
 
@@ -309,9 +365,7 @@ namespace cqhttp::plugins {
         }
     }
 
-    static utils::http::Response post_json(const string &url, const json &payload, const string &secret,
-                                           const long timeout) {
-        const auto body = payload.dump();
+    static utils::http::Headers make_post_headers(const string &body, const string &secret) {
         utils::http::Headers headers{
             {"Content-Type", "application/json; charset=UTF-8"},
             {"X-Self-ID", to_string(api::get_login_user_id())},
@@ -319,28 +373,16 @@ namespace cqhttp::plugins {
         if (!secret.empty()) {
             headers["X-Signature"] = "sha1=" + utils::crypt::hmac_sha1_hex(secret, body);
         }
-        return post(url, payload.dump(), headers, timeout);
+        return headers;
     }
 
-    void Http::hook_after_event(EventContext<cq::Event> &ctx) {
-        if (post_url_.empty()) {
-            ctx.next();
-            return;
-        }
-        if (ctx.data["post_type"] == "meta_event" && ctx.data["meta_event_type"] == "lifecycle"
-            && ctx.data["_post_method"] != static_cast<int>(LifecycleMetaEvent::_PostMethod::ALL)
-            && ctx.data["_post_method"] != static_cast<int>(LifecycleMetaEvent::_PostMethod::HTTP)) {
-            ctx.next();
-            return;
-        }
-
-        logging::debug(TAG, u8"开始通过 HTTP 上报事件");
-        const auto resp = post_json(post_url_, ctx.data, secret_, post_timeout_);
-
-        if (resp.status_code == 0) {
-            logging::warning(TAG, u8"HTTP 上报地址 " + post_url_ + u8" 无法访问");
+    static void log_post_result(const string &url, const utils::http::Response &resp) {
+        if (resp.aborted) {
+            logging::warning(TAG, u8"插件停用，向 HTTP 上报地址 " + url + u8" 的上报已取消");
+        } else if (resp.status_code == 0) {
+            logging::warning(TAG, u8"HTTP 上报地址 " + url + u8" 无法访问");
         } else {
-            const auto log_msg = u8"通过 HTTP 上报数据到 " + post_url_ + (resp.ok() ? u8" 成功" : u8" 失败")
+            const auto log_msg = u8"通过 HTTP 上报数据到 " + url + (resp.ok() ? u8" 成功" : u8" 失败")
                                  + u8"，状态码：" + to_string(resp.status_code);
             if (resp.ok()) {
                 logging::info_success(TAG, log_msg);
@@ -348,24 +390,274 @@ namespace cqhttp::plugins {
                 logging::warning(TAG, log_msg);
             }
         }
+    }
 
+    /**
+     * Get the quick operation from the response of HTTP post, if any.
+     */
+    static optional<utils::JsonEx> get_quick_operation(const utils::http::Response &resp) {
         if (resp.ok() && !resp.body.empty()) {
             logging::debug(TAG, u8"收到响应 " + resp.body);
 
-            const auto resp_payload = resp.get_json();
-            if (resp_payload.is_object()) {
-                const utils::JsonEx params = resp_payload;
+            if (const auto resp_payload = resp.get_json(); resp_payload.is_object()) {
+                return utils::JsonEx(resp_payload);
+            }
+            logging::debug(TAG, u8"上报响应不是有效的 JSON，已忽略");
+        }
+        return nullopt;
+    }
+
+    /**
+     * Whether the post should be retried later, that is, the post url is unreachable or unavailable for now.
+     */
+    static bool should_retry(const utils::http::Response &resp) {
+        return resp.status_code == 0 || resp.status_code >= 500;
+    }
+
+    static void log_spooled(const bool ok) {
+        if (ok) {
+            logging::debug(TAG, u8"事件已存入磁盘缓存，将在 HTTP 上报地址恢复后重新上报");
+        } else {
+            logging::warning(TAG, u8"HTTP 上报磁盘缓存已满，事件被丢弃");
+        }
+    }
 
-                // note here that the ctx.data object was processed by backward_compatibility plugin,
-                // but now that the ".handle_quick_operation" action can handle legacy data format,
-                // it's ok here to use ctx.data directly
-                call_action(".handle_quick_operation", {{"context", ctx.data}, {"operation", params.raw}});
+    static void spool_event(const shared_ptr<utils::spool::Replayer> &spool, const string &event) {
+        log_spooled(spool->push(event));
+    }
 
-                if (params.get_bool("block", false)) {
-                    ctx.event.block();
+    /**
+     * Settle the place reserved in the spool for an event when it's posted,
+     * so that if the post failed, the event is spooled ahead of the events that came after it.
+     */
+    static void settle_event(const shared_ptr<utils::spool::Replayer> &spool,
+                             const utils::spool::Replayer::Ticket ticket, const string &event, const bool failed) {
+        if (failed) {
+            log_spooled(spool->push(ticket, event));
+        } else if (!spool->release(ticket)) {
+            log_spooled(false);
+        }
+    }
+
+    /**
+     * Handle the quick operation of an event that has been posted asynchronously.
+     * It happens when the response arrives, after the event itself has been handled,
+     * so it's too late to block the event then.
+     */
+    static void handle_quick_operation_async(const EventPayload::Buffer &event, const json &operation) {
+        if (operation.is_object() && operation.value("block", false)) {
+            logging::debug(TAG, u8"HTTP 异步上报模式下，快速操作无法拦截事件");
+        }
+        auto context = json::parse(*event);
+        const auto key = helpers::get_target_key(context);
+        app.push_async_task(
+            [context = move(context), operation] {
+                call_action(".handle_quick_operation", {{"context", context}, {"operation", operation}});
+            },
+            TaskPriority::ACTION,
+            key);
+    }
+
+    void Http::post_batch(const vector<BatchedEvent> &events) const {
+        // the events are already serialized, so the batch is simply joined into a JSON array
+        size_t size = 2;
+        for (const auto &event : events) {
+            size += event.data->size() + 1;
+        }
+        string body;
+        body.reserve(size);
+        body += '[';
+        for (const auto &event : events) {
+            if (body.size() > 1) {
+                body += ',';
+            }
+            body += *event.data;
+        }
+        body += ']';
+
+        logging::debug(TAG, u8"开始通过 HTTP 批量上报 " + to_string(events.size()) + u8" 个事件");
+        auto headers = make_post_headers(body, secret_);
+        const auto posted =
+            post_client_->post(post_url_,
+                               make_shared<const string>(move(body)),
+                               move(headers),
+                               post_timeout_,
+                               [url = post_url_, events, spool = post_spool_](const utils::http::Response &resp) {
+                                   log_post_result(url, resp);
+                                   if (spool) {
+                                       for (const auto &event : events) {
+                                           if (event.ticket) {
+                                               settle_event(spool, *event.ticket, *event.data, should_retry(resp));
+                                           }
+                                       }
+                                       if (should_retry(resp)) {
+                                           return;
+                                       }
+                                   }
+                                   if (!resp.ok() || resp.body.empty()) {
+                                       return;
+                                   }
+                                   logging::debug(TAG, u8"收到响应 " + resp.body);
+
+                                   // the response is an array of quick operations, one for each event in the batch
+                                   const auto operations = resp.get_json();
+                                   if (!operations.is_array()) {
+                                       logging::debug(TAG, u8"批量上报的响应不是有效的 JSON 数组，已忽略");
+                                       return;
+                                   }
+                                   for (size_t i = 0; i < min(operations.size(), events.size()); i++) {
+                                       if (operations[i].is_object()) {
+                                           handle_quick_operation_async(events[i].data, operations[i]);
+                                       }
+                                   }
+                               });
+        if (!posted) {
+            logging::warning(TAG, u8"HTTP 上报队列已满，" + to_string(events.size()) + u8" 个事件未能上报");
+            for (const auto &event : events) {
+                if (event.ticket) {
+                    settle_event(post_spool_, *event.ticket, *event.data, true);
                 }
+            }
+        }
+    }
+
+    void Http::run_post_batch_flusher() {
+        unique_lock<mutex> lock(post_batch_mutex_);
+        while (true) {
+            if (post_batch_.empty()) {
+                if (post_batch_stopping_) {
+                    break;
+                }
+                post_batch_cv_.wait(lock);
+                continue;
+            }
+
+            post_batch_cv_.wait_until(lock, post_batch_deadline_, [&] {
+                return post_batch_stopping_ || post_batch_.size() >= post_batch_size_;
+            });
+            const auto events = move(post_batch_);
+            post_batch_.clear();
+
+            lock.unlock();
+            post_batch(events);
+            lock.lock();
+        }
+    }
+
+    bool Http::replay_event(const string &event) const {
+        promise<utils::http::Response> resp_promise;
+        if (!post_client_->post(post_url_,
+                                make_shared<const string>(event),
+                                make_post_headers(event, secret_),
+                                post_timeout_,
+                                [&resp_promise](const auto &resp) { resp_promise.set_value(resp); })) {
+            return false;
+        }
+        const auto resp = resp_promise.get_future().get();
+        if (should_retry(resp)) {
+            return false;
+        }
+        // quick operations are not handled for replayed events, since it's too late for them
+        log_post_result(post_url_, resp);
+        return true;
+    }
+
+    void Http::hook_after_event(EventContext<cq::Event> &ctx) {
+        if (post_url_.empty() || !post_client_) {
+            ctx.next();
+            return;
+        }
+        if (ctx.payload.post_type() == EventPayload::PostType::META_EVENT
+            && ctx.payload.meta_event_type() == MetaEvent::LIFECYCLE
+            && ctx.payload.const_data().at("_post_method") != static_cast<int>(LifecycleMetaEvent::_PostMethod::ALL)
+            && ctx.payload.const_data().at("_post_method") != static_cast<int>(LifecycleMetaEvent::_PostMethod::HTTP)) {
+            ctx.next();
+            return;
+        }
+
+        logging::debug(TAG, u8"开始通过 HTTP 上报事件");
+        auto body = ctx.payload.serialized();
+
+        // meta events make no sense once the moment has passed, so they are never spooled
+        const auto spool = ctx.payload.post_type() != EventPayload::PostType::META_EVENT ? post_spool_ : nullptr;
+        if (spool && spool->pending()) {
+            // the events spooled before must be delivered first
+            spool_event(spool, *body);
+            ctx.next();
+            return;
+        }
+
+        if (post_batch_size_ > 1) {
+            unique_lock<mutex> lock(post_batch_mutex_);
+            if (post_batch_.empty()) {
+                post_batch_deadline_ = chrono::steady_clock::now() + post_batch_interval_;
+                post_batch_cv_.notify_one();
+            }
+            // the place in the spool is reserved here, so that it follows the order the events come in
+            post_batch_.push_back({move(body), spool ? make_optional(spool->reserve()) : nullopt});
+            if (post_batch_.size() >= post_batch_size_) {
+                post_batch_cv_.notify_one();
+            }
+            ctx.next();
+            return;
+        }
+
+        const auto headers = make_post_headers(*body, secret_);
+        // events posted concurrently may fail after later events are spooled, so their places are reserved first
+        const auto ticket = spool ? spool->reserve() : 0;
+
+        if (post_async_) {
+            const auto posted = post_client_->post(
+                post_url_, body, headers, post_timeout_, [url = post_url_, body, spool, ticket](const auto &resp) {
+                    log_post_result(url, resp);
+                    if (spool) {
+                        settle_event(spool, ticket, *body, should_retry(resp));
+                        if (should_retry(resp)) {
+                            return;
+                        }
+                    }
+                    if (const auto params = get_quick_operation(resp)) {
+                        handle_quick_operation_async(body, params->raw);
+                    }
+                });
+            if (!posted) {
+                if (spool) {
+                    settle_event(spool, ticket, *body, true);
+                } else {
+                    logging::warning(TAG, u8"HTTP 上报队列已满，事件未能上报");
+                }
+            }
+            ctx.next();
+            return;
+        }
+
+        promise<utils::http::Response> resp_promise;
+        if (!post_client_->post(post_url_, body, headers, post_timeout_, [&resp_promise](const auto &resp) {
+                resp_promise.set_value(resp);
+            })) {
+            if (spool) {
+                settle_event(spool, ticket, *body, true);
             } else {
-                logging::debug(TAG, u8"上报响应不是有效的 JSON，已忽略");
+                logging::warning(TAG, u8"HTTP 上报队列已满，事件未能上报");
+            }
+            ctx.next();
+            return;
+        }
+        const auto resp = resp_promise.get_future().get();
+        log_post_result(post_url_, resp);
+        if (spool) {
+            settle_event(spool, ticket, *body, should_retry(resp));
+        }
+
+        if (const auto params = get_quick_operation(resp)) {
+            // note here that the ctx.data object was processed by backward_compatibility plugin,
+            // but now that the ".handle_quick_operation" action can handle legacy data format,
+            // it's ok here to use ctx.data directly
+            call_action(".handle_quick_operation",
+                        {{"context", ctx.payload.const_data()}, {"operation", params->raw}});
+
+            if (params->get_bool("block", false)) {
+                ctx.event.block();
             }
         }
 
@@ -2,9 +2,13 @@
 
 #include "cqhttp/core/plugin.h"
 
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 
 #include "cqhttp/plugins/web/vendor/simple_web/server_http.hpp"
+#include "cqhttp/utils/http.h"
+#include "cqhttp/utils/spool.h"
 
 namespace cqhttp::plugins {
     struct Http : Plugin {
@@ -22,18 +26,43 @@ namespace cqhttp::plugins {
     private:
         std::string post_url_{};
         unsigned long post_timeout_{};
+        bool post_async_{};
         std::string secret_{};
         bool use_http_{};
         std::string access_token_{};
         bool serve_data_files_{};
         bool enable_cors_{};
 
+        std::shared_ptr<utils::http::AsyncClient> post_client_;
+
+        // events that can't be delivered are spooled here, and replayed once the post url is back
+        std::shared_ptr<utils::spool::Replayer> post_spool_;
+
+        struct BatchedEvent {
+            EventPayload::Buffer data;
+            // the place reserved in the spool, if it's to be spooled when it can't be delivered
+            std::optional<utils::spool::Replayer::Ticket> ticket;
+        };
+
+        size_t post_batch_size_{};
+        std::chrono::milliseconds post_batch_interval_{};
+        std::vector<BatchedEvent> post_batch_;
+        std::chrono::steady_clock::time_point post_batch_deadline_;
+        std::mutex post_batch_mutex_;
+        std::condition_variable post_batch_cv_;
+        bool post_batch_stopping_{};
+        std::thread post_batch_thread_;
+
         std::shared_ptr<SimpleWeb::Server<SimpleWeb::HTTP>> server_;
         std::thread thread_;
 
         std::atomic_bool started_ = false;
 
         void init_server();
+
+        void post_batch(const std::vector<BatchedEvent> &events) const;
+        void run_post_batch_flusher();
+        bool replay_event(const std::string &event) const;
     };
 
     static std::shared_ptr<Http> http = std::make_shared<Http>();
@@ -0,0 +1,126 @@
+#include "./subscription.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace cqhttp::plugins {
+    using PostType = EventPayload::PostType;
+
+    /**
+     * Get the items of a list given as a JSON array, or a string separated by commas (from the query string).
+     */
+    static vector<json> list_items(const json &spec, const string &key) {
+        vector<json> items;
+        const auto it = spec.find(key);
+        if (it == spec.end() || it->is_null()) {
+            return items;
+        }
+        if (it->is_array()) {
+            items.assign(it->begin(), it->end());
+        } else if (it->is_string()) {
+            vector<string> parts;
+            boost::split(parts, it->get<string>(), boost::is_any_of(","));
+            for (auto &part : parts) {
+                boost::algorithm::trim(part);
+                if (!part.empty()) {
+                    items.emplace_back(part);
+                }
+            }
+        } else {
+            throw invalid_argument("'" + key + "' must be an array or a string separated by commas");
+        }
+        return items;
+    }
+
+    template <typename T>
+    static void sort_unique(vector<T> &v) {
+        sort(v.begin(), v.end());
+        v.erase(unique(v.begin(), v.end()), v.end());
+    }
+
+    Subscription Subscription::parse(const json &spec) {
+        static const map<string, PostType> post_type_names = {
+            {"message", PostType::MESSAGE},
+            {"notice", PostType::NOTICE},
+            {"request", PostType::REQUEST},
+            {"meta_event", PostType::META_EVENT},
+        };
+        static const map<string, cq::message::Type> message_type_names = {
+            {"private", cq::message::PRIVATE},
+            {"group", cq::message::GROUP},
+            {"discuss", cq::message::DISCUSS},
+        };
+
+        if (!spec.is_object()) {
+            throw invalid_argument("the subscription must be an object");
+        }
+
+        Subscription subscription;
+
+        for (const auto &item : list_items(spec, "post_types")) {
+            const auto it = item.is_string() ? post_type_names.find(item.get<string>()) : post_type_names.end();
+            if (it == post_type_names.end()) {
+                throw invalid_argument("unknown post type " + item.dump());
+            }
+            subscription.post_types.push_back(it->second);
+        }
+        sort_unique(subscription.post_types);
+
+        for (const auto &item : list_items(spec, "message_types")) {
+            const auto it = item.is_string() ? message_type_names.find(item.get<string>()) : message_type_names.end();
+            if (it == message_type_names.end()) {
+                throw invalid_argument("unknown message type " + item.dump());
+            }
+            subscription.message_types.push_back(it->second);
+        }
+        sort_unique(subscription.message_types);
+
+        for (const auto &item : list_items(spec, "group_ids")) {
+            if (item.is_number_integer()) {
+                subscription.group_ids.push_back(item.get<int64_t>());
+            } else if (item.is_string()) {
+                try {
+                    size_t pos = 0;
+                    const auto &s = item.get_ref<const string &>();
+                    subscription.group_ids.push_back(stoll(s, &pos));
+                    if (pos != s.size()) {
+                        throw invalid_argument(s);
+                    }
+                } catch (logic_error &) {
+                    throw invalid_argument("invalid group id " + item.dump());
+                }
+            } else {
+                throw invalid_argument("invalid group id " + item.dump());
+            }
+        }
+        sort_unique(subscription.group_ids);
+
+        if (const auto it = spec.find("filter"); it != spec.end() && !it->is_null()) {
+            json rules;
+            if (it->is_string()) {
+                try {
+                    rules = json::parse(it->get<string>());
+                } catch (json::parse_error &) {
+                    throw invalid_argument("the filter is not valid JSON");
+                }
+            } else {
+                rules = *it;
+            }
+            if (!rules.is_object()) {
+                throw invalid_argument("the filter must be an object");
+            }
+            subscription.filter = construct_filter(rules); // FilterSyntexError is an invalid_argument
+        }
+
+        return subscription;
+    }
+
+    bool Subscription::accepts(EventPayload &payload) const {
+        if (!message_types.empty() && payload.post_type() == PostType::MESSAGE
+            && !binary_search(message_types.cbegin(), message_types.cend(), payload.message_type())) {
+            return false;
+        }
+        return !filter || filter->eval(payload.const_data());
+    }
+} // namespace cqhttp::plugins
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "cqhttp/core/plugin.h"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "cqhttp/plugins/event_filter/filter.h"
+
+namespace cqhttp::plugins {
+    /**
+     * The events a WebSocket client wants to receive.
+     *
+     * An empty list means no restriction. Meta events are not restricted by "group_ids", so that heartbeats and
+     * lifecycle events still reach clients subscribing to certain groups only.
+     */
+    struct Subscription {
+        using PostType = EventPayload::PostType;
+
+        std::vector<PostType> post_types;
+        std::vector<cq::message::Type> message_types;
+        std::vector<int64_t> group_ids;
+        std::shared_ptr<Filter> filter; // in the syntax of the event filter, null if not used
+
+        /**
+         * Parse a subscription from JSON (as an object in a control message),
+         * or from the query string of the connection (as strings, lists being separated by commas).
+         * Throw std::invalid_argument if it's invalid.
+         *
+         * {
+         *     "post_types": ["message", "notice"],
+         *     "message_types": ["group"],
+         *     "group_ids": [123456, 654321],
+         *     "filter": {"raw_message": {".contains": "hello"}}
+         * }
+         */
+        static Subscription parse(const json &spec);
+
+        /**
+         * Check the restrictions not covered by SubscriptionIndex, that is, "message_types" and "filter".
+         */
+        bool accepts(EventPayload &payload) const;
+    };
+
+    /**
+     * Subscriptions indexed by post type and group id, so that the recipients of an event are found
+     * in time linear to their number, not the number of all subscribers.
+     *
+     * \tparam Subscriber a hashable handle of subscribers, e.g. a shared_ptr of WebSocket connections
+     */
+    template <typename Subscriber>
+    class SubscriptionIndex {
+    public:
+        using PostType = EventPayload::PostType;
+
+        /**
+         * Add a subscriber, or replace its subscription.
+         */
+        void subscribe(const Subscriber &subscriber, Subscription subscription) {
+            std::unique_lock lock(mutex_);
+            remove(subscriber);
+            for (const auto &[bucket, group_id] : slots_of(subscription)) {
+                auto &subscribers = group_id ? buckets_[bucket].by_group[*group_id] : buckets_[bucket].any_group;
+                subscribers.push_back(subscriber);
+            }
+            subscriptions_.emplace(subscriber, std::move(subscription));
+        }
+
+        void unsubscribe(const Subscriber &subscriber) {
+            std::unique_lock lock(mutex_);
+            remove(subscriber);
+        }
+
+        void clear() {
+            std::unique_lock lock(mutex_);
+            buckets_ = {};
+            subscriptions_.clear();
+        }
+
+        /**
+         * Find the subscribers who want the event.
+         */
+        std::vector<Subscriber> recipients(EventPayload &payload) const {
+            std::vector<Subscriber> result;
+            std::shared_lock lock(mutex_);
+
+            // a subscriber is in exactly one of them, if any, see "slots_of()"
+            const auto collect = [&](const Bucket &bucket) {
+                for (const auto &subscriber : bucket.any_group) {
+                    check(subscriber, payload, result);
+                }
+                if (const auto group_id = payload.group_id()) {
+                    if (const auto it = bucket.by_group.find(*group_id); it != bucket.by_group.end()) {
+                        for (const auto &subscriber : it->second) {
+                            check(subscriber, payload, result);
+                        }
+                    }
+                }
+            };
+            collect(buckets_[static_cast<size_t>(payload.post_type())]);
+            collect(buckets_[ANY_POST_TYPE]);
+            return result;
+        }
+
+        size_t size() const {
+            std::shared_lock lock(mutex_);
+            return subscriptions_.size();
+        }
+
+    private:
+        static constexpr size_t ANY_POST_TYPE = static_cast<size_t>(PostType::META_EVENT) + 1;
+
+        struct Bucket {
+            std::unordered_map<int64_t, std::vector<Subscriber>> by_group;
+            std::vector<Subscriber> any_group;
+        };
+
+        std::array<Bucket, ANY_POST_TYPE + 1> buckets_;
+        std::unordered_map<Subscriber, Subscription> subscriptions_;
+        mutable std::shared_mutex mutex_;
+
+        /**
+         * The (bucket, group id) pairs a subscription is put in, a null group id meaning "any group".
+         */
+        static std::vector<std::pair<size_t, std::optional<int64_t>>> slots_of(const Subscription &subscription) {
+            std::vector<std::pair<size_t, std::optional<int64_t>>> slots;
+            const auto add_post_type = [&](const size_t bucket, const bool is_meta) {
+                if (subscription.group_ids.empty() || is_meta) {
+                    slots.emplace_back(bucket, std::nullopt);
+                } else {
+                    for (const auto group_id : subscription.group_ids) {
+                        slots.emplace_back(bucket, group_id);
+                    }
+                }
+            };
+
+            if (subscription.post_types.empty()) {
+                add_post_type(ANY_POST_TYPE, false);
+                if (!subscription.group_ids.empty()) {
+                    // meta events are not restricted by group ids
+                    add_post_type(static_cast<size_t>(PostType::META_EVENT), true);
+                }
+            } else {
+                for (const auto post_type : subscription.post_types) {
+                    add_post_type(static_cast<size_t>(post_type), post_type == PostType::META_EVENT);
+                }
+            }
+            return slots;
+        }
+
+        void check(const Subscriber &subscriber, EventPayload &payload, std::vector<Subscriber> &result) const {
+            if (const auto it = subscriptions_.find(subscriber);
+                it != subscriptions_.end() && it->second.accepts(payload)) {
+                result.push_back(subscriber);
+            }
+        }
+
+        void remove(const Subscriber &subscriber) {
+            const auto it = subscriptions_.find(subscriber);
+            if (it == subscriptions_.end()) {
+                return;
+            }
+            for (const auto &[bucket, group_id] : slots_of(it->second)) {
+                if (group_id) {
+                    auto &by_group = buckets_[bucket].by_group;
+                    if (const auto group_it = by_group.find(*group_id); group_it != by_group.end()) {
+                        erase_from(group_it->second, subscriber);
+                        if (group_it->second.empty()) {
+                            by_group.erase(group_it);
+                        }
+                    }
+                } else {
+                    erase_from(buckets_[bucket].any_group, subscriber);
+                }
+            }
+            subscriptions_.erase(it);
+        }
+
+        static void erase_from(std::vector<Subscriber> &subscribers, const Subscriber &subscriber) {
+            if (const auto it = std::find(subscribers.begin(), subscribers.end(), subscriber);
+                it != subscribers.end()) {
+                *it = std::move(subscribers.back());
+                subscribers.pop_back();
+            }
+        }
+    };
+} // namespace cqhttp::plugins
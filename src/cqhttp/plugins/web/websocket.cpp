@@ -9,10 +9,13 @@ using WsServer = SimpleWeb::SocketServer<SimpleWeb::WS>;
 namespace cqhttp::plugins {
     static const auto TAG = "WS";
 
+    // handled by the server itself instead of the API, since it's about the connection
+    static const auto SET_SUBSCRIPTION_ACTION = "set_event_subscription";
+
     void WebSocket::init_server() {
         logging::debug(TAG, u8"初始化 WebSocket");
 
-        auto gen_on_open_callback = [=](const bool send_connect_event) {
+        auto gen_on_open_callback = [=](const bool receive_events) {
             return [=](const shared_ptr<WsServer::Connection> connection) {
                 logging::debug(TAG,
                                u8"收到 WebSocket 连接：" + connection->path + u8"，来源 IP："
@@ -25,12 +28,46 @@ namespace cqhttp::plugins {
                     *out_message << "authorization failed";
                     connection->send(out_message);
                     connection->send_close(1000); // we don't want this client any more
-                } else if (send_connect_event) {
+                } else if (receive_events) {
+                    try {
+                        subscriptions_.subscribe(connection, Subscription::parse(args));
+                    } catch (invalid_argument &e) {
+                        logging::debug(TAG, string(u8"事件订阅参数无效，已关闭连接，错误信息：") + e.what());
+                        const auto out_message = make_shared<WsServer::OutMessage>();
+                        *out_message << string("invalid subscription: ") + e.what();
+                        connection->send(out_message);
+                        connection->send_close(1000);
+                        return;
+                    }
                     emit_lifecycle_meta_event(MetaEvent::SubType::LIFECYCLE_CONNECT);
                 }
             };
         };
 
+        const auto on_close = [=](const shared_ptr<WsServer::Connection> connection, auto &&...) {
+            subscriptions_.unsubscribe(connection);
+        };
+
+        // handle control messages changing the subscription of the connection,
+        // return false if the message is not one of them
+        const auto handle_control_message = [=](const shared_ptr<WsServer::Connection> connection,
+                                                const json &payload) {
+            if (!(payload.is_object() && payload.value("action", json()) == SET_SUBSCRIPTION_ACTION)) {
+                return false;
+            }
+            const auto echo = payload.value("echo", json());
+            try {
+                subscriptions_.subscribe(connection, Subscription::parse(payload.value("params", json::object())));
+                logging::debug(TAG, u8"WebSocket 客户端的事件订阅已更新");
+                ws_api_send_result<WsServer>(connection, ActionResult(ActionResult::Codes::OK), echo);
+            } catch (invalid_argument &e) {
+                logging::debug(TAG, string(u8"事件订阅参数无效，错误信息：") + e.what());
+                ws_api_send_result<WsServer>(
+                    connection, ActionResult(ActionResult::Codes::HTTP_BAD_REQUEST, e.what()), echo);
+            }
+            return true;
+        };
+
         server_ = make_shared<WsServer>();
 
         auto &api_endpoint = server_->endpoint["^/api/?$"];
@@ -41,12 +78,23 @@ namespace cqhttp::plugins {
 
         auto &event_endpoint = server_->endpoint["^/event/?$"];
         event_endpoint.on_open = gen_on_open_callback(true);
+        event_endpoint.on_close = on_close;
+        event_endpoint.on_error = on_close;
+        event_endpoint.on_message = [=](auto connection, auto message) {
+            // other messages are ignored, as they were before subscriptions existed
+            handle_control_message(connection, ws_api_parse_message<WsServer>(message));
+        };
 
         // endpoint for both API and Event
         auto &universal_endpoint = server_->endpoint["^/$"];
         universal_endpoint.on_open = gen_on_open_callback(true);
-        universal_endpoint.on_message = [](auto connection, auto message) {
-            ws_api_on_message<WsServer>(connection, message);
+        universal_endpoint.on_close = on_close;
+        universal_endpoint.on_error = on_close;
+        universal_endpoint.on_message = [=](auto connection, auto message) {
+            const auto payload = ws_api_parse_message<WsServer>(message);
+            if (!handle_control_message(connection, payload)) {
+                ws_api_handle_payload<WsServer>(connection, payload, ws_api_send_result<WsServer>);
+            }
         };
     }
 
@@ -87,29 +135,31 @@ namespace cqhttp::plugins {
         }
 
         server_ = nullptr;
+        subscriptions_.clear();
 
         ctx.next();
     }
 
     void WebSocket::hook_after_event(EventContext<cq::Event> &ctx) {
-        if (ctx.data["post_type"] == "meta_event" && ctx.data["meta_event_type"] == "lifecycle"
-            && ctx.data["_post_method"] != static_cast<int>(LifecycleMetaEvent::_PostMethod::ALL)
-            && ctx.data["_post_method"] != static_cast<int>(LifecycleMetaEvent::_PostMethod::WEBSOCKET)) {
+        if (ctx.payload.post_type() == EventPayload::PostType::META_EVENT
+            && ctx.payload.meta_event_type() == MetaEvent::LIFECYCLE
+            && ctx.payload.const_data().at("_post_method") != static_cast<int>(LifecycleMetaEvent::_PostMethod::ALL)
+            && ctx.payload.const_data().at("_post_method") != static_cast<int>(LifecycleMetaEvent::_PostMethod::WEBSOCKET)) {
             ctx.next();
             return;
         }
 
-        static const auto path_regex = regex("^(/|/event/?)$");
         if (started_) {
             logging::debug(TAG, u8"开始通过 WebSocket 服务端推送事件");
-            size_t total_count = 0;
+            const auto recipients = subscriptions_.recipients(ctx.payload);
+            const auto total_count = recipients.size();
             size_t succeeded_count = 0;
-            for (const auto &connection : server_->get_connections()) {
-                if (regex_match(connection->path, path_regex)) {
-                    total_count++;
+            if (!recipients.empty()) {
+                const auto payload = ctx.payload.serialized();
+                for (const auto &connection : recipients) {
                     try {
                         const auto out_message = make_shared<WsServer::OutMessage>();
-                        *out_message << ctx.data.dump();
+                        *out_message << *payload;
                         connection->send(out_message);
                         succeeded_count++;
                     } catch (...) {
@@ -4,6 +4,7 @@
 
 #include <thread>
 
+#include "cqhttp/plugins/web/subscription.h"
 #include "cqhttp/plugins/web/vendor/simple_web/server_ws.hpp"
 
 namespace cqhttp::plugins {
@@ -27,6 +28,9 @@ namespace cqhttp::plugins {
 
         std::atomic_bool started_ = false;
 
+        // connections to "/event/" and "/", which receive events
+        SubscriptionIndex<std::shared_ptr<SimpleWeb::SocketServer<SimpleWeb::WS>::Connection>> subscriptions_;
+
         void init_server();
     };
 
@@ -62,11 +62,29 @@ namespace cqhttp::plugins {
             const auto reconnect_on_code_1000 = ctx.config->get_bool("ws_reverse_reconnect_on_code_1000", true);
             const auto fallback_url = ctx.config->get_string("ws_reverse_url", "");
 
+            const auto enable_spool = [&](const shared_ptr<EventClient> &client, const string &name) {
+                if (!ctx.config->get_bool("enable_spool", false)) {
+                    return;
+                }
+                utils::spool::Spool::Options spool_options;
+                spool_options.max_size = ctx.config->get_integer("spool_max_size", 256) * 1024 * 1024;
+                utils::spool::Replayer::Options replayer_options;
+                replayer_options.rate = max(ctx.config->get_integer("spool_replay_rate", 500), static_cast<int64_t>(1));
+                try {
+                    client->enable_spool(
+                        make_shared<utils::spool::Spool>(cq::dir::app_per_account("spool") + name, spool_options),
+                        replayer_options);
+                } catch (exception &e) {
+                    logging::warning(TAG, u8"打开反向 WebSocket 上报磁盘缓存失败，错误信息：" + string(e.what()));
+                }
+            };
+
             if (ctx.config->get_bool("ws_reverse_use_universal_client", false)) {
                 auto url = check_ws_url(fallback_url);
                 if (!url.empty()) {
                     universal_ =
                         make_shared<UniversalClient>(url, access_token, reconnect_interval, reconnect_on_code_1000);
+                    enable_spool(universal_, "ws_reverse_universal");
                     universal_->start();
                 } else {
                     universal_ = nullptr;
@@ -85,6 +103,7 @@ namespace cqhttp::plugins {
                 url = check_ws_url(event_url.empty() ? fallback_url : event_url);
                 if (!url.empty()) {
                     event_ = make_shared<EventClient>(url, access_token, reconnect_interval, reconnect_on_code_1000);
+                    enable_spool(event_, "ws_reverse_event");
                     event_->start();
                 } else {
                     event_ = nullptr;
@@ -113,18 +132,21 @@ namespace cqhttp::plugins {
     }
 
     void WebSocketReverse::hook_after_event(EventContext<cq::Event> &ctx) {
-        if (ctx.data["post_type"] == "meta_event" && ctx.data["meta_event_type"] == "lifecycle"
-            && ctx.data["_post_method"] != static_cast<int>(LifecycleMetaEvent::_PostMethod::ALL)
-            && ctx.data["_post_method"] != static_cast<int>(LifecycleMetaEvent::_PostMethod::WEBSOCKET)) {
+        if (ctx.payload.post_type() == EventPayload::PostType::META_EVENT
+            && ctx.payload.meta_event_type() == MetaEvent::LIFECYCLE
+            && ctx.payload.const_data().at("_post_method") != static_cast<int>(LifecycleMetaEvent::_PostMethod::ALL)
+            && ctx.payload.const_data().at("_post_method") != static_cast<int>(LifecycleMetaEvent::_PostMethod::WEBSOCKET)) {
             ctx.next();
             return;
         }
 
+        // meta events make no sense once the moment has passed, so they are never spooled
+        const auto durable = ctx.payload.post_type() != EventPayload::PostType::META_EVENT;
         if (event_) {
-            event_->push_event(ctx.data);
+            event_->push_event(ctx.payload.serialized(), durable);
         }
         if (universal_) {
-            universal_->push_event(ctx.data);
+            universal_->push_event(ctx.payload.serialized(), durable);
         }
         ctx.next();
     }
@@ -10,6 +10,7 @@
 
 #include "cqhttp/plugins/web/vendor/simple_web/client_ws.hpp"
 #include "cqhttp/plugins/web/vendor/simple_web/client_wss.hpp"
+#include "cqhttp/utils/spool.h"
 
 namespace cqhttp::plugins {
     struct WebSocketReverse : Plugin {
@@ -114,10 +115,26 @@ namespace cqhttp::plugins {
             using ClientBase::ClientBase;
             std::string name() override { return "Event"; }
 
-            void push_event(const json &payload);
+            void stop() override;
+
+            /**
+             * Push an event to the server. If "durable" is true, and the spool is enabled,
+             * the event is spooled when it can't be sent, and replayed after reconnecting.
+             */
+            void push_event(const EventPayload::Buffer &payload, bool durable);
+
+            void enable_spool(std::shared_ptr<utils::spool::Spool> spool,
+                              const utils::spool::Replayer::Options &options);
 
         protected:
             void init() override;
+
+            std::shared_ptr<utils::spool::Replayer> spool_;
+
+            bool send(const EventPayload::Buffer &payload, std::function<void(const SimpleWeb::error_code &)> callback);
+            bool replay_event(const std::string &event);
+            void spool_event(const std::string &event) const;
+            void settle_event(utils::spool::Replayer::Ticket ticket, const std::string &event, bool failed) const;
         };
 
         std::shared_ptr<EventClient> event_;
@@ -1,6 +1,9 @@
 #include "./websocket_reverse.h"
 
+#include <future>
+
 #include "cqhttp/core/core.h"
+#include "cqhttp/core/helpers.h"
 #include "cqhttp/plugins/web/ws_common.h"
 #include "cqhttp/utils/mutex.h"
 
@@ -159,15 +162,27 @@ namespace cqhttp::plugins {
     template <typename WsT>
     static void api_on_message(mutex &connection_mutex, const std::shared_ptr<typename WsT::Connection> connection,
                                const std::shared_ptr<typename WsT::InMessage> message) {
-        app.push_async_task([=, &connection_mutex] {
-            auto send_result = [&](const std::shared_ptr<typename WsT::Connection> conn,
-                                   const ActionResult &result,
-                                   const json &echo) {
-                std::lock_guard lock(connection_mutex);
-                ws_api_send_result<WsT>(conn, result, echo);
-            };
-            ws_api_on_message<WsT>(connection, message, std::move(send_result));
-        });
+        // the request is parsed here to find its target, so that requests on the same target are handled in order
+        auto payload = ws_api_parse_message<WsT>(message);
+        string key;
+        if (payload.is_object()) {
+            if (const auto it = payload.find("params"); it != payload.end()) {
+                key = helpers::get_target_key(*it);
+            }
+        }
+
+        app.push_async_task(
+            [=, &connection_mutex, payload = std::move(payload)] {
+                auto send_result = [&](const std::shared_ptr<typename WsT::Connection> conn,
+                                       const ActionResult &result,
+                                       const json &echo) {
+                    std::lock_guard lock(connection_mutex);
+                    ws_api_send_result<WsT>(conn, result, echo);
+                };
+                ws_api_handle_payload<WsT>(connection, payload, std::move(send_result));
+            },
+            TaskPriority::ACTION,
+            key);
     }
 
     void WebSocketReverse::ApiClient::init() {
@@ -193,58 +208,136 @@ namespace cqhttp::plugins {
     void WebSocketReverse::EventClient::init() {
         ClientBase::init();
 
+        const auto on_open = [&](auto) {
+            connected_ = true;
+            if (spool_) {
+                spool_->notify(); // replay the events spooled while disconnected
+            }
+            emit_lifecycle_meta_event(MetaEvent::SubType::LIFECYCLE_CONNECT);
+        };
         if (client_is_wss_.has_value()) {
             if (client_is_wss_.value() == false) {
-                client_.ws->on_open = [&](const shared_ptr<WsClient::Connection> connection) {
-                    connected_ = true;
-                    emit_lifecycle_meta_event(MetaEvent::SubType::LIFECYCLE_CONNECT);
-                };
+                client_.ws->on_open = on_open;
             } else {
-                client_.ws->on_open = [&](const shared_ptr<WsClient::Connection> connection) {
-                    connected_ = true;
-                    emit_lifecycle_meta_event(MetaEvent::SubType::LIFECYCLE_CONNECT);
-                };
+                client_.wss->on_open = on_open;
             }
         }
     }
 
-    void WebSocketReverse::EventClient::push_event(const json &payload) {
+    void WebSocketReverse::EventClient::stop() {
+        if (spool_) {
+            spool_->stop();
+        }
+        ClientBase::stop();
+    }
+
+    void WebSocketReverse::EventClient::enable_spool(shared_ptr<utils::spool::Spool> spool,
+                                                     const utils::spool::Replayer::Options &options) {
+        spool_ = make_shared<utils::spool::Replayer>(
+            move(spool), [this](const string &event) { return replay_event(event); }, options);
+    }
+
+    static void log_spooled(const bool ok) {
+        if (ok) {
+            logging::debug(TAG, u8"事件已存入磁盘缓存，将在反向 WebSocket 重新连接后上报");
+        } else {
+            logging::warning(TAG, u8"反向 WebSocket 磁盘缓存已满，事件被丢弃");
+        }
+    }
+
+    void WebSocketReverse::EventClient::spool_event(const string &event) const { log_spooled(spool_->push(event)); }
+
+    void WebSocketReverse::EventClient::settle_event(const utils::spool::Replayer::Ticket ticket, const string &event,
+                                                     const bool failed) const {
+        if (failed) {
+            log_spooled(spool_->push(ticket, event));
+        } else if (!spool_->release(ticket)) {
+            log_spooled(false);
+        }
+    }
+
+    bool WebSocketReverse::EventClient::send(const EventPayload::Buffer &payload,
+                                             function<void(const SimpleWeb::error_code &)> callback) {
+        try {
+            if (client_is_wss_.value() == false) {
+                const auto out_message = make_shared<WsClient::OutMessage>();
+                *out_message << *payload;
+                // the WsClient class is modified by us ("connection" property made public),
+                // so we must maintain the lock manually
+                unique_lock<mutex> lock(client_.ws->connection_mutex);
+                client_.ws->connection->send(out_message, move(callback));
+                lock.unlock();
+            } else {
+                const auto out_message = make_shared<WssClient::OutMessage>();
+                *out_message << *payload;
+                unique_lock<mutex> lock(client_.wss->connection_mutex);
+                client_.wss->connection->send(out_message, move(callback));
+                lock.unlock();
+            }
+            return true;
+        } catch (...) {
+            return false;
+        }
+    }
+
+    bool WebSocketReverse::EventClient::replay_event(const string &event) {
+        if (!connected_) {
+            return false;
+        }
+        // the promise may outlive this function if the callback is late
+        const auto sent = make_shared<promise<bool>>();
+        auto future = sent->get_future();
+        const auto send_cb = [sent](const SimpleWeb::error_code &ec) { sent->set_value(!ec); };
+        if (!send(make_shared<const string>(event), send_cb)) {
+            return false;
+        }
+        return future.wait_for(chrono::seconds(30)) == future_status::ready && future.get();
+    }
+
+    void WebSocketReverse::EventClient::push_event(const EventPayload::Buffer &payload, const bool durable) {
+        const auto spool = durable && spool_;
+        if (spool && spool_->pending()) {
+            // the events spooled before must be delivered first
+            spool_event(*payload);
+            return;
+        }
+
         if (!connected_) {
-            logging::info(TAG, u8"反向 WebSocket 连接尚未建立，无法上报");
+            if (spool) {
+                spool_event(*payload);
+            } else {
+                logging::info(TAG, u8"反向 WebSocket 连接尚未建立，无法上报");
+            }
             return;
         }
 
         logging::debug(TAG, u8"开始通过反向 WebSocket 客户端上报事件");
 
+        // the send completes asynchronously, and may fail after later events are spooled,
+        // so the place of the event in the spool is reserved first
+        const auto ticket = spool ? spool_->reserve() : 0;
         const auto send_cb = [=](const SimpleWeb::error_code &ec) {
             if (!ec) {
                 logging::info_success(TAG, u8"通过反向 WebSocket 客户端上报数据到 " + url_ + u8" 成功");
+                if (spool) {
+                    settle_event(ticket, *payload, false);
+                }
             } else {
                 logging::warning(TAG,
                                  u8"通过反向 WebSocket 客户端上报数据到 " + url_ + u8" 失败，错误码："
                                      + std::to_string(ec.value()) + u8"，将尝试重连");
+                if (spool) {
+                    settle_event(ticket, *payload, true);
+                }
                 std::unique_lock<std::mutex> lock(mutex_);
                 should_reconnect_ = true;
             }
         };
-        try {
-            if (client_is_wss_.value() == false) {
-                const auto out_message = make_shared<WsClient::OutMessage>();
-                *out_message << payload.dump();
-                // the WsClient class is modified by us ("connection" property made public),
-                // so we must maintain the lock manually
-                unique_lock<mutex> lock(client_.ws->connection_mutex);
-                client_.ws->connection->send(out_message, send_cb); // TODO: send 失败应当重新连接
-                lock.unlock();
-            } else {
-                const auto out_message = make_shared<WssClient::OutMessage>();
-                *out_message << payload.dump();
-                unique_lock<mutex> lock(client_.wss->connection_mutex);
-                client_.wss->connection->send(out_message, send_cb);
-                lock.unlock();
-            }
-        } catch (...) {
+        if (!send(payload, send_cb)) {
             logging::warning(TAG, u8"通过反向 WebSocket 客户端上报数据到 " + url_ + u8" 失败");
+            if (spool) {
+                settle_event(ticket, *payload, true);
+            }
         }
     }
 
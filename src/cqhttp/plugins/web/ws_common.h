@@ -20,15 +20,10 @@ namespace cqhttp::plugins {
     }
 
     /**
-     * Common "on_message" callback for websocket server's api endpoint and reverse websocket api client.
-     * \tparam WsT WsServer (websocket server /api/ endpoint) or WsClient (reverse websocket api client)
+     * Parse an API request message, the result is null if the message is not valid JSON.
      */
     template <typename WsT>
-    static void ws_api_on_message(
-        const std::shared_ptr<typename WsT::Connection> connection,
-        const std::shared_ptr<typename WsT::InMessage> message,
-        std::function<void(const std::shared_ptr<typename WsT::Connection>, const ActionResult &, const json &)>
-            send_result = ws_api_send_result<WsT>) {
+    static json ws_api_parse_message(const std::shared_ptr<typename WsT::InMessage> message) {
         static const auto TAG = u8"WS API";
 
         const auto ws_message_str = message->string();
@@ -40,6 +35,19 @@ namespace cqhttp::plugins {
         } catch (json::parse_error &) {
             // bad JSON
         }
+        return payload;
+    }
+
+    /**
+     * Handle a parsed API request, and send the result.
+     */
+    template <typename WsT>
+    static void ws_api_handle_payload(
+        const std::shared_ptr<typename WsT::Connection> connection, const json &payload,
+        std::function<void(const std::shared_ptr<typename WsT::Connection>, const ActionResult &, const json &)>
+            send_result) {
+        static const auto TAG = u8"WS API";
+
         if (!(payload.is_object() && payload.find("action") != payload.end() && payload["action"].is_string())) {
             logging::debug(TAG, u8"请求中的 JSON 无效或者不是对象");
             send_result(connection, ActionResult(ActionResult::Codes::HTTP_BAD_REQUEST), nullptr);
@@ -70,4 +78,17 @@ namespace cqhttp::plugins {
         send_result(connection, result, echo);
         logging::info_success(TAG, u8"已成功处理一个 API 请求：" + action);
     }
+
+    /**
+     * Common "on_message" callback for websocket server's api endpoint and reverse websocket api client.
+     * \tparam WsT WsServer (websocket server /api/ endpoint) or WsClient (reverse websocket api client)
+     */
+    template <typename WsT>
+    static void ws_api_on_message(
+        const std::shared_ptr<typename WsT::Connection> connection,
+        const std::shared_ptr<typename WsT::InMessage> message,
+        std::function<void(const std::shared_ptr<typename WsT::Connection>, const ActionResult &, const json &)>
+            send_result = ws_api_send_result<WsT>) {
+        ws_api_handle_payload<WsT>(connection, ws_api_parse_message<WsT>(message), std::move(send_result));
+    }
 } // namespace cqhttp::plugins
@@ -9,14 +9,16 @@ using namespace std;
 
 namespace cqhttp::utils::crypt {
     string hmac_sha1_hex(const string &key, const string &msg) {
-        unsigned char digest[20];
-        HMAC_CTX ctx;
-        HMAC_CTX_init(&ctx);
-        HMAC_Init_ex(&ctx, key.c_str(), key.size(), EVP_sha1(), nullptr);
-        HMAC_Update(&ctx, reinterpret_cast<const unsigned char *>(msg.c_str()), msg.size());
-        unsigned digest_len;
-        HMAC_Final(&ctx, digest, &digest_len);
-        HMAC_CTX_cleanup(&ctx);
+        unsigned char digest[EVP_MAX_MD_SIZE];
+        unsigned digest_len = 0;
+        // the one-shot HMAC() works with both OpenSSL 1.0 (vcpkg) and 1.1+ (where HMAC_CTX is opaque)
+        HMAC(EVP_sha1(),
+             key.c_str(),
+             static_cast<int>(key.size()),
+             reinterpret_cast<const unsigned char *>(msg.c_str()),
+             msg.size(),
+             digest,
+             &digest_len);
 
         stringstream ss;
         for (unsigned i = 0; i < digest_len; ++i) {
@@ -1,9 +1,13 @@
 #include "./http.h"
 
 #include <curl/curl.h>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <regex>
+#include <thread>
+#include <unordered_map>
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -24,6 +28,7 @@ namespace cqhttp::utils::http::curl {
         string content_type;
         string user_agent;
         string body;
+        shared_ptr<const string> shared_body; // used instead of "body" if set, to avoid copying
         void *write_data = nullptr;
         WriteFunction write_func = nullptr;
         long connect_timeout = 0;
@@ -37,10 +42,10 @@ namespace cqhttp::utils::http::curl {
         Request(const string &url, const Headers &headers, const string &body = "")
             : url(url), headers(headers), body(body) {}
 
-        Response Request::send() {
-            Response response;
-
-            const auto curl = curl_easy_init();
+        /**
+         * Set up a curl easy handle for this request, the returned header list must be freed after the transfer.
+         */
+        curl_slist *prepare(CURL *curl, Response &response) {
             curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
             if (method == Method::POST) {
                 curl_easy_setopt(curl, CURLOPT_POST, 1L);
@@ -83,7 +88,10 @@ namespace cqhttp::utils::http::curl {
             }
             curl_easy_setopt(curl, CURLOPT_HTTPHEADER, chunk);
 
-            if (!body.empty()) {
+            if (shared_body) {
+                curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(shared_body->size()));
+                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, shared_body->data());
+            } else if (!body.empty()) {
                 curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
             }
 
@@ -92,7 +100,14 @@ namespace cqhttp::utils::http::curl {
 
             curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 
-            response.curl_code = curl_easy_perform(curl);
+            return chunk;
+        }
+
+        /**
+         * Fill in the response after the transfer is done.
+         */
+        static void collect(CURL *curl, const CURLcode curl_code, Response &response) {
+            response.curl_code = curl_code;
 
             if (response.curl_code == CURLE_OK) {
                 long status_code;
@@ -107,6 +122,14 @@ namespace cqhttp::utils::http::curl {
             } else {
                 response.status_code = 0;
             }
+        }
+
+        Response send() {
+            Response response;
+
+            const auto curl = curl_easy_init();
+            const auto chunk = prepare(curl, response);
+            collect(curl, curl_easy_perform(curl), response);
 
             curl_slist_free_all(chunk);
             curl_easy_cleanup(curl);
@@ -230,4 +253,183 @@ namespace cqhttp::utils::http {
         curl_easy_cleanup(curl);
         return escaped_string;
     }
+
+    struct AsyncClient::Impl {
+        struct Transfer {
+            curl::Request request;
+            curl::Response response;
+            curl_slist *header_list = nullptr;
+            Callback callback;
+        };
+
+        Options options;
+        CURLM *multi = nullptr;
+        vector<CURL *> idle_handles; // reused, so that each handle keeps its own state like DNS cache
+        unordered_map<CURL *, unique_ptr<Transfer>> in_flight;
+
+        mutex mtx;
+        deque<unique_ptr<Transfer>> queue;
+        bool stopping = false;
+        chrono::steady_clock::time_point drain_deadline;
+        thread worker;
+
+        explicit Impl(const Options &options) : options(options) {
+            multi = curl_multi_init();
+            // connections are kept in the multi handle's cache and reused for the same host
+            curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, static_cast<long>(options.max_in_flight));
+            curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(options.max_in_flight));
+            curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        }
+
+        ~Impl() {
+            for (const auto handle : idle_handles) {
+                curl_easy_cleanup(handle);
+            }
+            curl_multi_cleanup(multi);
+        }
+
+        void wakeup() {
+#if LIBCURL_VERSION_NUM >= 0x074400 // 7.68.0
+            curl_multi_wakeup(multi);
+#endif
+        }
+
+        void wait() {
+#if LIBCURL_VERSION_NUM >= 0x074400
+            curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+#else
+            // without curl_multi_wakeup(), the timeout bounds how long a new request waits to be picked up
+            curl_multi_wait(multi, nullptr, 0, 10, nullptr);
+#endif
+        }
+
+        void start(unique_ptr<Transfer> transfer) {
+            CURL *handle;
+            if (!idle_handles.empty()) {
+                handle = idle_handles.back();
+                idle_handles.pop_back();
+            } else {
+                handle = curl_easy_init();
+            }
+            curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+            transfer->header_list = transfer->request.prepare(handle, transfer->response);
+            curl_multi_add_handle(multi, handle);
+            in_flight.emplace(handle, move(transfer));
+        }
+
+        void finish(CURL *handle, const CURLcode curl_code) {
+            auto transfer = move(in_flight.at(handle));
+            in_flight.erase(handle);
+
+            curl::Request::collect(handle, curl_code, transfer->response);
+            curl_multi_remove_handle(multi, handle);
+            curl_slist_free_all(transfer->header_list);
+            curl_easy_reset(handle);
+            idle_handles.push_back(handle);
+
+            complete(*transfer);
+        }
+
+        static void abort(Transfer &transfer) {
+            transfer.response.curl_code = CURLE_ABORTED_BY_CALLBACK;
+            transfer.response.aborted = true;
+            complete(transfer);
+        }
+
+        static void complete(Transfer &transfer) {
+            try {
+                transfer.callback(transfer.response);
+            } catch (...) {
+            }
+        }
+
+        void run() {
+            while (true) {
+                vector<unique_ptr<Transfer>> to_start;
+                {
+                    unique_lock<mutex> lock(mtx);
+                    if (stopping && ((queue.empty() && in_flight.empty())
+                                     || chrono::steady_clock::now() >= drain_deadline)) {
+                        break;
+                    }
+                    while (!queue.empty() && in_flight.size() + to_start.size() < options.max_in_flight) {
+                        to_start.push_back(move(queue.front()));
+                        queue.pop_front();
+                    }
+                }
+                for (auto &transfer : to_start) {
+                    start(move(transfer));
+                }
+
+                int running;
+                curl_multi_perform(multi, &running);
+
+                CURLMsg *msg;
+                int msgs_left;
+                while ((msg = curl_multi_info_read(multi, &msgs_left))) {
+                    if (msg->msg == CURLMSG_DONE) {
+                        finish(msg->easy_handle, msg->data.result);
+                    }
+                }
+
+                wait();
+            }
+
+            // abort whatever is left
+            for (auto &[handle, transfer] : in_flight) {
+                curl_multi_remove_handle(multi, handle);
+                curl_slist_free_all(transfer->header_list);
+                curl_easy_cleanup(handle);
+                abort(*transfer);
+            }
+            in_flight.clear();
+
+            unique_lock<mutex> lock(mtx);
+            auto queued = move(queue);
+            lock.unlock();
+            for (auto &transfer : queued) {
+                abort(*transfer);
+            }
+        }
+    };
+
+    AsyncClient::AsyncClient(const Options &options) : impl_(make_unique<Impl>(options)) {
+        impl_->worker = thread([this] { impl_->run(); });
+    }
+
+    AsyncClient::~AsyncClient() { stop(); }
+
+    bool AsyncClient::post(const string &url, Body body, Headers headers, const long timeout, Callback callback) {
+        fix_headers(headers);
+        auto transfer = make_unique<Impl::Transfer>();
+        transfer->request = curl::Request(url, headers);
+        transfer->request.method = curl::Method::POST;
+        transfer->request.shared_body = move(body);
+        transfer->request.timeout = timeout;
+        transfer->callback = move(callback);
+
+        {
+            unique_lock<mutex> lock(impl_->mtx);
+            if (impl_->stopping || impl_->queue.size() >= impl_->options.max_queued) {
+                return false;
+            }
+            impl_->queue.push_back(move(transfer));
+        }
+        impl_->wakeup();
+        return true;
+    }
+
+    void AsyncClient::stop(const chrono::milliseconds drain_timeout) {
+        {
+            unique_lock<mutex> lock(impl_->mtx);
+            if (!impl_->stopping) {
+                impl_->stopping = true;
+                impl_->drain_deadline = chrono::steady_clock::now() + drain_timeout;
+            }
+        }
+        impl_->wakeup();
+        if (impl_->worker.joinable()) {
+            impl_->worker.join();
+        }
+    }
 } // namespace cqhttp::utils::http
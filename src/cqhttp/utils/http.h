@@ -2,6 +2,7 @@
 
 #include "cqhttp/core/common.h"
 
+#include <chrono>
 #include <map>
 
 #define CQHTTP_UTILS_HTTP_FAKE_UA                \
@@ -17,7 +18,7 @@ namespace cqhttp::utils::http {
 
     struct CaseInsensitiveCompare {
         bool operator()(const std::string &a, const std::string &b) const noexcept {
-            return _stricmp(a.c_str(), b.c_str()) < 0;
+            return boost::algorithm::ilexicographical_compare(a, b);
         }
     };
 
@@ -29,6 +30,7 @@ namespace cqhttp::utils::http {
         size_t content_length = 0;
         Headers headers;
         std::string body;
+        bool aborted = false; // the request was given up before completing, because the client is stopped
 
         bool ok() const { return status_code >= 200 && status_code < 300; }
 
@@ -57,4 +59,44 @@ namespace cqhttp::utils::http {
     Response post(const std::string &url, const std::string &body, Headers headers = {}, const long timeout = 0);
 
     std::string url_encode(const std::string &text);
+
+    /**
+     * Asynchronous HTTP client built on curl multi.
+     *
+     * Connections are kept alive and reused per host, at most "max_in_flight" requests are on the wire
+     * at the same time, and others wait in a bounded queue. Callbacks are called on the client's own thread,
+     * so they should return quickly.
+     */
+    class AsyncClient {
+    public:
+        using Body = std::shared_ptr<const std::string>;
+        using Callback = std::function<void(const Response &)>;
+
+        struct Options {
+            size_t max_in_flight = 16;
+            size_t max_queued = 4096;
+        };
+
+        explicit AsyncClient(const Options &options);
+        ~AsyncClient();
+
+        AsyncClient(const AsyncClient &) = delete;
+        AsyncClient &operator=(const AsyncClient &) = delete;
+
+        /**
+         * Queue a POST request. Return false if the client is stopped or the queue is full,
+         * in which case the callback will never be called.
+         */
+        bool post(const std::string &url, Body body, Headers headers, long timeout, Callback callback);
+
+        /**
+         * Stop the client. Requests already queued are given at most "drain_timeout" to finish,
+         * after which the rest are aborted, with their callbacks called with status code 0 and "aborted" set.
+         */
+        void stop(std::chrono::milliseconds drain_timeout = std::chrono::milliseconds(0));
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> impl_;
+    };
 } // namespace cqhttp::utils::http
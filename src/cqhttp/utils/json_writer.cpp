@@ -0,0 +1,74 @@
+#include "./json_writer.h"
+
+#include "cqsdk/message_parser.h"
+
+using namespace std;
+
+namespace cqhttp::utils {
+    static void append_escaped_value(string &out, const json &value, const bool escape_comma) {
+        if (value.is_string()) {
+            cq::message::append_escaped(out, value.get_ref<const string &>(), escape_comma);
+        } else {
+            cq::message::append_escaped(out, value.dump(), escape_comma);
+        }
+    }
+
+    /**
+     * Append a segment in its JSON form, return false if it's not well-formed.
+     */
+    static bool append_cq_segment(string &out, const json &segment) {
+        if (!segment.is_object()) {
+            return false;
+        }
+        const auto type_it = segment.find("type");
+        const auto data_it = segment.find("data");
+        if (type_it == segment.end() || !type_it->is_string() || data_it == segment.end() || !data_it->is_object()) {
+            return false;
+        }
+
+        const auto &type = type_it->get_ref<const string &>();
+        const auto &data = *data_it;
+        if (type.empty()) {
+            return true;
+        }
+        if (type == "text") {
+            if (const auto it = data.find("text"); it != data.end()) {
+                append_escaped_value(out, *it, false);
+            }
+        } else {
+            out += "[CQ:";
+            out += type;
+            for (const auto &[key, value] : data.items()) {
+                out += ',';
+                out += key;
+                out += '=';
+                append_escaped_value(out, value, true);
+            }
+            out += ']';
+        }
+        return true;
+    }
+
+    void append_cq_string(string &out, const json &message) {
+        // adjacent text segments would be merged by "cq::Message::reduce()", which changes nothing in the string
+        const auto size = out.size();
+        auto well_formed = true;
+        if (message.is_string()) {
+            well_formed = false; // a message string is normalized by parsing it, which is rare enough to take the long way
+        } else if (message.is_array()) {
+            for (const auto &segment : message) {
+                if (!(well_formed = append_cq_segment(out, segment))) {
+                    break;
+                }
+            }
+        } else {
+            well_formed = append_cq_segment(out, message);
+        }
+
+        if (!well_formed) {
+            // leave the rest to the JSON convertor, so that malformed ones fail (or not) just like before
+            out.resize(size);
+            out += std::to_string(message.get<cq::Message>());
+        }
+    }
+} // namespace cqhttp::utils
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "cqhttp/core/common.h"
+
+namespace cqhttp::utils {
+    /**
+     * Append the message string of a message in its JSON form (array or single segment object) to "out",
+     * without building a "cq::Message" first. The output is what "std::to_string(j.get<cq::Message>())" gives.
+     */
+    void append_cq_string(std::string &out, const json &message);
+} // namespace cqhttp::utils
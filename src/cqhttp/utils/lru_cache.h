@@ -0,0 +1,114 @@
+#pragma once
+
+#include "cqhttp/core/common.h"
+
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace cqhttp::utils {
+    /**
+     * A thread-safe map of a bounded size, whose entries expire after a while.
+     * When it's full, the least recently used entry is evicted. A zero TTL or capacity disables it.
+     */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class LruCache {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        LruCache(const Clock::duration ttl, const size_t capacity) : ttl_(ttl), capacity_(capacity) {}
+
+        void set_limits(const Clock::duration ttl, const size_t capacity) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ttl_ = ttl;
+            capacity_ = capacity;
+            while (entries_.size() > capacity_) {
+                evict_oldest();
+            }
+        }
+
+        std::optional<Value> get(const Key &key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto it = index_.find(key);
+            if (it == index_.end()) {
+                return std::nullopt;
+            }
+            if (Clock::now() >= it->second->expires_at) {
+                entries_.erase(it->second);
+                index_.erase(it);
+                return std::nullopt;
+            }
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return it->second->value;
+        }
+
+        void put(const Key &key, Value value) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ttl_ <= Clock::duration::zero() || capacity_ == 0) {
+                return;
+            }
+            const auto expires_at = Clock::now() + ttl_;
+            if (const auto it = index_.find(key); it != index_.end()) {
+                it->second->value = std::move(value);
+                it->second->expires_at = expires_at;
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return;
+            }
+            entries_.push_front({key, std::move(value), expires_at});
+            index_.emplace(key, entries_.begin());
+            if (entries_.size() > capacity_) {
+                evict_oldest();
+            }
+        }
+
+        void erase(const Key &key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (const auto it = index_.find(key); it != index_.end()) {
+                entries_.erase(it->second);
+                index_.erase(it);
+            }
+        }
+
+        /**
+         * Erase the entries whose keys satisfy the predicate, by walking through all of them.
+         */
+        template <typename Pred>
+        void erase_if(Pred &&pred) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto it = entries_.begin(); it != entries_.end();) {
+                if (pred(it->key)) {
+                    index_.erase(it->key);
+                    it = entries_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        void clear() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            entries_.clear();
+            index_.clear();
+        }
+
+    private:
+        struct Entry {
+            Key key;
+            Value value;
+            Clock::time_point expires_at;
+        };
+
+        std::mutex mutex_;
+        Clock::duration ttl_;
+        size_t capacity_;
+        std::list<Entry> entries_; // most recently used first
+        std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index_;
+
+        void evict_oldest() {
+            index_.erase(entries_.back().key);
+            entries_.pop_back();
+        }
+    };
+} // namespace cqhttp::utils
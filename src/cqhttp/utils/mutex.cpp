@@ -2,6 +2,7 @@
 
 #include <filesystem>
 #include <fstream>
+#include <thread>
 
 using namespace std;
 namespace fs = std::filesystem;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "cqhttp/core/common.h"
+
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+namespace cqhttp::utils {
+    /**
+     * Coalesce concurrent calls with the same key, so that only one of them does the work,
+     * and the others wait for it and share its result (or exception).
+     */
+    template <typename Key, typename Value, typename Hash = std::hash<Key>>
+    class SingleFlight {
+    public:
+        /**
+         * Call "func", or wait for the call with the same key in flight.
+         * "shared" is set to whether the result came from another caller's call.
+         */
+        template <typename Func>
+        Value run(const Key &key, Func &&func, bool &shared) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (const auto it = flights_.find(key); it != flights_.end()) {
+                auto future = it->second;
+                lock.unlock();
+                shared = true;
+                return future.get();
+            }
+
+            std::promise<Value> promise;
+            flights_.emplace(key, promise.get_future().share());
+            lock.unlock();
+            shared = false;
+
+            try {
+                auto value = func();
+                promise.set_value(value);
+                finish(key);
+                return value;
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+                finish(key);
+                throw;
+            }
+        }
+
+    private:
+        std::mutex mutex_;
+        std::unordered_map<Key, std::shared_future<Value>, Hash> flights_;
+
+        void finish(const Key &key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flights_.erase(key);
+        }
+    };
+} // namespace cqhttp::utils
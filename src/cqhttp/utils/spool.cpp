@@ -0,0 +1,441 @@
+#include "./spool.h"
+
+#include <boost/crc.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace std;
+namespace fs = std::filesystem;
+namespace bip = boost::interprocess;
+
+namespace cqhttp::utils::spool {
+    // a record is stored as: length (uint32), CRC32 of the content (uint32), content
+    static const size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+    static const size_t CHECKPOINT_EVERY = 64;
+    static const auto SEGMENT_EXT = ".seg";
+    static const auto CURSOR_FILENAME = "cursor";
+
+    static uint32_t crc32(const char *data, const size_t size) {
+        boost::crc_32_type crc;
+        crc.process_bytes(data, size);
+        return crc.checksum();
+    }
+
+    struct Spool::Segment {
+        uint64_t id;
+        size_t capacity;
+        bip::file_mapping mapping;
+        bip::mapped_region region;
+
+        char *data() const { return static_cast<char *>(region.get_address()); }
+
+        /**
+         * Get the record at the given offset, if it's complete and intact.
+         */
+        optional<string_view> record_at(const size_t offset) const {
+            if (offset + RECORD_HEADER_SIZE > capacity) {
+                return nullopt;
+            }
+            uint32_t length, checksum;
+            memcpy(&length, data() + offset, sizeof(uint32_t));
+            memcpy(&checksum, data() + offset + sizeof(uint32_t), sizeof(uint32_t));
+            if (length == 0 || offset + RECORD_HEADER_SIZE + length > capacity) {
+                return nullopt;
+            }
+            const auto content = data() + offset + RECORD_HEADER_SIZE;
+            if (crc32(content, length) != checksum) {
+                return nullopt;
+            }
+            return string_view(content, length);
+        }
+    };
+
+    Spool::Spool(const string &dir, const Options &options) : dir_(dir), options_(options) {
+        if (!dir_.empty() && dir_.back() != '\\' && dir_.back() != '/') {
+            dir_ += static_cast<char>(fs::path::preferred_separator);
+        }
+        recover();
+    }
+
+    Spool::~Spool() {
+        unique_lock<mutex> lock(mutex_);
+        checkpoint();
+    }
+
+    string Spool::segment_path(const uint64_t id) const {
+        // zero padded, so that the file names sort the same as the ids
+        auto name = to_string(id);
+        name.insert(0, 20 - min<size_t>(name.size(), 20), '0');
+        return dir_ + name + SEGMENT_EXT;
+    }
+
+    shared_ptr<Spool::Segment> Spool::open_segment(const uint64_t id, const size_t min_capacity) const {
+        const auto path = ansi(segment_path(id));
+        if (!fs::exists(path)) {
+            // the file is fully allocated up front, records are then written through the mapping
+            ofstream(path, ios::binary);
+            fs::resize_file(path, max(options_.segment_size, min_capacity));
+        }
+
+        auto segment = make_shared<Segment>();
+        segment->id = id;
+        segment->capacity = fs::file_size(path);
+        segment->mapping = bip::file_mapping(path.c_str(), bip::read_write);
+        segment->region = bip::mapped_region(segment->mapping, bip::read_write);
+        return segment;
+    }
+
+    void Spool::recover() {
+        fs::create_directories(ansi(dir_));
+
+        for (const auto &entry : fs::directory_iterator(ansi(dir_))) {
+            if (entry.is_regular_file() && entry.path().extension() == SEGMENT_EXT) {
+                try {
+                    segment_ids_.push_back(stoull(entry.path().stem().string()));
+                } catch (logic_error &) {
+                }
+            }
+        }
+        sort(segment_ids_.begin(), segment_ids_.end());
+
+        uint64_t cursor_id = 0;
+        size_t cursor_offset = 0;
+        if (ifstream f(ansi(dir_ + CURSOR_FILENAME)); f.is_open()) {
+            f >> cursor_id >> cursor_offset;
+        }
+
+        // segments before the cursor are fully consumed
+        while (!segment_ids_.empty() && segment_ids_.front() < cursor_id) {
+            fs::remove(ansi(segment_path(segment_ids_.front())));
+            segment_ids_.pop_front();
+        }
+        if (segment_ids_.empty()) {
+            segment_ids_.push_back(cursor_id + 1);
+            cursor_offset = 0;
+        } else if (segment_ids_.front() != cursor_id) {
+            cursor_offset = 0;
+        }
+
+        // count the records left, and find the end of the log
+        for (const auto id : segment_ids_) {
+            const auto segment = open_segment(id);
+            auto offset = id == segment_ids_.front() ? cursor_offset : 0;
+            while (const auto record = segment->record_at(offset)) {
+                offset += RECORD_HEADER_SIZE + record->size();
+                count_++;
+            }
+
+            if (id == segment_ids_.front()) {
+                read_segment_ = segment;
+                read_offset_ = min(cursor_offset, offset);
+            }
+            if (id == segment_ids_.back()) {
+                write_segment_ = segment;
+                write_offset_ = flushed_offset_ = offset;
+            }
+            total_capacity_ += segment->capacity;
+        }
+
+        // anything after the end is a torn write, clear it so that it's never mistaken for a record,
+        // even if the header of the torn record is intact but some bytes after it are not
+        if (write_offset_ < write_segment_->capacity) {
+            const auto tail = write_segment_->data() + write_offset_;
+            const auto tail_size = write_segment_->capacity - write_offset_;
+            if (any_of(tail, tail + tail_size, [](const char c) { return c != 0; })) {
+                memset(tail, 0, tail_size);
+                write_segment_->region.flush(write_offset_, tail_size, false);
+            }
+        }
+
+        checkpoint();
+    }
+
+    void Spool::checkpoint() const {
+        // the records are flushed first, so that the cursor never points past records lost on a power failure
+        flush_written();
+
+        const auto path = ansi(dir_ + CURSOR_FILENAME);
+        const auto tmp_path = path + ".tmp";
+        if (ofstream f(tmp_path, ios::trunc); f.is_open()) {
+            f << segment_ids_.front() << " " << read_offset_;
+        }
+        error_code ec;
+        fs::rename(tmp_path, path, ec);
+    }
+
+    void Spool::flush_written() const {
+        if (write_offset_ > flushed_offset_) {
+            write_segment_->region.flush(flushed_offset_, write_offset_ - flushed_offset_, false);
+            flushed_offset_ = write_offset_;
+        }
+    }
+
+    void Spool::drop_read_segment() {
+        const auto id = segment_ids_.front();
+        total_capacity_ -= read_segment_->capacity;
+        segment_ids_.pop_front();
+        const auto next_id = segment_ids_.front();
+        read_segment_ = next_id == write_segment_->id ? write_segment_ : open_segment(next_id);
+        read_offset_ = 0;
+        checkpoint();
+
+        error_code ec;
+        fs::remove(ansi(segment_path(id)), ec);
+    }
+
+    bool Spool::push(const string &record) {
+        if (record.empty() || record.size() > numeric_limits<uint32_t>::max()) {
+            return false;
+        }
+        const auto record_size = RECORD_HEADER_SIZE + record.size();
+
+        unique_lock<mutex> lock(mutex_);
+        if (write_offset_ + record_size > write_segment_->capacity) {
+            // a record larger than a segment gets a segment of its own size
+            if (total_capacity_ + max(options_.segment_size, record_size) > options_.max_size) {
+                return false;
+            }
+            flush_written();
+            const auto id = segment_ids_.back() + 1;
+            write_segment_ = open_segment(id, record_size);
+            segment_ids_.push_back(id);
+            total_capacity_ += write_segment_->capacity;
+            write_offset_ = flushed_offset_ = 0;
+        }
+
+        // the length goes last, so that the record doesn't exist until it's complete
+        const auto length = static_cast<uint32_t>(record.size());
+        const auto checksum = crc32(record.data(), record.size());
+        const auto dest = write_segment_->data() + write_offset_;
+        memcpy(dest + RECORD_HEADER_SIZE, record.data(), record.size());
+        memcpy(dest + sizeof(uint32_t), &checksum, sizeof(uint32_t));
+        memcpy(dest, &length, sizeof(uint32_t));
+
+        write_offset_ += record_size;
+        count_++;
+        return true;
+    }
+
+    optional<string> Spool::front() {
+        unique_lock<mutex> lock(mutex_);
+        if (count_ == 0) {
+            return nullopt;
+        }
+        auto record = read_segment_->record_at(read_offset_);
+        while (!record && read_segment_ != write_segment_) {
+            drop_read_segment();
+            record = read_segment_->record_at(read_offset_);
+        }
+        if (!record) {
+            return nullopt;
+        }
+        return string(*record);
+    }
+
+    void Spool::pop() {
+        unique_lock<mutex> lock(mutex_);
+        if (count_ == 0) {
+            return;
+        }
+        auto record = read_segment_->record_at(read_offset_);
+        while (!record && read_segment_ != write_segment_) {
+            drop_read_segment();
+            record = read_segment_->record_at(read_offset_);
+        }
+        if (!record) {
+            return;
+        }
+
+        read_offset_ += RECORD_HEADER_SIZE + record->size();
+        count_--;
+
+        if (read_segment_ != write_segment_ && !read_segment_->record_at(read_offset_)) {
+            // the segment is consumed, delete it at once
+            drop_read_segment();
+            pops_since_checkpoint_ = 0;
+        } else if (count_ == 0) {
+            // everything is consumed, so the space of the write segment can be reused from the start
+            memset(write_segment_->data(), 0, write_offset_);
+            write_segment_->region.flush(0, write_offset_, false);
+            read_offset_ = write_offset_ = flushed_offset_ = 0;
+            checkpoint();
+            pops_since_checkpoint_ = 0;
+        } else if (++pops_since_checkpoint_ >= CHECKPOINT_EVERY) {
+            checkpoint();
+            pops_since_checkpoint_ = 0;
+        }
+    }
+
+    void Spool::flush() {
+        unique_lock<mutex> lock(mutex_);
+        if (write_offset_ == flushed_offset_) {
+            return;
+        }
+        // the segment is kept mapped by the reference, even if it's rolled over in the meantime
+        const auto segment = write_segment_;
+        const auto offset = flushed_offset_;
+        const auto size = write_offset_ - flushed_offset_;
+        flushed_offset_ = write_offset_;
+        lock.unlock();
+        segment->region.flush(offset, size, false);
+    }
+
+    bool Spool::empty() const {
+        unique_lock<mutex> lock(mutex_);
+        return count_ == 0;
+    }
+
+    size_t Spool::size() const {
+        unique_lock<mutex> lock(mutex_);
+        return count_;
+    }
+
+    Replayer::Replayer(shared_ptr<Spool> spool, Deliver deliver, const Options &options)
+        : spool_(move(spool)), deliver_(move(deliver)), options_(options) {
+        thread_ = thread([this] { run(); });
+    }
+
+    Replayer::~Replayer() {
+        stop();
+
+        // the deliveries still unsettled are lost anyway, but the records held behind them are not
+        unique_lock<mutex> lock(reservations_mutex_);
+        for (const auto &reservation : reservations_) {
+            if (reservation.record) {
+                spool_->push(*reservation.record);
+            }
+        }
+    }
+
+    bool Replayer::push(const string &record) {
+        {
+            unique_lock<mutex> lock(reservations_mutex_);
+            if (!reservations_.empty()) {
+                reservations_.push_back({true, record});
+                held_++;
+                return true;
+            }
+            if (!spool_->push(record)) {
+                return false;
+            }
+        }
+        notify();
+        return true;
+    }
+
+    Replayer::Ticket Replayer::reserve() {
+        unique_lock<mutex> lock(reservations_mutex_);
+        reservations_.emplace_back();
+        return first_ticket_ + reservations_.size() - 1;
+    }
+
+    bool Replayer::push(const Ticket ticket, const string &record) { return settle(ticket, record); }
+
+    bool Replayer::release(const Ticket ticket) { return settle(ticket, nullopt); }
+
+    bool Replayer::settle(const Ticket ticket, optional<string> record) {
+        auto ok = true, pushed = false;
+        {
+            unique_lock<mutex> lock(reservations_mutex_);
+            auto &reservation = reservations_.at(ticket - first_ticket_);
+            reservation.settled = true;
+            if (record) {
+                reservation.record = move(record);
+                held_++;
+            }
+
+            // spool the records in the order of the reservations, up to the first one not settled yet
+            while (!reservations_.empty() && reservations_.front().settled) {
+                if (const auto &front = reservations_.front().record) {
+                    ok = spool_->push(*front) && ok;
+                    pushed = true;
+                    held_--;
+                }
+                reservations_.pop_front();
+                first_ticket_++;
+            }
+        }
+        if (pushed) {
+            notify();
+        }
+        return ok;
+    }
+
+    bool Replayer::pending() const {
+        {
+            unique_lock<mutex> lock(reservations_mutex_);
+            if (held_ > 0) {
+                return true;
+            }
+        }
+        return !spool_->empty();
+    }
+
+    void Replayer::notify() {
+        {
+            unique_lock<mutex> lock(mutex_);
+            notified_ = true;
+        }
+        cv_.notify_all();
+    }
+
+    void Replayer::stop() {
+        {
+            unique_lock<mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    bool Replayer::wait_for(const chrono::steady_clock::duration duration, const bool wake_on_notify) {
+        unique_lock<mutex> lock(mutex_);
+        cv_.wait_for(lock, duration, [&] { return stopping_ || (wake_on_notify && notified_); });
+        notified_ = false;
+        return stopping_;
+    }
+
+    void Replayer::run() {
+        const auto interval = chrono::microseconds(1000000 / max<size_t>(options_.rate, 1));
+        auto last_flush = chrono::steady_clock::now();
+        while (true) {
+            if (const auto now = chrono::steady_clock::now(); now - last_flush >= options_.flush_interval) {
+                spool_->flush();
+                last_flush = now;
+            }
+
+            const auto record = spool_->front();
+            if (!record) {
+                unique_lock<mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return stopping_ || notified_; });
+                notified_ = false;
+                if (stopping_) {
+                    break;
+                }
+                continue;
+            }
+
+            auto delivered = false;
+            try {
+                delivered = deliver_(*record);
+            } catch (...) {
+            }
+
+            if (delivered) {
+                spool_->pop();
+                // pushes don't cut this short, so that the replay is bounded to the rate
+                if (wait_for(interval, false)) {
+                    break;
+                }
+            } else if (wait_for(options_.retry_interval, true)) {
+                break;
+            }
+        }
+    }
+} // namespace cqhttp::utils::spool
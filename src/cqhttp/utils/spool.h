@@ -0,0 +1,171 @@
+#pragma once
+
+#include "cqhttp/core/common.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace cqhttp::utils::spool {
+    /**
+     * A durable FIFO queue of records, stored in a directory as an append-only log of memory-mapped segment files.
+     *
+     * Each record is framed with its length and CRC32 checksum, so that a torn write at the tail
+     * (the process crashed while appending) is detected and discarded when the spool is opened again.
+     * A segment file is deleted as soon as all its records are consumed.
+     * The read position is only persisted every few records, so after a crash some records may come out twice.
+     * Appended records are written through to the disk by flush(), and before each checkpoint of the read position,
+     * not one by one, so a power failure may lose the records appended since then.
+     */
+    class Spool {
+    public:
+        struct Options {
+            size_t segment_size = 4 * 1024 * 1024;
+            size_t max_size = 256 * 1024 * 1024; // total size of the segment files
+        };
+
+        Spool(const std::string &dir, const Options &options);
+        ~Spool();
+
+        Spool(const Spool &) = delete;
+        Spool &operator=(const Spool &) = delete;
+
+        /**
+         * Append a record. Return false if the spool is full.
+         */
+        bool push(const std::string &record);
+
+        /**
+         * Get the oldest record without removing it.
+         */
+        std::optional<std::string> front();
+
+        /**
+         * Remove the oldest record.
+         */
+        void pop();
+
+        /**
+         * Write the records appended since the last flush through to the disk.
+         */
+        void flush();
+
+        bool empty() const;
+        size_t size() const;
+
+    private:
+        struct Segment;
+
+        std::string dir_;
+        Options options_;
+
+        mutable std::mutex mutex_;
+        std::deque<uint64_t> segment_ids_;
+        std::shared_ptr<Segment> read_segment_;
+        std::shared_ptr<Segment> write_segment_;
+        size_t read_offset_ = 0;
+        size_t write_offset_ = 0;
+        mutable size_t flushed_offset_ = 0; // the records of the write segment before it are on the disk
+        size_t total_capacity_ = 0; // of the segment files, which may be larger than segment_size
+        size_t count_ = 0;
+        size_t pops_since_checkpoint_ = 0;
+
+        std::string segment_path(uint64_t id) const;
+        std::shared_ptr<Segment> open_segment(uint64_t id, size_t min_capacity = 0) const;
+        void recover();
+        void checkpoint() const;
+        void flush_written() const;
+        void drop_read_segment();
+    };
+
+    /**
+     * Deliver the records of a spool in order on a background thread, at a bounded rate.
+     * A record is removed only after it's delivered, failed deliveries are retried after an interval.
+     *
+     * Records being delivered directly by the caller can reserve their place in the spool beforehand,
+     * so that if the delivery fails, the record is spooled ahead of the records pushed after the reservation.
+     */
+    class Replayer {
+    public:
+        using Deliver = std::function<bool(const std::string &record)>;
+        using Ticket = uint64_t;
+
+        struct Options {
+            size_t rate = 100; // records per second
+            std::chrono::milliseconds retry_interval{3000};
+            std::chrono::milliseconds flush_interval{1000}; // how often the spooled records are written to the disk
+        };
+
+        Replayer(std::shared_ptr<Spool> spool, Deliver deliver, const Options &options);
+        ~Replayer();
+
+        Replayer(const Replayer &) = delete;
+        Replayer &operator=(const Replayer &) = delete;
+
+        /**
+         * Spool a record, to be delivered after all records spooled or reserved before.
+         * While earlier reservations are not settled, the record is held in memory.
+         * Return false if the spool is full, and records ready to be spooled are dropped.
+         */
+        bool push(const std::string &record);
+
+        /**
+         * Reserve the place of a record that is being delivered directly.
+         * The reservation must be settled once, with push(ticket, record) if the delivery fails,
+         * or with release(ticket) otherwise.
+         */
+        Ticket reserve();
+
+        /**
+         * Spool the record of a failed delivery at the place reserved for it.
+         * Return false if the spool is full, and records ready to be spooled are dropped.
+         */
+        bool push(Ticket ticket, const std::string &record);
+
+        /**
+         * Give up the place reserved for a record, because it's delivered.
+         * Return false if the spool is full, and records ready to be spooled are dropped.
+         */
+        bool release(Ticket ticket);
+
+        /**
+         * Whether there are records waiting to be delivered.
+         * New records should be pushed here too while it's true, to keep the order.
+         */
+        bool pending() const;
+
+        /**
+         * Wake up the replayer, e.g. when the receiver becomes available, so that it retries at once.
+         */
+        void notify();
+
+        void stop();
+
+    private:
+        std::shared_ptr<Spool> spool_;
+        Deliver deliver_;
+        Options options_;
+
+        struct Reservation {
+            bool settled = false;
+            std::optional<std::string> record; // to be spooled once the reservations before are settled
+        };
+
+        mutable std::mutex reservations_mutex_;
+        std::deque<Reservation> reservations_;
+        Ticket first_ticket_ = 0; // of the front of reservations_
+        size_t held_ = 0; // records held in reservations_
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool notified_ = false;
+        bool stopping_ = false;
+        std::thread thread_;
+
+        void run();
+        bool settle(Ticket ticket, std::optional<std::string> record);
+        bool wait_for(std::chrono::steady_clock::duration duration, bool wake_on_notify);
+    };
+} // namespace cqhttp::utils::spool
@@ -1,28 +1,51 @@
 #include "./api.h"
 
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
 using namespace std;
 
 namespace cq::api {
-    static vector<function<void(HMODULE)>> api_func_initializers;
+#ifdef _WIN32
+    using ModuleHandle = HMODULE;
+
+    static ModuleHandle get_coolq_module() { return GetModuleHandleW(L"CQP.dll"); }
+
+    static void *get_proc_address(const ModuleHandle module, const char *name) {
+        return reinterpret_cast<void *>(GetProcAddress(module, name));
+    }
+#else
+    using ModuleHandle = void *;
+
+    /**
+     * Outside CoolQ (e.g. the mock host), the "CQ_*" functions are exported by the host executable itself.
+     */
+    static ModuleHandle get_coolq_module() { return dlopen(nullptr, RTLD_LAZY); }
+
+    static void *get_proc_address(const ModuleHandle module, const char *name) { return dlsym(module, name); }
+#endif
+
+    static vector<function<void(ModuleHandle)>> api_func_initializers;
 
-    static bool add_func_initializer(const function<void(HMODULE)> &initializer) {
+    static bool add_func_initializer(const function<void(ModuleHandle)> &initializer) {
         api_func_initializers.push_back(initializer);
         return true;
     }
 
     void __init() {
-        const auto dll = GetModuleHandleW(L"CQP.dll");
+        const auto dll = get_coolq_module();
         for (const auto &initializer : api_func_initializers) {
             initializer(dll);
         }
     }
 
     namespace raw {
-#define FUNC(ReturnType, FuncName, ...)                                                              \
-    typedef __declspec(dllimport) ReturnType(__stdcall *__CQ_##FuncName##_T)(__VA_ARGS__);           \
-    __CQ_##FuncName##_T CQ_##FuncName;                                                               \
-    static bool __dummy_CQ_##FuncName = add_func_initializer([](auto dll) {                          \
-        CQ_##FuncName = reinterpret_cast<__CQ_##FuncName##_T>(GetProcAddress(dll, "CQ_" #FuncName)); \
+#define FUNC(ReturnType, FuncName, ...)                                                                 \
+    typedef ReturnType(__stdcall *__CQ_##FuncName##_T)(__VA_ARGS__);                                    \
+    __CQ_##FuncName##_T CQ_##FuncName;                                                                  \
+    static bool __dummy_CQ_##FuncName = add_func_initializer([](auto dll) {                             \
+        CQ_##FuncName = reinterpret_cast<__CQ_##FuncName##_T>(get_proc_address(dll, "CQ_" #FuncName)); \
     });
 
 #include "./api_funcs.h"
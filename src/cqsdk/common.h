@@ -1,6 +1,12 @@
 #pragma once
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+// calling conventions only exist on Windows, the mock host and other portable builds just ignore them
+#define __stdcall
+#endif
+
 #include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <cstdint>
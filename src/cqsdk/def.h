@@ -1,5 +1,9 @@
 #pragma once
 
+#ifdef _WIN32
 #define __CQ_EVENT(ReturnType, Name, Size)                                                            \
     __pragma(comment(linker, "/EXPORT:" #Name "=_" #Name "@" #Size)) extern "C" __declspec(dllexport) \
         ReturnType __stdcall Name
+#else
+#define __CQ_EVENT(ReturnType, Name, Size) extern "C" __attribute__((visibility("default"))) ReturnType Name
+#endif
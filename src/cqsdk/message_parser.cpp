@@ -0,0 +1,286 @@
+#include "./message_parser.h"
+
+#include <cstring>
+
+#include "./utils/simd.h"
+
+using namespace std;
+
+namespace cq::message {
+    static const string_view TEXT_TYPE = "text";
+
+    static bool is_special(const char c, const bool escape_comma) {
+        return c == '&' || c == '[' || c == ']' || (escape_comma && c == ',');
+    }
+
+    /**
+     * Find the first character to escape, 16 bytes at a time where SSE2 is available.
+     */
+    static size_t find_special(const string_view str, const bool escape_comma) {
+        size_t i = 0;
+#ifdef CQSDK_SSE2
+        const auto amp = _mm_set1_epi8('&');
+        const auto left = _mm_set1_epi8('[');
+        const auto right = _mm_set1_epi8(']');
+        const auto comma = _mm_set1_epi8(escape_comma ? ',' : '&');
+        for (; i + 16 <= str.size(); i += 16) {
+            const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data() + i));
+            const auto hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, amp), _mm_cmpeq_epi8(chunk, left)),
+                                           _mm_or_si128(_mm_cmpeq_epi8(chunk, right), _mm_cmpeq_epi8(chunk, comma)));
+            if (const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits))) {
+                return i + utils::count_trailing_zeros(mask);
+            }
+        }
+#endif
+        for (; i < str.size(); i++) {
+            if (is_special(str[i], escape_comma)) {
+                return i;
+            }
+        }
+        return string_view::npos;
+    }
+
+    bool needs_escaping(const string_view str, const bool escape_comma) {
+        return find_special(str, escape_comma) != string_view::npos;
+    }
+
+    void append_escaped(string &out, string_view str, const bool escape_comma) {
+        while (true) {
+            const auto special = find_special(str, escape_comma);
+            out.append(str.substr(0, special));
+            if (special == string_view::npos) {
+                return;
+            }
+            switch (str[special]) {
+            case '&':
+                out.append("&amp;");
+                break;
+            case '[':
+                out.append("&#91;");
+                break;
+            case ']':
+                out.append("&#93;");
+                break;
+            default:
+                out.append("&#44;");
+                break;
+            }
+            str.remove_prefix(special + 1);
+        }
+    }
+
+    void append_unescaped(string &out, string_view str) {
+        static const pair<string_view, char> entities[] = {{"&#44;", ','}, {"&#91;", '['}, {"&#93;", ']'}, {"&amp;", '&'}};
+
+        // "&" is searched with memchr, which is vectorized by the C library
+        // the entities contain no "&" but the leading one, and the characters they stand for are not in any of them,
+        // so decoding them in one pass is the same as replacing them one kind after another
+        while (true) {
+            const auto amp = str.find('&');
+            out.append(str.substr(0, amp));
+            if (amp == string_view::npos) {
+                return;
+            }
+            str.remove_prefix(amp);
+
+            auto decoded = false;
+            for (const auto &[entity, c] : entities) {
+                if (str.substr(0, entity.size()) == entity) {
+                    out.push_back(c);
+                    str.remove_prefix(entity.size());
+                    decoded = true;
+                    break;
+                }
+            }
+            if (!decoded) {
+                out.push_back('&');
+                str.remove_prefix(1);
+            }
+        }
+    }
+
+    size_t estimate_message_size(const Message &msg) {
+        size_t size = 0;
+        for (const auto &seg : msg) {
+            if (seg.type == TEXT_TYPE) {
+                if (const auto it = seg.data.find("text"); it != seg.data.end()) {
+                    size += it->second.size();
+                }
+            } else if (!seg.type.empty()) {
+                size += 5 + seg.type.size(); // "[CQ:" and "]"
+                for (const auto &[key, value] : seg.data) {
+                    size += 2 + key.size() + value.size(); // "," and "="
+                }
+            }
+        }
+        return size;
+    }
+
+    void append_segment(string &out, const MessageSegment &seg) {
+        if (seg.type.empty()) {
+            return;
+        }
+        if (seg.type == TEXT_TYPE) {
+            if (const auto it = seg.data.find("text"); it != seg.data.end()) {
+                append_escaped(out, it->second, false);
+            }
+        } else {
+            out += "[CQ:";
+            out += seg.type;
+            for (const auto &[key, value] : seg.data) {
+                out += ',';
+                out += key;
+                out += '=';
+                append_escaped(out, value, true);
+            }
+            out += ']';
+        }
+    }
+
+    void append_message(string &out, const Message &msg) {
+        for (const auto &seg : msg) {
+            append_segment(out, seg);
+        }
+    }
+
+    string SegmentView::text() const {
+        string result;
+        result.reserve(raw.size());
+        append_unescaped(result, raw);
+        return result;
+    }
+
+    optional<string_view> SegmentView::raw_param(const string_view key) const {
+        optional<string_view> value;
+        for_each_param([&](const string_view k, const string_view v) {
+            if (k == key) {
+                value = v;
+            }
+        });
+        return value;
+    }
+
+    optional<string> SegmentView::param(const string_view key) const {
+        if (const auto value = raw_param(key)) {
+            string result;
+            append_unescaped(result, *value);
+            return result;
+        }
+        return nullopt;
+    }
+
+    MessageSegment SegmentView::to_segment() const {
+        if (!cq_code) {
+            return MessageSegment{string(TEXT_TYPE), {{string(TEXT_TYPE), text()}}};
+        }
+        MessageSegment segment{string(type), {}};
+        for_each_param([&](const string_view key, const string_view value) {
+            auto &data_value = segment.data[string(key)];
+            data_value.clear();
+            append_unescaped(data_value, value);
+        });
+        return segment;
+    }
+
+    string_view SegmentView::trim(string_view str) {
+        static const auto SPACES = " \t\n\v\f\r";
+        const auto begin = str.find_first_not_of(SPACES);
+        if (begin == string_view::npos) {
+            return {};
+        }
+        return str.substr(begin, str.find_last_not_of(SPACES) - begin + 1);
+    }
+
+    static bool is_alnum(const char c) { return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'); }
+
+    enum class CQCodeScan {
+        FOUND,
+        NOT_CQ_CODE, // the "[" at the position is just text
+        UNTERMINATED, // the rest of the string is text
+    };
+
+    /**
+     * Try to read a CQ code starting at "pos" of "str", which is a "[".
+     */
+    static CQCodeScan scan_cq_code(const string_view str, const size_t pos, SegmentView &segment, size_t &end) {
+        // "[CQ:a]" at least, and the type can't be empty unless there are parameters
+        if (str.size() - pos < 6 || str.compare(pos + 1, 3, "CQ:") != 0 || str[pos + 4] == ']') {
+            return CQCodeScan::NOT_CQ_CODE;
+        }
+
+        auto i = pos + 4;
+        while (i < str.size() && is_alnum(str[i])) {
+            i++;
+        }
+        if (i == str.size()) {
+            return CQCodeScan::UNTERMINATED;
+        }
+
+        segment.type = str.substr(pos + 4, i - (pos + 4));
+        segment.cq_code = true;
+        if (str[i] == ']') {
+            segment.raw = {};
+            end = i + 1;
+            return CQCodeScan::FOUND;
+        }
+        if (str[i] != ',') {
+            return CQCodeScan::NOT_CQ_CODE;
+        }
+
+        const auto close = str.find(']', i + 1);
+        if (close == string_view::npos) {
+            return CQCodeScan::UNTERMINATED;
+        }
+        segment.raw = str.substr(i + 1, close - (i + 1));
+        end = close + 1;
+        return CQCodeScan::FOUND;
+    }
+
+    bool MessageParser::next(SegmentView &segment) {
+        if (pending_) {
+            segment = *pending_;
+            pending_.reset();
+            return true;
+        }
+        if (rest_.empty()) {
+            return false;
+        }
+
+        const auto text_segment = [&](const size_t length) {
+            segment = SegmentView{TEXT_TYPE, rest_.substr(0, length), false};
+            rest_.remove_prefix(length);
+        };
+
+        size_t search_from = 0;
+        while (true) {
+            const auto pos = rest_.find('[', search_from);
+            if (pos == string_view::npos) {
+                text_segment(rest_.size());
+                return true;
+            }
+
+            SegmentView cq_code;
+            size_t end = 0;
+            switch (scan_cq_code(rest_, pos, cq_code, end)) {
+            case CQCodeScan::FOUND:
+                if (pos > 0) {
+                    // the text before the CQ code goes first
+                    pending_ = cq_code;
+                    text_segment(pos);
+                    rest_.remove_prefix(end - pos);
+                } else {
+                    segment = cq_code;
+                    rest_.remove_prefix(end);
+                }
+                return true;
+            case CQCodeScan::NOT_CQ_CODE:
+                // no "[" could be skipped, since only "CQ:" and alphanumeric characters were read
+                search_from = pos + 1;
+                break;
+            case CQCodeScan::UNTERMINATED:
+                text_segment(rest_.size());
+                return true;
+            }
+        }
+    }
+} // namespace cq::message
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "./common.h"
+
+#include <optional>
+#include <string_view>
+
+#include "./message.h"
+
+namespace cq::message {
+    /**
+     * Check whether the given string has any character to escape.
+     */
+    bool needs_escaping(std::string_view str, bool escape_comma);
+
+    /**
+     * Append the escaped form of the given string to "out".
+     */
+    void append_escaped(std::string &out, std::string_view str, bool escape_comma);
+
+    /**
+     * Append the unescaped form of the given string to "out".
+     */
+    void append_unescaped(std::string &out, std::string_view str);
+
+    /**
+     * Get the length of the message string of the given message, not counting the characters added by escaping.
+     * Good for reserving the output buffer before "append_message()".
+     */
+    size_t estimate_message_size(const Message &msg);
+
+    /**
+     * Append the given segment to "out", as it's in a message string.
+     */
+    void append_segment(std::string &out, const MessageSegment &seg);
+
+    /**
+     * Append the message string of the given message to "out", which is what "Message::operator std::string()" gives.
+     */
+    void append_message(std::string &out, const Message &msg);
+
+    /**
+     * A segment of a message string, made of views into the string, with the escaped characters kept.
+     * Owned strings are only made on demand, by "text()", "param()" and "to_segment()".
+     */
+    struct SegmentView {
+        std::string_view type; // "text" for plain text
+        std::string_view raw; // the text, or the parameters of a CQ code, e.g. "file=1.jpg,url=https://..."
+        bool cq_code = false;
+
+        /**
+         * Get the unescaped text of a plain text segment.
+         */
+        std::string text() const;
+
+        /**
+         * Call "func(key, raw_value)" for each parameter of the CQ code in order, with the value still escaped.
+         */
+        template <typename F>
+        void for_each_param(F &&func) const {
+            if (!cq_code) {
+                return;
+            }
+            auto rest = raw;
+            while (true) {
+                const auto comma = rest.find(',');
+                const auto param = rest.substr(0, comma);
+                if (const auto eq = param.find('='); eq != std::string_view::npos) {
+                    func(trim(param.substr(0, eq)), param.substr(eq + 1));
+                }
+                if (comma == std::string_view::npos) {
+                    break;
+                }
+                rest.remove_prefix(comma + 1);
+            }
+        }
+
+        /**
+         * Get the escaped value of a parameter. If a key appears more than once, the last one counts.
+         */
+        std::optional<std::string_view> raw_param(std::string_view key) const;
+
+        /**
+         * Get the unescaped value of a parameter.
+         */
+        std::optional<std::string> param(std::string_view key) const;
+
+        MessageSegment to_segment() const;
+
+    private:
+        static std::string_view trim(std::string_view str);
+    };
+
+    /**
+     * Scan a message string for CQ codes, yielding its segments one by one as views into the string.
+     *
+     * The string is searched for "[" with memchr, so long runs of text cost next to nothing, and nothing is
+     * copied or unescaped until asked for. The segments are exactly those "Message(const std::string &)" makes.
+     */
+    class MessageParser {
+    public:
+        explicit MessageParser(const std::string_view msg) : rest_(msg) {}
+
+        /**
+         * Get the next segment, return false if there is no more.
+         */
+        bool next(SegmentView &segment);
+
+    private:
+        std::string_view rest_;
+        std::optional<SegmentView> pending_; // a CQ code found right after the text segment just returned
+    };
+} // namespace cq::message
@@ -23,13 +23,22 @@ namespace cq {
          */
         template <typename Container>
         static Container multi_from_base64(const std::string &b64) {
+            using T = typename Container::value_type;
+
             Container result;
-            auto inserter = std::back_inserter(result);
-            auto pack = utils::BinPack(utils::base64::decode(b64));
+            const auto bytes = utils::base64::decode(b64);
+            utils::BinPack pack(bytes);
             try {
                 const auto count = pack.pop_int<int32_t>();
+                if constexpr (std::is_same_v<Container, std::vector<T>>) {
+                    // each object takes 2 bytes of length and at least T::MIN_SIZE bytes, so a broken count can't
+                    // make us reserve more than the data can hold
+                    result.reserve(std::min(static_cast<size_t>(std::max(count, 0)), pack.size() / (2 + T::MIN_SIZE)));
+                }
+                auto inserter = std::back_inserter(result);
                 for (auto i = 0; i < count; i++) {
-                    *inserter = Container::value_type::from_bytes(pack.pop_token());
+                    // the objects are parsed from views into the decoded bytes, nothing is copied but the strings
+                    *inserter = T::from_bytes(pack.pop_token());
                 }
             } catch (exception::BytesNotEnough &) {
                 throw exception::ParseError("failed to parse from bytes to multiple objects");
@@ -50,8 +59,8 @@ namespace cq {
         Sex sex = Sex::UNKNOWN;
         int32_t age = 0;
 
-        static User from_bytes(const std::string &bytes) {
-            auto pack = utils::BinPack(bytes);
+        static User from_bytes(const std::string_view bytes) {
+            utils::BinPack pack(bytes);
             User stranger;
             try {
                 stranger.user_id = pack.pop_int<int64_t>();
@@ -74,8 +83,8 @@ namespace cq {
         // Sex sex; // from User, not using
         // int32_t age; // from User, not using
 
-        static Friend from_bytes(const std::string &bytes) {
-            auto pack = utils::BinPack(bytes);
+        static Friend from_bytes(const std::string_view bytes) {
+            utils::BinPack pack(bytes);
             Friend frnd;
             try {
                 frnd.user_id = pack.pop_int<int64_t>();
@@ -96,8 +105,8 @@ namespace cq {
         int32_t member_count = 0; // only available with get_group_info()
         int32_t max_member_count = 0; // only available with get_group_info()
 
-        static Group from_bytes(const std::string &bytes) {
-            auto pack = utils::BinPack(bytes);
+        static Group from_bytes(const std::string_view bytes) {
+            utils::BinPack pack(bytes);
             Group group;
             try {
                 group.group_id = pack.pop_int<int64_t>();
@@ -134,8 +143,8 @@ namespace cq {
         int32_t title_expire_time = 0;
         bool card_changeable = false;
 
-        static GroupMember from_bytes(const std::string &bytes) {
-            auto pack = utils::BinPack(bytes);
+        static GroupMember from_bytes(const std::string_view bytes) {
+            utils::BinPack pack(bytes);
             GroupMember member;
             try {
                 member.group_id = pack.pop_int<int64_t>();
@@ -168,13 +177,13 @@ namespace cq {
         std::string token; // binary
         std::string flag; // base64 of the whole Anonymous object
 
-        static Anonymous from_bytes(const std::string &bytes) {
-            auto pack = utils::BinPack(bytes);
+        static Anonymous from_bytes(const std::string_view bytes) {
+            utils::BinPack pack(bytes);
             Anonymous anonymous;
             try {
                 anonymous.id = pack.pop_int<int64_t>();
                 anonymous.name = pack.pop_string();
-                anonymous.token = pack.pop_token();
+                anonymous.token = std::string(pack.pop_token());
                 // NOTE: we don't initialize "flag" here because it represents the
                 // whole object it will be initialized in the specialized
                 // ObjectHelper::from_base64 function
@@ -200,8 +209,8 @@ namespace cq {
         int64_t size = 0;
         int64_t busid = 0;
 
-        static File from_bytes(const std::string &bytes) {
-            auto pack = utils::BinPack(bytes);
+        static File from_bytes(const std::string_view bytes) {
+            utils::BinPack pack(bytes);
             File file;
             try {
                 file.id = pack.pop_string();
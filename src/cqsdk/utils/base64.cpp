@@ -1,8 +1,306 @@
 #include "./base64.h"
 
-#include "./vendor/cpp-base64/base64.h"
+#include <array>
+#include <atomic>
+#include <cstring>
+
+#include "./simd.h"
+
+using namespace std;
 
 namespace cq::utils::base64 {
-    std::string encode(const unsigned char *bytes, const unsigned int len) { return base64_encode(bytes, len); }
-    std::string decode(const std::string &str) { return base64_decode(str); }
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static const uint8_t INVALID = 0xFF;
+
+    static const auto DECODE_TABLE = [] {
+        array<uint8_t, 256> table{};
+        table.fill(INVALID);
+        for (uint8_t i = 0; i < 64; i++) {
+            table[static_cast<uint8_t>(ALPHABET[i])] = i;
+        }
+        return table;
+    }();
+
+    // the kernels below encode or decode whole blocks, and return how much of the input they consumed,
+    // leaving the rest to the scalar code, which also handles the characters out of the alphabet
+
+#ifdef CQSDK_X86
+    // the algorithms are from Wojciech Muła and Daniel Lemire, "Faster Base64 Encoding and Decoding using AVX2
+    // Instructions", see http://0x80.pl/notesen/2016-01-17-sse-base64-decoding.html for the details
+
+    CQSDK_TARGET("ssse3")
+    static __m128i encode_lookup(const __m128i indices) {
+        const auto shift_lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        auto shift = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        const auto less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        shift = _mm_or_si128(shift, _mm_and_si128(less, _mm_set1_epi8(13)));
+        return _mm_add_epi8(_mm_shuffle_epi8(shift_lut, shift), indices);
+    }
+
+    CQSDK_TARGET("ssse3")
+    static size_t encode_ssse3(const char *in, const size_t len, char *out) {
+        size_t i = 0;
+        // 12 bytes are encoded each time, but 16 are loaded
+        for (; len - i >= 16; i += 12, out += 16) {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            v = _mm_shuffle_epi8(v, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+            const auto t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+            const auto t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), encode_lookup(_mm_or_si128(t0, t1)));
+        }
+        return i;
+    }
+
+    CQSDK_TARGET("ssse3")
+    static bool decode_lookup(const __m128i v, __m128i &values) {
+        const auto lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+                                          0x1B, 0x1B, 0x1B, 0x1A);
+        const auto lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+                                          0x10, 0x10, 0x10, 0x10);
+        const auto lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+        const auto mask_0f = _mm_set1_epi8(0x0f);
+
+        const auto hi_nibbles = _mm_and_si128(_mm_srli_epi32(v, 4), mask_0f);
+        const auto lo_nibbles = _mm_and_si128(v, mask_0f);
+        const auto lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        const auto hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0xFFFF) {
+            // "=" or some character out of the alphabet
+            return false;
+        }
+        const auto eq_2f = _mm_cmpeq_epi8(v, _mm_set1_epi8(0x2F));
+        values = _mm_add_epi8(v, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles)));
+        return true;
+    }
+
+    CQSDK_TARGET("ssse3")
+    static __m128i decode_pack(const __m128i values) {
+        // [00aaaaaa 00bbbbbb 00cccccc 00dddddd] -> [aaaaaabb bbbbcccc ccdddddd] in the first 12 bytes
+        const auto ab_cd = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        const auto abcd = _mm_madd_epi16(ab_cd, _mm_set1_epi32(0x00011000));
+        return _mm_shuffle_epi8(abcd, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    }
+
+    CQSDK_TARGET("ssse3")
+    static size_t decode_ssse3(const char *in, const size_t len, char *out) {
+        size_t i = 0;
+        for (__m128i values; len - i >= 16; i += 16, out += 12) {
+            if (!decode_lookup(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i)), values)) {
+                break;
+            }
+            const auto packed = decode_pack(values);
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(out), packed);
+            const auto tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+            memcpy(out + 8, &tail, 4);
+        }
+        return i;
+    }
+
+    CQSDK_TARGET("avx2")
+    static __m256i encode_lookup(const __m256i indices) {
+        const auto shift_lut = _mm256_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0, 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        auto shift = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const auto less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        shift = _mm256_or_si256(shift, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        return _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, shift), indices);
+    }
+
+    CQSDK_TARGET("avx2")
+    static size_t encode_avx2(const char *in, const size_t len, char *out) {
+        size_t i = 0;
+        // 24 bytes are encoded each time, as two 12-byte lanes, but 28 are loaded
+        for (; len - i >= 28; i += 24, out += 32) {
+            const auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            const auto hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 12));
+            auto v = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+            v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, //
+                                                         1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+            const auto t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)),
+                                               _mm256_set1_epi32(0x04000040));
+            const auto t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)),
+                                               _mm256_set1_epi32(0x01000010));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), encode_lookup(_mm256_or_si256(t0, t1)));
+        }
+        return i;
+    }
+
+    CQSDK_TARGET("avx2")
+    static size_t decode_avx2(const char *in, const size_t len, char *out) {
+        const auto lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+                                             0x1B, 0x1B, 0x1B, 0x1A, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                             0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+        const auto lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+                                             0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                             0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+        const auto lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0, //
+                                               0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+        const auto mask_0f = _mm256_set1_epi8(0x0f);
+
+        size_t i = 0;
+        for (; len - i >= 32; i += 32, out += 24) {
+            const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+            const auto hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask_0f);
+            const auto lo_nibbles = _mm256_and_si256(v, mask_0f);
+            const auto lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+            const auto hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+            if (!_mm256_testz_si256(lo, hi)) {
+                break;
+            }
+            const auto eq_2f = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x2F));
+            const auto values = _mm256_add_epi8(v, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles)));
+
+            const auto ab_cd = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+            const auto abcd = _mm256_madd_epi16(ab_cd, _mm256_set1_epi32(0x00011000));
+            auto packed = _mm256_shuffle_epi8(abcd, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1,
+                                                                     -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                                                     -1, -1, -1, -1));
+            // move the 12 bytes of the two lanes together
+            packed = _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_castsi256_si128(packed));
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(out + 16), _mm256_extracti128_si256(packed, 1));
+        }
+        return i;
+    }
+#endif
+
+    static atomic<Kernel> current_kernel{best_kernel()};
+
+    Kernel best_kernel() {
+#ifdef CQSDK_X86
+        const auto &cpu = cpu_features();
+        if (cpu.avx2) {
+            return Kernel::AVX2;
+        }
+        if (cpu.ssse3) {
+            return Kernel::SSSE3;
+        }
+#endif
+        return Kernel::SCALAR;
+    }
+
+    bool use_kernel(const Kernel kernel) {
+        if (kernel > best_kernel()) {
+            return false;
+        }
+        current_kernel = kernel;
+        return true;
+    }
+
+    string encode(const string_view bytes) {
+        const auto in = bytes.data();
+        const auto len = bytes.size();
+        string result(encoded_size(len), '\0');
+        auto out = result.data();
+
+        size_t i = 0;
+        switch (current_kernel.load(memory_order_relaxed)) {
+#ifdef CQSDK_X86
+        case Kernel::AVX2:
+            i = encode_avx2(in, len, out);
+            break;
+        case Kernel::SSSE3:
+            i = encode_ssse3(in, len, out);
+            break;
+#endif
+        default:
+            break;
+        }
+        out += i / 3 * 4;
+
+        for (; len - i >= 3; i += 3, out += 4) {
+            const auto b0 = static_cast<uint8_t>(in[i]), b1 = static_cast<uint8_t>(in[i + 1]),
+                       b2 = static_cast<uint8_t>(in[i + 2]);
+            out[0] = ALPHABET[b0 >> 2];
+            out[1] = ALPHABET[(b0 & 0x03) << 4 | b1 >> 4];
+            out[2] = ALPHABET[(b1 & 0x0f) << 2 | b2 >> 6];
+            out[3] = ALPHABET[b2 & 0x3f];
+        }
+        if (len - i > 0) {
+            const auto b0 = static_cast<uint8_t>(in[i]);
+            const auto b1 = len - i > 1 ? static_cast<uint8_t>(in[i + 1]) : uint8_t{0};
+            out[0] = ALPHABET[b0 >> 2];
+            out[1] = ALPHABET[(b0 & 0x03) << 4 | b1 >> 4];
+            out[2] = len - i > 1 ? ALPHABET[(b1 & 0x0f) << 2] : '=';
+            out[3] = '=';
+        }
+        return result;
+    }
+
+    size_t decode(const string_view str, char *const out) {
+        const auto in = str.data();
+        const auto len = str.size();
+
+        size_t i = 0;
+        switch (current_kernel.load(memory_order_relaxed)) {
+#ifdef CQSDK_X86
+        case Kernel::AVX2:
+            i = decode_avx2(in, len, out);
+            // there may be a block of 16 left before where the AVX2 kernel stopped
+            i += decode_ssse3(in + i, len - i, out + i / 4 * 3);
+            break;
+        case Kernel::SSSE3:
+            i = decode_ssse3(in, len, out);
+            break;
+#endif
+        default:
+            break;
+        }
+        auto o = out + i / 4 * 3;
+
+        const auto &table = DECODE_TABLE;
+        for (; len - i >= 4; i += 4, o += 3) {
+            const auto a = table[static_cast<uint8_t>(in[i])], b = table[static_cast<uint8_t>(in[i + 1])],
+                       c = table[static_cast<uint8_t>(in[i + 2])], d = table[static_cast<uint8_t>(in[i + 3])];
+            if ((a | b | c | d) & 0x80) {
+                break;
+            }
+            o[0] = static_cast<char>(a << 2 | b >> 4);
+            o[1] = static_cast<char>(b << 4 | c >> 2);
+            o[2] = static_cast<char>(c << 6 | d);
+        }
+
+        // the last (maybe partial) quad, with i characters decoding to i - 1 bytes
+        uint8_t quad[4]{};
+        size_t n = 0;
+        for (; n < 4 && i + n < len; n++) {
+            const auto v = table[static_cast<uint8_t>(in[i + n])];
+            if (v == INVALID) {
+                break;
+            }
+            quad[n] = v;
+        }
+        if (n > 1) {
+            o[0] = static_cast<char>(quad[0] << 2 | quad[1] >> 4);
+        }
+        if (n > 2) {
+            o[1] = static_cast<char>(quad[1] << 4 | quad[2] >> 2);
+        }
+        return o - out + (n > 0 ? n - 1 : 0);
+    }
+
+    string decode(const string_view str) {
+        string result(max_decoded_size(str.size()), '\0');
+        result.resize(decode(str, result.data()));
+        return result;
+    }
+
+    bool decode(string_view str, ostream &out) {
+        static const size_t CHUNK_SIZE = 64 * 1024; // characters, must be a multiple of 4
+        string buffer(max_decoded_size(min(str.size(), CHUNK_SIZE)), '\0');
+        while (!str.empty() && out.good()) {
+            const auto chunk = str.substr(0, CHUNK_SIZE);
+            const auto n = decode(chunk, buffer.data());
+            out.write(buffer.data(), n);
+            if (n < chunk.size() / 4 * 3) {
+                // stopped at "=" or an invalid character
+                break;
+            }
+            str.remove_prefix(chunk.size());
+        }
+        return out.good();
+    }
 } // namespace cq::utils::base64
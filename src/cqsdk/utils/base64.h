@@ -2,7 +2,50 @@
 
 #include "../common.h"
 
+#include <ostream>
+#include <string_view>
+
 namespace cq::utils::base64 {
-    std::string encode(const unsigned char *bytes, unsigned int len);
-    std::string decode(const std::string &str);
+    /**
+     * The implementations of the codec, the best one the CPU supports is used by default.
+     */
+    enum class Kernel { SCALAR, SSSE3, AVX2 };
+
+    /**
+     * Get the best kernel the CPU supports.
+     */
+    Kernel best_kernel();
+
+    /**
+     * Use the given kernel from now on, for benchmarking and testing.
+     * Returns false and changes nothing if the CPU doesn't support it.
+     */
+    bool use_kernel(Kernel kernel);
+
+    constexpr size_t encoded_size(const size_t len) { return (len + 2) / 3 * 4; }
+
+    /**
+     * The size of the buffer, that the decoded bytes of a string of the given length fit in.
+     */
+    constexpr size_t max_decoded_size(const size_t len) { return len / 4 * 3 + 3; }
+
+    std::string encode(std::string_view bytes);
+
+    inline std::string encode(const unsigned char *bytes, const unsigned int len) {
+        return encode(std::string_view(reinterpret_cast<const char *>(bytes), len));
+    }
+
+    /**
+     * Decode into a buffer of at least max_decoded_size(str.size()) bytes, and return the number of bytes written.
+     * Like the original decoder, the decoding stops at the first "=" or character out of the base64 alphabet.
+     */
+    size_t decode(std::string_view str, char *out);
+
+    std::string decode(std::string_view str);
+
+    /**
+     * Decode into a stream piece by piece, without holding all the decoded bytes in memory.
+     * Returns whether the stream is still good.
+     */
+    bool decode(std::string_view str, std::ostream &out);
 } // namespace cq::utils::base64
@@ -2,9 +2,17 @@
 
 #include "../common.h"
 
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
 #include "../exception.h"
 #include "./string.h"
 
+#ifdef _MSC_VER
+#include <cstdlib>
+#endif
+
 namespace cq::exception {
     struct BytesNotEnough : LogicError {
         BytesNotEnough(const size_t have, const size_t needed)
@@ -14,52 +22,76 @@ namespace cq::exception {
 } // namespace cq::exception
 
 namespace cq::utils {
+    /**
+     * Load a big-endian integer from unaligned memory, on a little-endian host, as all CoolQ hosts are.
+     */
+    template <typename IntType>
+    IntType load_big_endian(const char *p) noexcept {
+        static_assert(std::is_integral_v<IntType>, "only integers can be loaded");
+        using UIntType = std::make_unsigned_t<IntType>;
+
+        UIntType value;
+        std::memcpy(&value, p, sizeof(value));
+        if constexpr (sizeof(value) == 2) {
+#ifdef _MSC_VER
+            value = _byteswap_ushort(value);
+#else
+            value = __builtin_bswap16(value);
+#endif
+        } else if constexpr (sizeof(value) == 4) {
+#ifdef _MSC_VER
+            value = _byteswap_ulong(value);
+#else
+            value = __builtin_bswap32(value);
+#endif
+        } else if constexpr (sizeof(value) == 8) {
+#ifdef _MSC_VER
+            value = _byteswap_uint64(value);
+#else
+            value = __builtin_bswap64(value);
+#endif
+        }
+        return static_cast<IntType>(value);
+    }
+
+    /**
+     * Reader of the big-endian binary data CoolQ gives (base64 decoded), over a buffer owned by the caller,
+     * which must outlive the reader and the views it gives.
+     */
     class BinPack {
     public:
-        BinPack() : bytes_(""), curr_(0) {}
-        explicit BinPack(const std::string &b) : bytes_(b), curr_(0) {}
+        BinPack() = default;
+        explicit BinPack(const std::string_view bytes) : bytes_(bytes) {}
 
-        size_t size() const noexcept { return bytes_.size() - curr_; }
-        bool empty() const noexcept { return size() == 0; }
+        size_t size() const noexcept { return bytes_.size(); }
+        bool empty() const noexcept { return bytes_.empty(); }
 
         template <typename IntType>
         IntType pop_int() noexcept(false) {
-            constexpr auto size = sizeof(IntType);
-            check_enough(size);
-
-            auto s = bytes_.substr(curr_, size);
-            curr_ += size;
-            std::reverse(s.begin(), s.end());
-
-            IntType result;
-            memcpy(static_cast<void *>(&result), s.data(), size);
+            check_enough(sizeof(IntType));
+            const auto result = load_big_endian<IntType>(bytes_.data());
+            bytes_.remove_prefix(sizeof(IntType));
             return result;
         }
 
         std::string pop_string() noexcept(false) {
-            const auto len = pop_int<int16_t>();
-            if (len == 0) {
-                return std::string();
-            }
-            check_enough(len);
-            auto result = string_from_coolq(bytes_.substr(curr_, len));
-            curr_ += len;
-            return result;
+            const auto bytes = pop_token();
+            return bytes.empty() ? std::string() : string_from_coolq(bytes);
         }
 
-        std::string pop_bytes(const size_t len) noexcept(false) {
-            auto result = bytes_.substr(curr_, len);
-            curr_ += len;
+        std::string_view pop_bytes(const size_t len) noexcept(false) {
+            check_enough(len);
+            const auto result = bytes_.substr(0, len);
+            bytes_.remove_prefix(len);
             return result;
         }
 
-        std::string pop_token() noexcept(false) { return pop_bytes(pop_int<int16_t>()); }
+        std::string_view pop_token() noexcept(false) { return pop_bytes(pop_int<uint16_t>()); }
 
         bool pop_bool() noexcept(false) { return static_cast<bool>(pop_int<int32_t>()); }
 
     private:
-        std::string bytes_;
-        size_t curr_;
+        std::string_view bytes_;
 
         void check_enough(const size_t needed) const noexcept(false) {
             if (size() < needed) {
@@ -0,0 +1,348 @@
+#include "./gb18030.h"
+
+#include <cstring>
+#include <memory>
+
+#include "./gb18030_tables.h"
+#include "./simd.h"
+
+using namespace std;
+
+namespace cq::utils::gb18030 {
+    using tables::FOUR_BYTE_RANGES;
+    using tables::TWO_BYTE;
+    using tables::TWO_BYTE_SUPPLEMENTARY;
+
+    static constexpr uint32_t FOUR_BYTE_BMP_COUNT = 39420; // 0x81308130 to 0x8439FE39
+    static constexpr uint32_t FOUR_BYTE_SUPPLEMENTARY_BEGIN = 189000; // 0x90308130, which is U+10000
+    static constexpr uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+    /**
+     * Tables that are faster to look up than the generated ones, built from them on first use.
+     */
+    struct Lookup {
+        uint16_t four_byte_bmp[FOUR_BYTE_BMP_COUNT]{}; // code points by linear index, 0 if not mapped
+        uint32_t bmp[0x10000]{}; // GB18030 sequences of the BMP, big-endian in the lower bytes, 0 if not mapped
+
+        Lookup() {
+            for (const auto &range : FOUR_BYTE_RANGES) {
+                for (uint32_t i = 0; i < range.count; i++) {
+                    const auto index = range.index + i;
+                    four_byte_bmp[index] = static_cast<uint16_t>(range.code_point + i);
+                    bmp[range.code_point + i] = 0x81308130 + index / 12600 * 0x1000000 + index / 1260 % 10 * 0x10000
+                                                + index / 10 % 126 * 0x100 + index % 10;
+                }
+            }
+            // two-byte sequences go last, so that they win over four-byte ones of the same code point
+            for (uint32_t i = 0; i < size(TWO_BYTE); i++) {
+                if (const auto cp = TWO_BYTE[i]; cp != 0) {
+                    const auto trail = i % 190;
+                    bmp[cp] = (0x81 + i / 190) << 8 | (trail < 0x3F ? 0x40 + trail : 0x41 + trail);
+                }
+            }
+        }
+    };
+
+    static const Lookup &lookup() {
+        static const auto instance = make_unique<Lookup>();
+        return *instance;
+    }
+
+    /**
+     * Get the length of the leading ASCII characters, 16 bytes at a time where SSE2 is available.
+     */
+    static size_t ascii_length(const string_view str) {
+        size_t i = 0;
+#ifdef CQSDK_SSE2
+        for (; i + 16 <= str.size(); i += 16) {
+            const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(str.data() + i));
+            if (const auto mask = static_cast<unsigned>(_mm_movemask_epi8(chunk))) {
+                return i + count_trailing_zeros(mask);
+            }
+        }
+#endif
+        while (i < str.size() && static_cast<unsigned char>(str[i]) < 0x80) {
+            i++;
+        }
+        return i;
+    }
+
+    static constexpr size_t SCRATCH_LIMIT = 1 << 20;
+
+    /**
+     * Convert the string with "pass(std::bool_constant<Write>, str, out)", into a result of the exact size.
+     *
+     * The leading ASCII characters are copied as they are. The rest is converted into a per-thread scratch buffer
+     * of the worst-case size, then copied out, or for long strings, counted first and written straight into the result.
+     */
+    template <typename Pass>
+    static string convert(const string_view str, const size_t max_growth, Pass &&pass) {
+        const auto ascii = ascii_length(str);
+        if (ascii == str.size()) {
+            return string(str);
+        }
+
+        const auto rest = str.substr(ascii);
+        string result;
+        if (const auto worst = rest.size() * max_growth; worst <= SCRATCH_LIMIT) {
+            thread_local string scratch;
+            if (scratch.size() < worst) {
+                scratch.resize(worst);
+            }
+            const auto n = pass(true_type(), rest, scratch.data());
+            result.reserve(ascii + n);
+            result.append(str.data(), ascii);
+            result.append(scratch.data(), n);
+        } else {
+            result.resize(ascii + pass(false_type(), rest, nullptr));
+            memcpy(result.data(), str.data(), ascii);
+            pass(true_type(), rest, result.data() + ascii);
+        }
+        return result;
+    }
+
+    static size_t put_utf8(char *out, const uint32_t cp) {
+        if (cp < 0x80) {
+            out[0] = static_cast<char>(cp);
+            return 1;
+        }
+        if (cp < 0x800) {
+            out[0] = static_cast<char>(0xC0 | cp >> 6);
+            out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 2;
+        }
+        if (cp < 0x10000) {
+            out[0] = static_cast<char>(0xE0 | cp >> 12);
+            out[1] = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+            out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<char>(0xF0 | cp >> 18);
+        out[1] = static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+        out[2] = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+        out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 4;
+    }
+
+    /**
+     * Decode the GB18030 sequence at the beginning of "str", which starts with a non-ASCII byte.
+     * Return the code point (U+FFFD if invalid) and set "length" to the bytes consumed.
+     */
+    static uint32_t decode_sequence(const Lookup &tables, const unsigned char *str, const size_t size, size_t &length) {
+        const auto lead = str[0];
+        length = 1;
+        if (lead == 0x80 || lead == 0xFF || size < 2) {
+            return REPLACEMENT_CHARACTER;
+        }
+
+        const auto second = str[1];
+        if (second >= 0x40 && second <= 0xFE && second != 0x7F) {
+            length = 2;
+            const auto index = (lead - 0x81) * 190 + (second < 0x7F ? second - 0x40 : second - 0x41);
+            if (const auto cp = TWO_BYTE[index]; cp != 0) {
+                return cp;
+            }
+            const auto code = static_cast<uint16_t>(lead << 8 | second);
+            for (const auto &item : TWO_BYTE_SUPPLEMENTARY) {
+                if (item.code == code) {
+                    return item.code_point;
+                }
+            }
+            return REPLACEMENT_CHARACTER;
+        }
+
+        if (second < 0x30 || second > 0x39 || size < 4 || str[2] < 0x81 || str[2] > 0xFE || str[3] < 0x30
+            || str[3] > 0x39) {
+            return REPLACEMENT_CHARACTER;
+        }
+        length = 4;
+        // the lead byte is at least 0x81 here, so the index is never negative
+        const auto index = static_cast<uint32_t>((lead - 0x81) * 12600 + (second - 0x30) * 1260 + (str[2] - 0x81) * 10
+                                                 + (str[3] - 0x30));
+        if (index < FOUR_BYTE_BMP_COUNT) {
+            const auto cp = tables.four_byte_bmp[index];
+            return cp != 0 ? cp : REPLACEMENT_CHARACTER;
+        }
+        if (index >= FOUR_BYTE_SUPPLEMENTARY_BEGIN && index - FOUR_BYTE_SUPPLEMENTARY_BEGIN < 0x100000) {
+            return 0x10000 + (index - FOUR_BYTE_SUPPLEMENTARY_BEGIN);
+        }
+        return REPLACEMENT_CHARACTER;
+    }
+
+    static size_t utf8_length(const uint32_t cp) { return cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4; }
+
+    /**
+     * Convert "str" to UTF-8 into "out", or just count the bytes if "Write" is false.
+     */
+    template <bool Write>
+    static size_t to_utf8_pass(const string_view str, char *out) {
+        const auto &tables = lookup();
+        auto p = reinterpret_cast<const unsigned char *>(str.data());
+        const auto end = p + str.size();
+        size_t n = 0;
+        while (p < end) {
+            if (*p < 0x80) {
+                const auto ascii = ascii_length({reinterpret_cast<const char *>(p), static_cast<size_t>(end - p)});
+                if constexpr (Write) {
+                    memcpy(out + n, p, ascii);
+                }
+                n += ascii;
+                p += ascii;
+                continue;
+            }
+
+            // a two-byte sequence in the BMP, as most Chinese characters are, takes the short way
+            if (end - p >= 2 && p[0] != 0x80 && p[0] != 0xFF && p[1] >= 0x40 && p[1] <= 0xFE && p[1] != 0x7F) {
+                const auto index = (p[0] - 0x81) * 190 + (p[1] < 0x7F ? p[1] - 0x40 : p[1] - 0x41);
+                if (const uint32_t cp = TWO_BYTE[index]; cp >= 0x800) {
+                    if constexpr (Write) {
+                        out[n] = static_cast<char>(0xE0 | cp >> 12);
+                        out[n + 1] = static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+                        out[n + 2] = static_cast<char>(0x80 | (cp & 0x3F));
+                    }
+                    n += 3;
+                    p += 2;
+                    continue;
+                }
+            }
+
+            size_t length;
+            const auto cp = decode_sequence(tables, p, end - p, length);
+            if constexpr (Write) {
+                n += put_utf8(out + n, cp);
+            } else {
+                n += utf8_length(cp);
+            }
+            p += length;
+        }
+        return n;
+    }
+
+    string to_utf8(const string_view str) {
+        // a byte that can't start a sequence becomes U+FFFD, which takes 3 bytes, any other sequence grows less
+        return convert(str, 3, [](auto write, const string_view rest, char *out) {
+            return to_utf8_pass<decltype(write)::value>(rest, out);
+        });
+    }
+
+    /**
+     * Decode the UTF-8 sequence at the beginning of "str", which starts with a non-ASCII byte.
+     * Return the code point, or 0 if invalid, and set "length" to the bytes consumed.
+     */
+    static uint32_t decode_utf8(const unsigned char *str, const size_t size, size_t &length) {
+        const auto lead = str[0];
+        length = 1;
+        uint32_t cp, min;
+        size_t n;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            cp = lead & 0x1F, min = 0x80, n = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            cp = lead & 0x0F, min = 0x800, n = 3;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            cp = lead & 0x07, min = 0x10000, n = 4;
+        } else {
+            return 0;
+        }
+        if (size < n) {
+            return 0;
+        }
+        for (size_t i = 1; i < n; i++) {
+            if ((str[i] & 0xC0) != 0x80) {
+                return 0;
+            }
+            cp = cp << 6 | (str[i] & 0x3F);
+        }
+        if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            return 0;
+        }
+        length = n;
+        return cp;
+    }
+
+    /**
+     * Get the GB18030 sequence of a non-ASCII code point, big-endian in the lower bytes, or 0 if it can't be encoded.
+     */
+    static uint32_t encode_code_point(const Lookup &tables, const uint32_t cp) {
+        if (cp < 0x10000) {
+            return tables.bmp[cp];
+        }
+        for (const auto &item : TWO_BYTE_SUPPLEMENTARY) {
+            if (item.code_point == cp) {
+                return item.code;
+            }
+        }
+        const auto index = FOUR_BYTE_SUPPLEMENTARY_BEGIN + (cp - 0x10000);
+        return 0x81308130 + index / 12600 * 0x1000000 + index / 1260 % 10 * 0x10000 + index / 10 % 126 * 0x100
+               + index % 10;
+    }
+
+    /**
+     * Convert "str" to GB18030 into "out", or just count the bytes if "Write" is false.
+     */
+    template <bool Write>
+    static size_t from_utf8_pass(const string_view str, char *out) {
+        const auto &tables = lookup();
+        auto p = reinterpret_cast<const unsigned char *>(str.data());
+        const auto end = p + str.size();
+        size_t n = 0;
+        while (p < end) {
+            if (*p < 0x80) {
+                const auto ascii = ascii_length({reinterpret_cast<const char *>(p), static_cast<size_t>(end - p)});
+                if constexpr (Write) {
+                    memcpy(out + n, p, ascii);
+                }
+                n += ascii;
+                p += ascii;
+                continue;
+            }
+
+            // a character of 3 bytes encoded in two bytes, as most Chinese characters are, takes the short way
+            if (end - p >= 3 && (p[0] & 0xF0) == 0xE0 && (p[1] & 0xC0) == 0x80 && (p[2] & 0xC0) == 0x80) {
+                const auto cp = static_cast<uint32_t>((p[0] & 0x0F) << 12 | (p[1] & 0x3F) << 6 | (p[2] & 0x3F));
+                // surrogates and overlong forms are never mapped
+                if (const auto code = tables.bmp[cp]; cp >= 0x800 && code != 0 && code <= 0xFFFF) {
+                    if constexpr (Write) {
+                        out[n] = static_cast<char>(code >> 8);
+                        out[n + 1] = static_cast<char>(code);
+                    }
+                    n += 2;
+                    p += 3;
+                    continue;
+                }
+            }
+
+            size_t length;
+            const auto cp = decode_utf8(p, end - p, length);
+            const auto code = cp != 0 ? encode_code_point(tables, cp) : 0;
+            p += length;
+            if (code == 0) {
+                if constexpr (Write) {
+                    out[n] = '?';
+                }
+                n += 1;
+            } else if (code <= 0xFFFF) {
+                if constexpr (Write) {
+                    out[n] = static_cast<char>(code >> 8);
+                    out[n + 1] = static_cast<char>(code);
+                }
+                n += 2;
+            } else {
+                if constexpr (Write) {
+                    out[n] = static_cast<char>(code >> 24);
+                    out[n + 1] = static_cast<char>(code >> 16);
+                    out[n + 2] = static_cast<char>(code >> 8);
+                    out[n + 3] = static_cast<char>(code);
+                }
+                n += 4;
+            }
+        }
+        return n;
+    }
+
+    string from_utf8(const string_view str) {
+        // a character of 2 bytes in UTF-8 may take 4 bytes in GB18030, any other sequence grows less
+        return convert(str, 2, [](auto write, const string_view rest, char *out) {
+            return from_utf8_pass<decltype(write)::value>(rest, out);
+        });
+    }
+} // namespace cq::utils::gb18030
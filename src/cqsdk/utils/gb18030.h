@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../common.h"
+
+#include <string_view>
+
+namespace cq::utils::gb18030 {
+    /**
+     * Convert a GB18030 string to UTF-8.
+     * Each byte that doesn't start a valid sequence, and each unmapped sequence, becomes U+FFFD.
+     */
+    std::string to_utf8(std::string_view str);
+
+    /**
+     * Convert a UTF-8 string to GB18030.
+     * Each byte of invalid UTF-8, and each character that GB18030 can't encode, becomes "?".
+     */
+    std::string from_utf8(std::string_view str);
+} // namespace cq::utils::gb18030
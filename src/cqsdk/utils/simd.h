@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../common.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CQSDK_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CQSDK_X86
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// functions using instructions beyond the compiler's baseline are marked with CQSDK_TARGET("ssse3") etc.,
+// and must only be called after checking the CPU, MSVC needs no marking
+#if defined(_MSC_VER) && !defined(__clang__)
+#define CQSDK_TARGET(features)
+#else
+#define CQSDK_TARGET(features) __attribute__((target(features)))
+#endif
+
+namespace cq::utils {
+    /**
+     * Get the index of the lowest set bit, the mask must not be zero.
+     */
+    inline size_t count_trailing_zeros(const unsigned mask) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+#ifdef CQSDK_X86
+    struct CpuFeatures {
+        bool ssse3 = false;
+        bool avx2 = false;
+    };
+
+    /**
+     * Get the instruction sets of the CPU, that the OS supports as well.
+     */
+    inline const CpuFeatures &cpu_features() {
+        static const auto features = [] {
+            CpuFeatures f;
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            const auto max_leaf = info[0];
+            __cpuid(info, 1);
+            f.ssse3 = (info[2] & 1 << 9) != 0;
+            const auto os_saves_ymm = (info[2] & 1 << 27) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+            if (max_leaf >= 7 && os_saves_ymm) {
+                __cpuidex(info, 7, 0);
+                f.avx2 = (info[1] & 1 << 5) != 0;
+            }
+#else
+            __builtin_cpu_init();
+            f.ssse3 = __builtin_cpu_supports("ssse3");
+            f.avx2 = __builtin_cpu_supports("avx2");
+#endif
+            return f;
+        }();
+        return features;
+    }
+#endif
+} // namespace cq::utils
@@ -4,6 +4,7 @@
 #include <codecvt>
 
 #include "../app.h"
+#include "./gb18030.h"
 #include "./memory.h"
 
 using namespace std;
@@ -20,6 +21,7 @@ namespace cq::utils {
         return result;
     }
 
+#ifdef _WIN32
     static shared_ptr<wchar_t> multibyte_to_widechar(const unsigned code_page, const char *multibyte_str) {
         const auto len = MultiByteToWideChar(code_page, 0, multibyte_str, -1, nullptr, 0);
         auto c_wstr_sptr = make_shared_array<wchar_t>(len + 1);
@@ -41,6 +43,34 @@ namespace cq::utils {
     string string_decode(const string &b, const Encoding encoding) {
         return ws2s(wstring(multibyte_to_widechar(static_cast<unsigned>(encoding), b.c_str()).get()));
     }
+#else
+    static string iconv_encoding_name(const Encoding encoding) {
+        switch (encoding) {
+        case Encoding::GB2312:
+            return "gb2312";
+        case Encoding::GB18030:
+            return "gb18030";
+        case Encoding::ANSI: // the "ANSI" code page of portable builds is just UTF-8
+        case Encoding::UTF8:
+        default:
+            return "utf-8";
+        }
+    }
+
+    string string_encode(const string &s, const Encoding encoding) {
+        if (encoding == Encoding::ANSI || encoding == Encoding::UTF8) {
+            return s;
+        }
+        return string_encode(s, iconv_encoding_name(encoding));
+    }
+
+    string string_decode(const string &b, const Encoding encoding) {
+        if (encoding == Encoding::ANSI || encoding == Encoding::UTF8) {
+            return b;
+        }
+        return string_decode(b, iconv_encoding_name(encoding));
+    }
+#endif
 
     string string_convert_encoding(const string &text, const string &from_enc, const string &to_enc,
                                    const float capability_factor) {
@@ -81,16 +111,17 @@ namespace cq::utils {
         return string_convert_encoding(b, encoding, "utf-8", capability_factor);
     }
 
-    string string_to_coolq(const string &str) {
+    string string_to_coolq(const string_view str) {
         // call CoolQ API
-        return string_encode(str, "gb18030");
+        return gb18030::from_utf8(str);
     }
 
-    string string_from_coolq(const string &str) {
+    string string_from_coolq(const string_view str) {
         // handle CoolQ event or data
-        auto result = string_decode(str, "gb18030");
+        auto result = gb18030::to_utf8(str);
 
-        if (config.convert_unicode_emoji) {
+        // the regexes are only run if there could be a match, most messages have neither
+        if (config.convert_unicode_emoji && result.find("[CQ:emoji,") != string::npos) {
             result = sregex_replace(result, regex(R"(\[CQ:emoji,\s*id=(\d+)\])"), [](const smatch &m) {
                 const auto codepoint_str = m.str(1);
                 u32string u32_str;
@@ -104,11 +135,18 @@ namespace cq::utils {
                     u32_str.append({codepoint});
                 }
 
+#ifdef _MSC_VER
+                // MSVC doesn't export codecvt facets for char32_t, so go through uint32_t instead
                 const auto p = reinterpret_cast<const uint32_t *>(u32_str.data());
                 wstring_convert<codecvt_utf8<uint32_t>, uint32_t> conv;
                 return conv.to_bytes(p, p + u32_str.size());
+#else
+                return wstring_convert<codecvt_utf8<char32_t>, char32_t>().to_bytes(u32_str);
+#endif
             });
+        }
 
+        if (config.convert_unicode_emoji && result.find("\xef\xb8\x8f") != string::npos) {
             // CoolQ sometimes use "#\uFE0F" to represent "#\uFE0F\u20E3"
             // we should convert them into correct emoji codepoints here
             //     \uFE0F == \xef\xb8\x8f
@@ -3,6 +3,7 @@
 #include "../common.h"
 
 #include <regex>
+#include <string_view>
 
 namespace cq::utils {
     std::string sregex_replace(const std::string &str, const std::regex &re,
@@ -25,8 +26,8 @@ namespace cq::utils {
     std::string string_encode(const std::string &s, const std::string &encoding, float capability_factor = 2.0f);
     std::string string_decode(const std::string &b, const std::string &encoding, float capability_factor = 2.0f);
 
-    std::string string_to_coolq(const std::string &str);
-    std::string string_from_coolq(const std::string &str);
+    std::string string_to_coolq(std::string_view str);
+    std::string string_from_coolq(std::string_view str);
 
     std::string ws2s(const std::wstring &ws);
     std::wstring s2ws(const std::string &s);
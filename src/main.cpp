@@ -9,6 +9,7 @@
 #include "cqhttp/plugins/worker_pool_resizer/worker_pool_resizer.h"
 
 #include "cqhttp/plugins/event_data_patcher/event_data_patcher.h"
+#include "cqhttp/plugins/info_cache_invalidator/info_cache_invalidator.h"
 #include "cqhttp/plugins/message_enhancer/message_enhancer.h"
 
 #include "cqhttp/plugins/async_actions/async_actions.h"
@@ -41,6 +42,7 @@ CQ_MAIN {
     use(plugins::heartbeat_generator);
 
     // extend the Context object
+    use(plugins::info_cache_invalidator);
     use(plugins::event_data_patcher);
     use(plugins::message_enhancer);
 
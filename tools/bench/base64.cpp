@@ -0,0 +1,140 @@
+// Conformance checks and throughput of the base64 codec kernels, against the vendored cpp-base64.
+//
+// Usage: cqhttp-bench-base64 [--size BYTES] [--rounds N]
+//
+// Every kernel the CPU supports is checked on random inputs, including ones with padding, truncation and
+// characters out of the alphabet, where the decoding must stop just like cpp-base64 does.
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "cqsdk/utils/base64.h"
+#include "cqsdk/utils/vendor/cpp-base64/base64.h"
+
+using namespace std;
+namespace base64 = cq::utils::base64;
+using base64::Kernel;
+
+static const char *kernel_name(const Kernel kernel) {
+    switch (kernel) {
+    case Kernel::AVX2:
+        return "avx2";
+    case Kernel::SSSE3:
+        return "ssse3";
+    default:
+        return "scalar";
+    }
+}
+
+static string random_bytes(mt19937 &rng, const size_t size) {
+    string s(size, '\0');
+    for (auto &c : s) c = static_cast<char>(rng() & 0xFF);
+    return s;
+}
+
+static bool check_conformance(const Kernel kernel) {
+    mt19937 rng(42);
+    const string noise = "=\n\r -_.*\x80\xff";
+    for (auto i = 0; i < 20000; i++) {
+        const auto bytes = random_bytes(rng, rng() % 300);
+        const auto encoded = base64_encode(reinterpret_cast<const unsigned char *>(bytes.data()),
+                                           static_cast<unsigned>(bytes.size()));
+        if (base64::encode(bytes) != encoded) {
+            cerr << kernel_name(kernel) << ": encode differs at " << bytes.size() << " bytes" << endl;
+            return false;
+        }
+
+        auto input = encoded;
+        switch (i % 4) {
+        case 1: // truncated
+            input.resize(rng() % (input.size() + 1));
+            break;
+        case 2: // broken somewhere
+            if (!input.empty()) input[rng() % input.size()] = noise[rng() % noise.size()];
+            break;
+        case 3: // padding in the middle
+            if (!input.empty()) input.insert(rng() % input.size(), "==");
+            break;
+        default:
+            break;
+        }
+        const auto expected = base64_decode(input);
+        if (base64::decode(input) != expected) {
+            cerr << kernel_name(kernel) << ": decode differs on \"" << input << "\"" << endl;
+            return false;
+        }
+        if (ostringstream ss; !base64::decode(input, ss) || ss.str() != expected) {
+            cerr << kernel_name(kernel) << ": decode to stream differs on \"" << input << "\"" << endl;
+            return false;
+        }
+    }
+
+    // longer than a chunk of the stream decoding, broken in the second chunk
+    auto long_input = base64::encode(random_bytes(rng, 200 * 1024));
+    long_input[100000] = '.';
+    if (ostringstream ss; !base64::decode(long_input, ss) || ss.str() != base64_decode(long_input)) {
+        cerr << kernel_name(kernel) << ": decode to stream differs on a long input" << endl;
+        return false;
+    }
+    return true;
+}
+
+template <typename Func>
+static double measure_mb_per_s(const size_t bytes, const int rounds, Func &&func) {
+    size_t sink = 0;
+    const auto start = chrono::steady_clock::now();
+    for (auto i = 0; i < rounds; i++) {
+        sink += func();
+    }
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (sink == 42) cout << "";
+    return bytes * static_cast<double>(rounds) / elapsed / 1e6;
+}
+
+int main(const int argc, char **argv) {
+    size_t size = 1024 * 1024;
+    auto rounds = 200;
+    for (auto i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) {
+            size = stoull(argv[++i]);
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = stoi(argv[++i]);
+        } else {
+            cerr << "usage: " << argv[0] << " [--size BYTES] [--rounds N]" << endl;
+            return 1;
+        }
+    }
+
+    mt19937 rng(7);
+    const auto bytes = random_bytes(rng, size);
+    const auto encoded = base64::encode(bytes);
+
+    cout << "payload: " << size << " bytes, " << rounds
+         << " rounds, best kernel: " << kernel_name(base64::best_kernel()) << endl;
+    cout << "kernel     encode (MB/s)    decode (MB/s)" << endl;
+    cout << "vendored   "
+         << measure_mb_per_s(size, rounds, [&] {
+                return base64_encode(reinterpret_cast<const unsigned char *>(bytes.data()),
+                                     static_cast<unsigned>(bytes.size()))
+                    .size();
+            })
+         << "          " << measure_mb_per_s(size, rounds, [&] { return base64_decode(encoded).size(); }) << endl;
+
+    string buffer(base64::max_decoded_size(encoded.size()), '\0');
+    for (const auto kernel : {Kernel::SCALAR, Kernel::SSSE3, Kernel::AVX2}) {
+        if (!base64::use_kernel(kernel)) {
+            continue;
+        }
+        if (!check_conformance(kernel)) {
+            return 1;
+        }
+        cout << kernel_name(kernel) << (kernel == Kernel::SCALAR ? "     " : "      ")
+             << measure_mb_per_s(size, rounds, [&] { return base64::encode(bytes).size(); }) << "          "
+             << measure_mb_per_s(size, rounds, [&] { return base64::decode(encoded, buffer.data()); }) << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+// Microbenchmark of parsing group member lists, against the BinPack that copied the bytes and each field.
+//
+// Usage: cqhttp-bench-binpack [--members N] [--rounds N]
+//
+// The payload is what CQ_getGroupMemberList gives for a group of N members (3000 by default), base64 encoded.
+// Both sides convert strings with the same string_from_coolq(), so only the reading of the bytes differs.
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cqsdk/app.h"
+#include "cqsdk/types.h"
+
+using namespace std;
+using cq::GroupMember;
+
+namespace cq {
+    Config config; // defined in app.cpp, which pulls in the CoolQ API
+}
+
+// the previous implementation, kept for comparison
+namespace legacy {
+    class BinPack {
+    public:
+        explicit BinPack(const string &b) : bytes_(b), curr_(0) {}
+
+        size_t size() const noexcept { return bytes_.size() - curr_; }
+
+        template <typename IntType>
+        IntType pop_int() {
+            constexpr auto size = sizeof(IntType);
+            check_enough(size);
+            auto s = bytes_.substr(curr_, size);
+            curr_ += size;
+            reverse(s.begin(), s.end());
+            IntType result;
+            memcpy(static_cast<void *>(&result), s.data(), size);
+            return result;
+        }
+
+        string pop_string() {
+            const auto len = pop_int<int16_t>();
+            if (len == 0) {
+                return string();
+            }
+            check_enough(len);
+            auto result = cq::utils::string_from_coolq(bytes_.substr(curr_, len));
+            curr_ += len;
+            return result;
+        }
+
+        string pop_bytes(const size_t len) {
+            auto result = bytes_.substr(curr_, len);
+            curr_ += len;
+            return result;
+        }
+
+        string pop_token() { return pop_bytes(pop_int<int16_t>()); }
+
+        bool pop_bool() { return static_cast<bool>(pop_int<int32_t>()); }
+
+    private:
+        string bytes_;
+        size_t curr_;
+
+        void check_enough(const size_t needed) const {
+            if (size() < needed) {
+                throw cq::exception::BytesNotEnough(size(), needed);
+            }
+        }
+    };
+
+    static GroupMember member_from_bytes(const string &bytes) {
+        auto pack = BinPack(bytes);
+        GroupMember member;
+        member.group_id = pack.pop_int<int64_t>();
+        member.user_id = pack.pop_int<int64_t>();
+        member.nickname = pack.pop_string();
+        member.card = pack.pop_string();
+        member.sex = static_cast<cq::Sex>(pack.pop_int<int32_t>());
+        member.age = pack.pop_int<int32_t>();
+        member.area = pack.pop_string();
+        member.join_time = pack.pop_int<int32_t>();
+        member.last_sent_time = pack.pop_int<int32_t>();
+        member.level = pack.pop_string();
+        member.role = static_cast<cq::GroupRole>(pack.pop_int<int32_t>());
+        member.unfriendly = pack.pop_bool();
+        member.title = pack.pop_string();
+        member.title_expire_time = pack.pop_int<int32_t>();
+        member.card_changeable = pack.pop_bool();
+        return member;
+    }
+
+    static vector<GroupMember> member_list_from_base64(const string &b64) {
+        vector<GroupMember> result;
+        auto inserter = back_inserter(result);
+        auto pack = BinPack(cq::utils::base64::decode(b64));
+        const auto count = pack.pop_int<int32_t>();
+        for (auto i = 0; i < count; i++) {
+            *inserter = member_from_bytes(pack.pop_token());
+        }
+        return result;
+    }
+} // namespace legacy
+
+template <typename IntType>
+static void put_int(string &out, const IntType value) {
+    for (auto i = static_cast<int>(sizeof(IntType)) - 1; i >= 0; i--) {
+        out += static_cast<char>(static_cast<uint64_t>(value) >> (i * 8) & 0xFF);
+    }
+}
+
+static void put_string(string &out, const string &str) {
+    const auto bytes = cq::utils::string_to_coolq(str);
+    put_int(out, static_cast<int16_t>(bytes.size()));
+    out += bytes;
+}
+
+static string generate_member_list(const size_t count) {
+    mt19937 rng(42);
+    static const vector<string> nicknames = {u8"小明", u8"张三", "Alice", u8"🐱猫猫", u8"路人甲乙丙", "bot_0x42"};
+    static const vector<string> areas = {u8"北京", u8"上海", "", u8"广东 深圳"};
+    static const vector<string> levels = {u8"潜水", u8"冒泡", u8"活跃", u8"话唠", u8"传说"};
+
+    string bytes;
+    put_int(bytes, static_cast<int32_t>(count));
+    for (size_t i = 0; i < count; i++) {
+        string member;
+        put_int(member, static_cast<int64_t>(123456789));
+        put_int(member, static_cast<int64_t>(10000 + rng() % 1000000000));
+        put_string(member, nicknames[rng() % nicknames.size()] + to_string(i));
+        put_string(member, rng() % 3 ? "" : u8"群名片" + to_string(i));
+        put_int(member, static_cast<int32_t>(rng() % 2));
+        put_int(member, static_cast<int32_t>(rng() % 60));
+        put_string(member, areas[rng() % areas.size()]);
+        put_int(member, static_cast<int32_t>(1500000000 + rng() % 100000000));
+        put_int(member, static_cast<int32_t>(1600000000 + rng() % 100000000));
+        put_string(member, levels[rng() % levels.size()]);
+        put_int(member, static_cast<int32_t>(1 + (i == 0 ? 2 : rng() % 20 == 0)));
+        put_int(member, static_cast<int32_t>(0));
+        put_string(member, rng() % 10 ? "" : u8"头衔");
+        put_int(member, static_cast<int32_t>(-1));
+        put_int(member, static_cast<int32_t>(rng() % 2));
+
+        put_int(bytes, static_cast<int16_t>(member.size()));
+        bytes += member;
+    }
+    return cq::utils::base64::encode(reinterpret_cast<const unsigned char *>(bytes.data()),
+                                     static_cast<unsigned>(bytes.size()));
+}
+
+static bool same(const GroupMember &a, const GroupMember &b) {
+    return a.group_id == b.group_id && a.user_id == b.user_id && a.nickname == b.nickname && a.card == b.card
+           && a.sex == b.sex && a.age == b.age && a.area == b.area && a.join_time == b.join_time
+           && a.last_sent_time == b.last_sent_time && a.level == b.level && a.role == b.role
+           && a.unfriendly == b.unfriendly && a.title == b.title && a.title_expire_time == b.title_expire_time
+           && a.card_changeable == b.card_changeable;
+}
+
+template <typename F>
+static double measure(const string &b64, const int rounds, F &&func) {
+    size_t sink = 0;
+    const auto start = chrono::steady_clock::now();
+    for (auto i = 0; i < rounds; i++) {
+        sink += func(b64).size();
+    }
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (sink == 42) {
+        cout << "";
+    }
+    return elapsed / rounds * 1000;
+}
+
+int main(const int argc, char **argv) {
+    size_t member_count = 3000;
+    auto rounds = 100;
+    for (auto i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--members" && i + 1 < argc) {
+            member_count = stoul(argv[++i]);
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = stoi(argv[++i]);
+        } else {
+            cerr << "usage: " << argv[0] << " [--members N] [--rounds N]" << endl;
+            return 1;
+        }
+    }
+
+    const auto b64 = generate_member_list(member_count);
+    const auto expected = legacy::member_list_from_base64(b64);
+    const auto actual = cq::ObjectHelper::multi_from_base64<vector<GroupMember>>(b64);
+    if (expected.size() != member_count || actual.size() != expected.size()
+        || !equal(expected.begin(), expected.end(), actual.begin(), same)) {
+        cerr << "results differ" << endl;
+        return 1;
+    }
+
+    // a truncated payload must be reported, not read past
+    try {
+        cq::ObjectHelper::multi_from_base64<vector<GroupMember>>(b64.substr(0, b64.size() / 2 / 4 * 4));
+        cerr << "truncated payload not detected" << endl;
+        return 1;
+    } catch (cq::exception::ParseError &) {
+    }
+
+    cout << "members: " << member_count << ", payload: " << b64.size() << " bytes of base64, " << rounds << " rounds"
+         << endl;
+    cout << "legacy (ms)    views (ms)    of which base64 decoding (ms)" << endl;
+    cout << measure(b64, rounds, legacy::member_list_from_base64) << "        "
+         << measure(b64, rounds, cq::ObjectHelper::multi_from_base64<vector<GroupMember>>) << "       "
+         << measure(b64, rounds, [](const string &s) { return cq::utils::base64::decode(s); }) << endl;
+    return 0;
+}
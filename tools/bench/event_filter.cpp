@@ -0,0 +1,448 @@
+// Microbenchmark of the compiled event filter, against the tree of operators it replaced.
+// Both are run on every event of the corpus, and must agree on all of them.
+//
+// Usage: cqhttp-bench-event_filter [--filter FILE] [--corpus FILE] [--rounds N] [--keywords N] [--disassemble]
+//
+// "--keywords" adds N "contains" rules and N / 10 "regex" rules on "raw_message", like large moderation rules.
+//
+// The corpus is a file with one event per line, for example the bodies received from the HTTP reporter.
+// Without it, events similar to those of the mock host are generated.
+
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "cqhttp/plugins/event_filter/filter.h"
+
+using namespace std;
+
+// the previous implementation, kept for comparison
+namespace legacy {
+    using cqhttp::plugins::FilterSyntexError;
+
+    class Filter {
+    public:
+        virtual ~Filter() = default;
+        virtual bool eval(const json &payload) = 0;
+    };
+
+    static shared_ptr<Filter> construct_op(const string &op_name, const json &op_argument);
+
+    class NotOperator : public Filter {
+    public:
+        static shared_ptr<NotOperator> construct(const json &argument) {
+            if (!argument.is_object()) {
+                throw FilterSyntexError("the argument of 'not' operator must be an object");
+            }
+            auto op = make_shared<NotOperator>();
+            op->operand_ = construct_op("and", argument);
+            return op;
+        }
+
+        bool eval(const json &payload) override { return !operand_->eval(payload); }
+
+    private:
+        shared_ptr<Filter> operand_;
+    };
+
+    class AndOperator : public Filter {
+    public:
+        static shared_ptr<AndOperator> construct(const json &argument) {
+            if (!argument.is_object()) {
+                throw FilterSyntexError("the argument of 'and' operator must be an object");
+            }
+
+            auto op = make_shared<AndOperator>();
+
+            for (auto it = argument.begin(); it != argument.end(); ++it) {
+                const auto &key = it.key();
+                const auto &value = it.value();
+
+                if (key.empty()) {
+                    continue;
+                }
+
+                if (key.front() == '.') {
+                    op->operands_.push_back({"", construct_op(key.substr(1), value)});
+                } else if (value.is_object()) {
+                    op->operands_.push_back({key, construct_op("and", value)});
+                } else {
+                    op->operands_.push_back({key, construct_op("eq", value)});
+                }
+            }
+
+            return op;
+        }
+
+        bool eval(const json &payload) override {
+            auto res = true;
+
+            for (const auto &operand : operands_) {
+                if (operand.first.empty()) {
+                    res = res && operand.second->eval(payload);
+                } else {
+                    try {
+                        auto &sub_payload = payload.at(operand.first);
+                        res = res && operand.second->eval(sub_payload);
+                    } catch (exception &) {
+                        res = false;
+                    }
+                }
+
+                if (res == false) {
+                    break;
+                }
+            }
+
+            return res;
+        }
+
+    private:
+        vector<pair<string, shared_ptr<Filter>>> operands_;
+    };
+
+    class OrOperator : public Filter {
+    public:
+        static shared_ptr<OrOperator> construct(const json &argument) {
+            if (!argument.is_array()) {
+                throw FilterSyntexError("the argument of 'or' operator must be an array");
+            }
+
+            auto op = make_shared<OrOperator>();
+
+            for (auto &elem : argument) {
+                op->operands_.push_back(construct_op("and", elem));
+            }
+
+            return op;
+        }
+
+        bool eval(const json &payload) override {
+            auto res = false;
+
+            for (const auto &operand : operands_) {
+                res = res || operand->eval(payload);
+
+                if (res == true) {
+                    break;
+                }
+            }
+
+            return res;
+        }
+
+    private:
+        vector<shared_ptr<Filter>> operands_;
+    };
+
+    class EqualOperator : public Filter {
+    public:
+        static shared_ptr<EqualOperator> construct(const json &argument) {
+            auto op = make_shared<EqualOperator>();
+            op->value_ = argument;
+            return op;
+        }
+
+        bool eval(const json &payload) override { return payload == value_; }
+
+    private:
+        json value_;
+    };
+
+    class NotEqualOperator : public Filter {
+    public:
+        static shared_ptr<NotEqualOperator> construct(const json &argument) {
+            auto op = make_shared<NotEqualOperator>();
+            op->value_ = argument;
+            return op;
+        }
+
+        bool eval(const json &payload) override { return payload != value_; }
+
+    private:
+        json value_;
+    };
+
+    class InOperator : public Filter {
+    public:
+        static shared_ptr<InOperator> construct(const json &argument) {
+            if (!(argument.is_string() || argument.is_array())) {
+                throw FilterSyntexError("the argument of 'in' operator must be a string or an array");
+            }
+
+            auto op = make_shared<InOperator>();
+            op->range_ = argument;
+            return op;
+        }
+
+        bool eval(const json &payload) override {
+            if (range_.is_string()) {
+                return payload.is_string() && boost::algorithm::contains(range_.get<string>(), payload.get<string>());
+            }
+
+            return find(range_.begin(), range_.end(), payload) != range_.end();
+        }
+
+    private:
+        json range_;
+    };
+
+    class ContainsOperator : public Filter {
+    public:
+        static shared_ptr<ContainsOperator> construct(const json &argument) {
+            if (!argument.is_string()) {
+                throw FilterSyntexError("the argument of 'contains' operator must be a string");
+            }
+
+            auto op = make_shared<ContainsOperator>();
+            op->test_ = argument;
+            return op;
+        }
+
+        bool eval(const json &payload) override {
+            if (!payload.is_string()) {
+                return false;
+            }
+            return boost::algorithm::contains(payload.get<string>(), test_.get<string>());
+        }
+
+    private:
+        json test_;
+    };
+
+    class RegexOperator : public Filter {
+    public:
+        static shared_ptr<RegexOperator> construct(const json &argument) {
+            if (!argument.is_string()) {
+                throw FilterSyntexError("the argument of 'regex' operator must be a string");
+            }
+
+            auto op = make_shared<RegexOperator>();
+            op->regex_ = regex(argument.get<string>());
+            return op;
+        }
+
+        bool eval(const json &payload) override {
+            if (!payload.is_string()) {
+                return false;
+            }
+
+            smatch m;
+            const auto input = payload.get<string>();
+            return regex_search(input.cbegin(), input.cend(), m, regex_);
+        }
+
+    private:
+        regex regex_;
+    };
+
+    static shared_ptr<Filter> construct_op(const string &op_name, const json &op_argument) {
+        static const map<string, function<shared_ptr<Filter>(const json &)>> op_constructor_map = {
+            {"not", NotOperator::construct},
+            {"and", AndOperator::construct},
+            {"or", OrOperator::construct},
+            {"eq", EqualOperator::construct},
+            {"neq", NotEqualOperator::construct},
+            {"in", InOperator::construct},
+            {"contains", ContainsOperator::construct},
+            {"regex", RegexOperator::construct},
+        };
+
+        if (op_constructor_map.find(op_name) == op_constructor_map.end()) {
+            throw FilterSyntexError("the operator '" + op_name + "'" + "is not supported");
+        }
+
+        return op_constructor_map.at(op_name)(op_argument);
+    }
+
+    shared_ptr<Filter> construct_filter(const json &root_filter) { return construct_op("and", root_filter); }
+} // namespace legacy
+
+// the "more complex example" of the documentation, plus a few keys that are often missing
+static const auto DEFAULT_FILTER = R"({
+    ".or": [
+        {
+            "message_type": "private",
+            "user_id": {
+                ".not": {
+                    ".in": [20011, 20022, 20033]
+                },
+                ".neq": 20044
+            }
+        },
+        {
+            "message_type": {
+                ".regex": "group|discuss"
+            },
+            "anonymous": {
+                ".eq": null
+            },
+            ".or": [
+                {
+                    "group_id": {
+                        ".in": [30001, 30003, 30005, 30007]
+                    }
+                },
+                {
+                    "raw_message": {
+                        ".contains": "通知"
+                    }
+                }
+            ]
+        },
+        {
+            "notice_type": "group_increase",
+            "sub_type": "approve"
+        }
+    ]
+})";
+
+static vector<json> generate_corpus(const size_t count) {
+    static const string messages[] = {
+        u8"[CQ:at,qq=10000] 你好，这是一条测试消息 [CQ:face,id=14]",
+        u8"hello, world &#91;不是CQ码&#93;",
+        u8"明天的群通知请大家注意查看",
+        u8"!!help",
+    };
+
+    vector<json> corpus;
+    for (size_t i = 0; i < count; i++) {
+        json event = {
+            {"time", 1546300800 + i},
+            {"self_id", 10000},
+            {"user_id", 20000 + i % 100},
+            {"message_id", i},
+            {"raw_message", messages[i % 4]},
+            {"message", json::array({{{"type", "text"}, {"data", {{"text", messages[i % 4]}}}}})},
+            {"font", 0},
+        };
+        switch (i % 10) {
+        case 0:
+            event["post_type"] = "notice";
+            event["notice_type"] = "group_increase";
+            event["sub_type"] = i % 20 == 0 ? "approve" : "invite";
+            event["group_id"] = 30000 + i % 10;
+            event["operator_id"] = 20000;
+            event.erase("message");
+            event.erase("raw_message");
+            break;
+        case 1:
+        case 2:
+        case 3:
+            event["post_type"] = "message";
+            event["message_type"] = "private";
+            event["sub_type"] = "friend";
+            break;
+        case 4:
+            event["post_type"] = "message";
+            event["message_type"] = "discuss";
+            event["discuss_id"] = 40000 + i % 7;
+            break;
+        default:
+            event["post_type"] = "message";
+            event["message_type"] = "group";
+            event["sub_type"] = "normal";
+            event["group_id"] = 30000 + i % 13;
+            event["anonymous"] = i % 17 == 0 ? json{{"id", 1}, {"name", "anon"}} : json(nullptr);
+            break;
+        }
+        corpus.push_back(move(event));
+    }
+    return corpus;
+}
+
+template <typename F>
+static double run(const vector<json> &corpus, const int rounds, F &&eval, size_t &passed) {
+    passed = 0;
+    const auto start = chrono::steady_clock::now();
+    for (auto r = 0; r < rounds; r++) {
+        for (const auto &event : corpus) {
+            passed += eval(event) ? 1 : 0;
+        }
+    }
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return corpus.size() * rounds / elapsed;
+}
+
+int main(const int argc, char **argv) {
+    string filter_file, corpus_file;
+    auto rounds = 20;
+    auto keyword_count = 0;
+    auto disassemble = false;
+    for (auto i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) {
+            filter_file = argv[++i];
+        } else if (arg == "--corpus" && i + 1 < argc) {
+            corpus_file = argv[++i];
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = stoi(argv[++i]);
+        } else if (arg == "--keywords" && i + 1 < argc) {
+            keyword_count = stoi(argv[++i]);
+        } else if (arg == "--disassemble") {
+            disassemble = true;
+        } else {
+            cerr << "usage: " << argv[0]
+                 << " [--filter FILE] [--corpus FILE] [--rounds N] [--keywords N] [--disassemble]" << endl;
+            return 1;
+        }
+    }
+
+    json filter_json;
+    if (filter_file.empty()) {
+        filter_json = json::parse(DEFAULT_FILTER);
+    } else {
+        ifstream(filter_file) >> filter_json;
+    }
+
+    if (keyword_count > 0) {
+        auto rules = json::array();
+        for (auto i = 0; i < keyword_count; i++) {
+            rules.push_back({{"raw_message", {{".contains", u8"关键词" + to_string(i)}}}});
+            if (i % 10 == 0) {
+                rules.push_back({{"raw_message", {{".regex", "^!!cmd" + to_string(i) + R"(\s+\w+)"}}}});
+            }
+        }
+        const json not_any_keyword = {{".not", {{".or", rules}}}};
+        filter_json = {{".or", json::array({filter_json, not_any_keyword})}};
+    }
+
+    vector<json> corpus;
+    if (corpus_file.empty()) {
+        corpus = generate_corpus(100000);
+    } else {
+        ifstream f(corpus_file);
+        for (string line; getline(f, line);) {
+            if (!line.empty()) {
+                corpus.push_back(json::parse(line));
+            }
+        }
+    }
+
+    const auto tree = legacy::construct_filter(filter_json);
+    const auto program = cqhttp::plugins::construct_filter(filter_json);
+    if (disassemble) {
+        cout << program->disassemble() << endl;
+    }
+
+    for (size_t i = 0; i < corpus.size(); i++) {
+        if (tree->eval(corpus[i]) != program->eval(corpus[i])) {
+            cerr << "results differ on event " << i << ": " << corpus[i].dump() << endl;
+            return 1;
+        }
+    }
+
+    size_t tree_passed, program_passed;
+    const auto tree_rate = run(corpus, rounds, [&](const json &e) { return tree->eval(e); }, tree_passed);
+    const auto program_rate = run(corpus, rounds, [&](const json &e) { return program->eval(e); }, program_passed);
+
+    cout << "events: " << corpus.size() << " x " << rounds << " rounds, passed: " << program_passed / rounds << endl;
+    cout << "tree (events/s)    program (events/s)" << endl;
+    cout << static_cast<int64_t>(tree_rate) << "            " << static_cast<int64_t>(program_rate) << endl;
+    return 0;
+}
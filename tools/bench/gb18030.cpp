@@ -0,0 +1,220 @@
+// Microbenchmark of the GB18030 transcoder, against iconv, which the portable build used to convert with.
+//
+// Usage: cqhttp-bench-gb18030 [--chars N] [--rounds N] [--fuzz N]
+//
+// Every two-byte and four-byte sequence of the BMP, and every code point, is checked against iconv first.
+// "--fuzz" checks N random strings of mixed ASCII, Chinese, emoji and invalid bytes too.
+// The text is a chat message of N characters, mostly Chinese with some ASCII, plus pure ASCII for the fast path.
+
+#include <iconv.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cqsdk/utils/gb18030.h"
+
+using namespace std;
+namespace gb18030 = cq::utils::gb18030;
+
+// what cq::utils::string_convert_encoding() did, nullopt if iconv fails
+static optional<string> iconv_convert(const string &text, const char *from, const char *to) {
+    const auto cd = iconv_open(to, from);
+    auto in = const_cast<char *>(text.data());
+    auto in_left = text.size();
+    string out(text.size() * 4 + 4, '\0');
+    auto out_ptr = out.data();
+    auto out_left = out.size();
+    const auto ret = iconv(cd, &in, &in_left, &out_ptr, &out_left);
+    iconv_close(cd);
+    if (ret == static_cast<size_t>(-1)) {
+        return nullopt;
+    }
+    out.resize(out.size() - out_left);
+    return out;
+}
+
+static string utf8(const uint32_t cp) {
+    string s;
+    if (cp < 0x80) {
+        s += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        s += static_cast<char>(0xC0 | cp >> 6);
+        s += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        s += static_cast<char>(0xE0 | cp >> 12);
+        s += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+        s += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        s += static_cast<char>(0xF0 | cp >> 18);
+        s += static_cast<char>(0x80 | (cp >> 12 & 0x3F));
+        s += static_cast<char>(0x80 | (cp >> 6 & 0x3F));
+        s += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return s;
+}
+
+static bool check_decoding(const string &gb) {
+    const auto expected = iconv_convert(gb, "gb18030", "utf-8");
+    if (expected && gb18030::to_utf8(gb) != *expected) {
+        cerr << "to_utf8 differs from iconv on " << gb.size() << " bytes starting with " << hex
+             << static_cast<int>(static_cast<unsigned char>(gb[0])) << dec << endl;
+        return false;
+    }
+    return true;
+}
+
+static bool check_encoding(const string &u8) {
+    const auto expected = iconv_convert(u8, "utf-8", "gb18030");
+    const auto actual = gb18030::from_utf8(u8);
+    if (expected ? actual != *expected : actual.find('?') == string::npos) {
+        cerr << "from_utf8 differs from iconv on \"" << u8 << "\"" << endl;
+        return false;
+    }
+    return true;
+}
+
+static bool check_all_code_points() {
+    for (auto lead = 0x81; lead <= 0xFE; lead++) {
+        for (auto trail = 0x40; trail <= 0xFE; trail++) {
+            if (trail != 0x7F && !check_decoding({static_cast<char>(lead), static_cast<char>(trail)})) {
+                return false;
+            }
+        }
+    }
+    for (uint32_t index = 0; index < 39420; index++) {
+        const string gb = {static_cast<char>(0x81 + index / 12600), static_cast<char>(0x30 + index / 1260 % 10),
+                           static_cast<char>(0x81 + index / 10 % 126), static_cast<char>(0x30 + index % 10)};
+        if (!check_decoding(gb)) {
+            return false;
+        }
+    }
+    for (uint32_t cp = 0x80; cp <= 0x10FFFF; cp++) {
+        if ((cp < 0xD800 || cp > 0xDFFF) && (cp < 0x10000 || cp % 97 == 0 || cp < 0x30000)
+            && !check_encoding(utf8(cp))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static string random_utf8(mt19937 &rng) {
+    string s;
+    const auto n = rng() % 24;
+    for (size_t i = 0; i < n; i++) {
+        switch (rng() % 6) {
+        case 0:
+            s += static_cast<char>(0x20 + rng() % 0x5F);
+            break;
+        case 1:
+            s += utf8(0x4E00 + rng() % 0x5200);
+            break;
+        case 2:
+            s += utf8(0x80 + rng() % 0xD780);
+            break;
+        case 3:
+            s += utf8(0x1F300 + rng() % 0x300);
+            break;
+        default:
+            s += u8"你好，世界";
+            break;
+        }
+    }
+    return s;
+}
+
+static bool fuzz(const size_t count) {
+    mt19937 rng(1);
+    for (size_t i = 0; i < count; i++) {
+        const auto u8 = random_utf8(rng);
+        if (!check_encoding(u8)) {
+            return false;
+        }
+        const auto gb = gb18030::from_utf8(u8);
+        if (u8.find('?') == string::npos && gb.find('?') == string::npos && gb18030::to_utf8(gb) != u8) {
+            cerr << "round trip differs on \"" << u8 << "\"" << endl;
+            return false;
+        }
+
+        // truncated and corrupted sequences must neither crash nor lose the ASCII around them
+        auto broken = gb;
+        if (!broken.empty()) {
+            broken[rng() % broken.size()] = static_cast<char>(rng());
+            broken.resize(rng() % (broken.size() + 1));
+        }
+        broken = "<" + broken + ">";
+        const auto decoded = gb18030::to_utf8(broken);
+        if (decoded.front() != '<' || decoded.back() != '>' || !check_decoding(broken)) {
+            cerr << "broken input mishandled" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename F>
+static double run(const string &text, const int rounds, F &&func) {
+    size_t sink = 0;
+    const auto start = chrono::steady_clock::now();
+    for (auto i = 0; i < rounds; i++) {
+        sink += func(text);
+    }
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (sink == 42) {
+        cout << "";
+    }
+    return text.size() * rounds / elapsed / 1024 / 1024;
+}
+
+int main(const int argc, char **argv) {
+    size_t char_count = 100;
+    auto rounds = 100000;
+    size_t fuzz_count = 100000;
+    for (auto i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--chars" && i + 1 < argc) {
+            char_count = stoul(argv[++i]);
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = stoi(argv[++i]);
+        } else if (arg == "--fuzz" && i + 1 < argc) {
+            fuzz_count = stoul(argv[++i]);
+        } else {
+            cerr << "usage: " << argv[0] << " [--chars N] [--rounds N] [--fuzz N]" << endl;
+            return 1;
+        }
+    }
+
+    if (!check_all_code_points() || !fuzz(fuzz_count)) {
+        return 1;
+    }
+
+    string message;
+    mt19937 rng(42);
+    while (message.size() < char_count * 2) {
+        message += rng() % 4 ? utf8(0x4E00 + rng() % 0x5200) : string(1, static_cast<char>('a' + rng() % 26));
+        if (rng() % 16 == 0) {
+            message += "[CQ:face,id=14] ";
+        }
+    }
+    const auto message_gb = gb18030::from_utf8(message);
+    const string ascii(message.size(), 'a');
+
+    cout << "fuzzed: " << fuzz_count << ", message: " << message.size() << " bytes x " << rounds << " rounds" << endl;
+    cout << "                        iconv (MB/s)    table driven (MB/s)" << endl;
+    const auto print = [&](const string &name, const string &input, auto &&iconv_func, auto &&func) {
+        cout << name << static_cast<int64_t>(run(input, rounds, iconv_func)) << "              "
+             << static_cast<int64_t>(run(input, rounds, func)) << endl;
+    };
+    print("to_utf8                 ", message_gb,
+          [](const string &s) { return iconv_convert(s, "gb18030", "utf-8")->size(); },
+          [](const string &s) { return gb18030::to_utf8(s).size(); });
+    print("from_utf8               ", message,
+          [](const string &s) { return iconv_convert(s, "utf-8", "gb18030")->size(); },
+          [](const string &s) { return gb18030::from_utf8(s).size(); });
+    print("to_utf8 (ASCII)         ", ascii,
+          [](const string &s) { return iconv_convert(s, "gb18030", "utf-8")->size(); },
+          [](const string &s) { return gb18030::to_utf8(s).size(); });
+    return 0;
+}
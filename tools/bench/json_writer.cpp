@@ -0,0 +1,150 @@
+// Microbenchmark of writing the message string of a message in its JSON form, against going through
+// "cq::Message", as the post message formatter used to with "std::to_string(j.get<cq::Message>())".
+//
+// Usage: cqhttp-bench-json_writer [--messages N] [--rounds N]
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cqhttp/utils/json_writer.h"
+#include "cqsdk/message_parser.h"
+
+using namespace std;
+using cq::message::Message;
+using cq::message::MessageParser;
+using cq::message::SegmentView;
+
+// the members of Message used here, as message.cpp has them, without pulling in the CoolQ API it needs
+namespace cq::message {
+    Message::Message(const string &msg_str) {
+        MessageParser parser(msg_str);
+        SegmentView segment;
+        while (parser.next(segment)) {
+            this->push_back(segment.to_segment());
+        }
+    }
+
+    Message::operator string() const {
+        string result;
+        result.reserve(estimate_message_size(*this));
+        append_message(result, *this);
+        return result;
+    }
+
+    void Message::reduce() {
+        if (this->empty()) {
+            return;
+        }
+        auto last_seg_it = this->begin();
+        for (auto it = this->begin(); ++it != this->end();) {
+            if (it->type == "text" && last_seg_it->type == "text" && it->data.find("text") != it->data.end()
+                && last_seg_it->data.find("text") != last_seg_it->data.end()) {
+                last_seg_it->data["text"] += it->data["text"];
+                this->erase(it);
+                it = last_seg_it;
+            } else {
+                last_seg_it = it;
+            }
+        }
+        if (this->size() == 1 && this->front().type == "text" && this->front().data["text"].empty()) {
+            this->clear();
+        }
+    }
+} // namespace cq::message
+
+static vector<Message> generate_messages(const size_t count) {
+    mt19937 rng(42);
+    vector<Message> messages;
+    for (size_t i = 0; i < count; i++) {
+        string msg;
+        const auto segment_count = 1 + rng() % 6;
+        for (size_t j = 0; j < segment_count; j++) {
+            switch (rng() % 6) {
+            case 0:
+                msg += "[CQ:face,id=" + to_string(rng() % 200) + "]";
+                break;
+            case 1:
+                msg += "[CQ:at,qq=" + to_string(10000 + rng() % 1000000000) + "] ";
+                break;
+            case 2:
+                msg += "[CQ:image,file=" + to_string(rng()) + to_string(rng()) + ".jpg,url=https://gchat.qpic.cn/"
+                       + to_string(rng()) + "/0?term=2&amp;is_origin=0]";
+                break;
+            case 3:
+                msg += "\"quoted\"\\ and\ttab\nnew line \x01 control";
+                break;
+            default:
+                msg += rng() % 2 ? u8"今天天气不错，&#91;不是CQ码&#93;" : "hello, world &amp; more";
+                break;
+            }
+        }
+        messages.emplace_back(msg);
+    }
+    return messages;
+}
+
+template <typename T, typename F>
+static double measure(const vector<T> &inputs, const int rounds, F &&func) {
+    size_t sink = 0;
+    const auto start = chrono::steady_clock::now();
+    for (auto r = 0; r < rounds; r++) {
+        for (const auto &input : inputs) {
+            sink += func(input);
+        }
+    }
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (sink == 42) {
+        cout << "";
+    }
+    return elapsed;
+}
+
+int main(const int argc, char **argv) {
+    size_t message_count = 10000;
+    auto rounds = 20;
+    for (auto i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--messages" && i + 1 < argc) {
+            message_count = stoul(argv[++i]);
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = stoi(argv[++i]);
+        } else {
+            cerr << "usage: " << argv[0] << " [--messages N] [--rounds N]" << endl;
+            return 1;
+        }
+    }
+
+    const auto messages = generate_messages(message_count);
+    vector<json> arrays;
+    for (const auto &msg : messages) {
+        arrays.emplace_back(msg);
+    }
+    // plus some that are not quite well-formed, which the writer leaves to the JSON convertor
+    auto checked = arrays;
+    checked.push_back(json::array({{{"type", "face"}, {"data", {{"id", 1}}}}, {{"type", "text"}, {"data", json::object()}}}));
+    checked.push_back({{"type", "at"}, {"data", {{"qq", "all"}}}});
+    checked.push_back("[CQ:face, id=1]&#44;");
+
+    for (const auto &j : checked) {
+        string str;
+        cqhttp::utils::append_cq_string(str, j);
+        if (str != to_string(j.get<Message>())) {
+            cerr << "string differs on " << j.dump() << endl;
+            return 1;
+        }
+    }
+
+    cout << "messages: " << messages.size() << " x " << rounds << " rounds" << endl;
+    cout << "          cq::Message (s)  writer (s)" << endl;
+    cout << "string    " << measure(arrays, rounds, [](const json &j) { return to_string(j.get<Message>()).size(); })
+         << "         " << measure(arrays, rounds, [](const json &j) {
+                string out;
+                cqhttp::utils::append_cq_string(out, j);
+                return out.size();
+            })
+         << endl;
+    return 0;
+}
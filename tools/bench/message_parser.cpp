@@ -0,0 +1,283 @@
+// Microbenchmark of the CQ code parser, against the stringstream based DFA it replaced.
+//
+// Usage: cqhttp-bench-message_parser [--codes N] [--rounds N] [--fuzz N]
+//
+// The message is made of N CQ codes (images, faces, ats, shares) with escaped text between them.
+// "--fuzz" checks N random strings of CQ code fragments against the previous implementation first.
+//
+// Escaping and unescaping are measured too, on the message itself and on plain text with nothing to escape.
+
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cqsdk/message_parser.h"
+
+using namespace std;
+using cq::message::MessageParser;
+using cq::message::SegmentView;
+
+using Segments = list<pair<string, map<string, string>>>;
+
+// the previous implementation, kept for comparison
+namespace legacy {
+    string escape(string str, const bool escape_comma) {
+        boost::replace_all(str, "&", "&amp;");
+        boost::replace_all(str, "[", "&#91;");
+        boost::replace_all(str, "]", "&#93;");
+        if (escape_comma) boost::replace_all(str, ",", "&#44;");
+        return str;
+    }
+
+    string unescape(string str) {
+        boost::replace_all(str, "&#44;", ",");
+        boost::replace_all(str, "&#91;", "[");
+        boost::replace_all(str, "&#93;", "]");
+        boost::replace_all(str, "&amp;", "&");
+        return str;
+    }
+
+    Segments parse(const string &msg_str) {
+        Segments result;
+
+        const static auto TEXT = 0;
+        const static auto FUNCTION_NAME = 1;
+        const static auto PARAMS = 2;
+        auto state = TEXT;
+        const auto end = msg_str.cend();
+        stringstream text_s, function_name_s, params_s;
+        auto curr_cq_start = end;
+        for (auto it = msg_str.cbegin(); it != end; ++it) {
+            const auto curr = *it;
+            switch (state) {
+            case TEXT: {
+            text:
+                if (curr == '[' && end - 1 - it >= 5 /* [CQ:a] at least 5 chars behind */
+                    && *(it + 1) == 'C' && *(it + 2) == 'Q' && *(it + 3) == ':' && *(it + 4) != ']') {
+                    state = FUNCTION_NAME;
+                    curr_cq_start = it;
+                    it += 3;
+                } else {
+                    text_s << curr;
+                }
+                break;
+            }
+            case FUNCTION_NAME: {
+                if ((curr >= 'A' && curr <= 'Z') || (curr >= 'a' && curr <= 'z') || (curr >= '0' && curr <= '9')) {
+                    function_name_s << curr;
+                } else if (curr == ',') {
+                    state = PARAMS;
+                } else if (curr == ']') {
+                    goto params;
+                } else {
+                    text_s << string(curr_cq_start, it);
+                    curr_cq_start = end;
+                    function_name_s = stringstream();
+                    params_s = stringstream();
+                    state = TEXT;
+                    goto text;
+                }
+                break;
+            }
+            case PARAMS: {
+            params:
+                if (curr == ']') {
+                    pair<string, map<string, string>> seg;
+                    seg.first = function_name_s.str();
+
+                    vector<string> params;
+                    boost::split(params, params_s.str(), boost::is_any_of(","));
+                    for (const auto &param : params) {
+                        const auto idx = param.find_first_of('=');
+                        if (idx != string::npos) {
+                            seg.second[boost::trim_copy(param.substr(0, idx))] = unescape(param.substr(idx + 1));
+                        }
+                    }
+
+                    if (!text_s.str().empty()) {
+                        result.push_back({"text", {{"text", unescape(text_s.str())}}});
+                        text_s = stringstream();
+                    }
+
+                    result.push_back(seg);
+                    curr_cq_start = end;
+                    text_s = stringstream();
+                    function_name_s = stringstream();
+                    params_s = stringstream();
+                    state = TEXT;
+                } else {
+                    params_s << curr;
+                }
+            }
+            default:
+                break;
+            }
+        }
+
+        switch (state) {
+        case FUNCTION_NAME:
+        case PARAMS:
+            text_s << string(curr_cq_start, end);
+        case TEXT:
+            if (!text_s.str().empty()) {
+                result.push_back({"text", {{"text", unescape(text_s.str())}}});
+            }
+        default:
+            break;
+        }
+        return result;
+    }
+} // namespace legacy
+
+static Segments parse(const string &msg) {
+    Segments result;
+    MessageParser parser(msg);
+    SegmentView segment;
+    while (parser.next(segment)) {
+        auto seg = segment.to_segment();
+        result.emplace_back(move(seg.type), move(seg.data));
+    }
+    return result;
+}
+
+static string escape(const string &str, const bool escape_comma) {
+    if (!cq::message::needs_escaping(str, escape_comma)) {
+        return str;
+    }
+    string result;
+    cq::message::append_escaped(result, str, escape_comma);
+    return result;
+}
+
+static string unescape(const string &str) {
+    string result;
+    cq::message::append_unescaped(result, str);
+    return result;
+}
+
+static string generate_message(const size_t code_count) {
+    mt19937 rng(42);
+    string msg;
+    for (size_t i = 0; i < code_count; i++) {
+        msg += u8"这是一段普通的文本 &#91;不是CQ码&#93; with some ascii, and &amp; escapes ";
+        switch (rng() % 4) {
+        case 0:
+            msg += "[CQ:image,file=" + to_string(rng()) + ".jpg,url=https://gchat.qpic.cn/gchatpic_new/"
+                   + to_string(rng()) + "/0?term=2&amp;is_origin=0]";
+            break;
+        case 1:
+            msg += "[CQ:face,id=" + to_string(rng() % 200) + "]";
+            break;
+        case 2:
+            msg += "[CQ:at,qq=" + to_string(rng()) + "]";
+            break;
+        default:
+            msg += "[CQ:share,url=https://example.com/?a=1&#44;2,title=" + string(u8"标题") + ",content=xxx,image=]";
+            break;
+        }
+    }
+    return msg;
+}
+
+static string random_string(mt19937 &rng) {
+    static const vector<string> pieces = {
+        "[", "]", "[CQ:", "CQ:", "CQ", ",", "=", " ", "\t", "&", "&amp;", "&#44;", "&#91;", "&#93;", "&#9",
+        "a", "Z", "9", "_", "face", "id", "text", u8"中", "[CQ:at,qq=1]", "[CQ:]", "[CQ:,a=b]", "[CQ:a",
+    };
+    string s;
+    const auto n = rng() % 16;
+    for (size_t i = 0; i < n; i++) {
+        s += pieces[rng() % pieces.size()];
+    }
+    return s;
+}
+
+template <typename F>
+static double run(const string &msg, const int rounds, F &&func) {
+    size_t sink = 0;
+    const auto start = chrono::steady_clock::now();
+    for (auto i = 0; i < rounds; i++) {
+        sink += func(msg);
+    }
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (sink == 42) {
+        cout << "";
+    }
+    return msg.size() * rounds / elapsed / 1024 / 1024;
+}
+
+int main(const int argc, char **argv) {
+    size_t code_count = 1000;
+    auto rounds = 200;
+    size_t fuzz_count = 100000;
+    for (auto i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--codes" && i + 1 < argc) {
+            code_count = stoul(argv[++i]);
+        } else if (arg == "--rounds" && i + 1 < argc) {
+            rounds = stoi(argv[++i]);
+        } else if (arg == "--fuzz" && i + 1 < argc) {
+            fuzz_count = stoul(argv[++i]);
+        } else {
+            cerr << "usage: " << argv[0] << " [--codes N] [--rounds N] [--fuzz N]" << endl;
+            return 1;
+        }
+    }
+
+    mt19937 rng(1);
+    for (size_t i = 0; i < fuzz_count; i++) {
+        const auto s = random_string(rng);
+        if (legacy::parse(s) != parse(s) || legacy::escape(s, true) != escape(s, true)
+            || legacy::escape(s, false) != escape(s, false) || legacy::unescape(s) != unescape(s)) {
+            cerr << "results differ on \"" << s << "\"" << endl;
+            return 1;
+        }
+    }
+
+    const auto msg = generate_message(code_count);
+    if (legacy::parse(msg) != parse(msg)) {
+        cerr << "results differ on the generated message" << endl;
+        return 1;
+    }
+
+    const auto legacy_rate = run(msg, rounds, [](const string &m) { return legacy::parse(m).size(); });
+    const auto owned_rate = run(msg, rounds, [](const string &m) { return parse(m).size(); });
+    const auto view_rate = run(msg, rounds, [](const string &m) {
+        // e.g. looking for images without making any segment
+        size_t count = 0;
+        MessageParser parser(m);
+        SegmentView segment;
+        while (parser.next(segment)) {
+            count += segment.cq_code && segment.type == "image" && segment.raw_param("file").has_value();
+        }
+        return count;
+    });
+
+    cout << "fuzzed: " << fuzz_count << ", message: " << msg.size() << " bytes, " << code_count << " CQ codes x "
+         << rounds << " rounds" << endl;
+    cout << "legacy (MB/s)    owned segments (MB/s)    views (MB/s)" << endl;
+    cout << static_cast<int64_t>(legacy_rate) << "               " << static_cast<int64_t>(owned_rate)
+         << "                      " << static_cast<int64_t>(view_rate) << endl;
+
+    string plain_text;
+    while (plain_text.size() < msg.size()) {
+        plain_text += u8"一段不需要转义的普通文本 plain text without anything special. ";
+    }
+    cout << "                        legacy (MB/s)    single pass (MB/s)" << endl;
+    const auto print = [&](const string &name, const string &input, auto &&legacy_func, auto &&func) {
+        cout << name << static_cast<int64_t>(run(input, rounds, [&](const string &m) { return legacy_func(m).size(); }))
+             << "              " << static_cast<int64_t>(run(input, rounds, [&](const string &m) { return func(m).size(); }))
+             << endl;
+    };
+    print("escape                  ", msg, [](const string &m) { return legacy::escape(m, true); },
+          [](const string &m) { return escape(m, true); });
+    print("escape (plain text)     ", plain_text, [](const string &m) { return legacy::escape(m, true); },
+          [](const string &m) { return escape(m, true); });
+    print("unescape                ", msg, legacy::unescape, unescape);
+    return 0;
+}
@@ -0,0 +1,254 @@
+// Differential check of MultiRegex against std::regex, which the event filter falls back to,
+// so both must agree on every regex the NFA accepts. The texts mix ASCII, UTF-8 and invalid bytes.
+// Then a microbenchmark of searching all regexes at once, against calling std::regex_search for each.
+//
+// Usage: cqhttp-bench-regex [--cases N] [--seed N] [--rounds N]
+//
+// Exit with 1 if they disagree on any case.
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "cqhttp/plugins/event_filter/regex.h"
+
+using namespace std;
+using cqhttp::plugins::MultiRegex;
+
+struct Case {
+    string pattern;
+    string text;
+};
+
+// regexes whose meaning differs between bytes and code points, all of which must follow std::regex
+static const vector<Case> FIXED_CASES = {
+    {"^.{2}$", u8"你好"},
+    {"^.{6}$", u8"你好"},
+    {"^[^a]$", u8"你"},
+    {"^[^a]{3}$", u8"你"},
+    {"^\\W$", u8"你"},
+    {"^\\W+$", u8"你"},
+    {"^\\S+$", u8"你　好"},
+    {"^\\s$", u8"　"},
+    {"\\b", u8"你好"},
+    {"\\B", u8"你好"},
+    {"a\\b", u8"a你"},
+    {"\\bx", u8"é x"},
+    {"你+", u8"你你"},
+    {"^你+$", u8"你\xA0"},
+    {"[你好]", u8"好"},
+    {"^[你好]$", u8"好"},
+    {"(?:你好){2}", u8"你好你好"},
+    {"a|你", u8"你"},
+    {".好", u8"你好"},
+    {"^.$", "\xFF"},
+    {"^..$", "\xE4\xBD"},
+    {"[\\x80-\\xFF]+", u8"中文"},
+    {"^[\\x00-\\x7F]+$", u8"abc中"},
+    {"\\xE4", u8"你"},
+    {"\\u0041", "A"},
+    {".", "\n"},
+    {".", "\r"},
+    {".", u8" "},
+    {"^\\d+$", u8"１２３"},
+    {"\\w", u8"é"},
+};
+
+// pieces that random regexes are made of
+static const vector<string> ATOMS = {
+    "a", "b", "x", " ", u8"你", u8"好", u8"é", u8"　", ".", "\\w", "\\W", "\\s", "\\S", "\\d", "\\D",
+    "[ab]", "[^a]", u8"[你好]", u8"[^你]", "[\\x80-\\xBF]", "[\\w\\s]", "[^\\W]", "\\x41", "\\xE4", "\\.",
+};
+static const vector<string> ASSERTIONS = {"^", "$", "\\b", "\\B"};
+static const vector<string> QUANTIFIERS = {"", "", "", "*", "+", "?", "{2}", "{1,3}", "{0,}", "*?"};
+static const vector<string> TEXT_PIECES = {
+    "a", "b", "x", " ", "\n", "_", "1", u8"你", u8"好", u8"é", u8"　", u8" ", "\xFF", "\x80", "\xE4\xBD",
+};
+
+class Generator {
+public:
+    explicit Generator(const unsigned seed) : rng_(seed) {}
+
+    string pattern(const int depth = 0) {
+        string result;
+        const auto n = uniform(1, 4);
+        for (auto i = 0; i < n; i++) {
+            const auto kind = uniform(0, 9);
+            if (kind == 0) {
+                result += pick(ASSERTIONS);
+            } else if (kind == 1 && depth < 2) {
+                result += "(?:" + pattern(depth + 1) + "|" + pattern(depth + 1) + ")" + pick(QUANTIFIERS);
+            } else {
+                result += pick(ATOMS) + pick(QUANTIFIERS);
+            }
+        }
+        return result;
+    }
+
+    string text() {
+        string result;
+        const auto n = uniform(0, 8);
+        for (auto i = 0; i < n; i++) {
+            result += pick(TEXT_PIECES);
+        }
+        return result;
+    }
+
+private:
+    mt19937 rng_;
+
+    int uniform(const int lo, const int hi) { return uniform_int_distribution<int>(lo, hi)(rng_); }
+
+    const string &pick(const vector<string> &v) { return v[uniform(0, static_cast<int>(v.size()) - 1)]; }
+};
+
+static string escape(const string &s) {
+    static const char HEX[] = "0123456789ABCDEF";
+    string result;
+    for (const auto c : s) {
+        const auto b = static_cast<uint8_t>(c);
+        if (b >= 0x20 && b < 0x7F) {
+            result += c;
+        } else {
+            result += "\\x";
+            result += HEX[b >> 4];
+            result += HEX[b & 0xF];
+        }
+    }
+    return result;
+}
+
+struct Compiled {
+    string pattern;
+    regex std_regex;
+};
+
+// regexes that both std::regex and MultiRegex accept, added to "multi" in the same order
+static vector<Compiled> compile_all(const vector<string> &patterns, MultiRegex &multi, size_t &unsupported) {
+    vector<Compiled> compiled;
+    for (const auto &pattern : patterns) {
+        regex std_regex;
+        try {
+            std_regex = regex(pattern);
+        } catch (regex_error &) {
+            continue;
+        }
+        try {
+            multi.add(pattern);
+        } catch (MultiRegex::Unsupported &) {
+            unsupported++;
+            continue;
+        }
+        compiled.push_back({pattern, move(std_regex)});
+    }
+    return compiled;
+}
+
+static vector<bool> search_multi(const MultiRegex &multi, const string &text) {
+    vector<bool> matched(multi.size(), false);
+    multi.search(text, [&](const size_t id) {
+        matched[id] = true;
+        return true;
+    });
+    return matched;
+}
+
+int main(const int argc, char **argv) {
+    size_t n_cases = 20000;
+    unsigned seed = 42;
+    size_t rounds = 200;
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const string arg = argv[i];
+        if (arg == "--cases") {
+            n_cases = stoul(argv[i + 1]);
+        } else if (arg == "--seed") {
+            seed = static_cast<unsigned>(stoul(argv[i + 1]));
+        } else if (arg == "--rounds") {
+            rounds = stoul(argv[i + 1]);
+        }
+    }
+
+    size_t checked = 0, mismatches = 0, unsupported = 0;
+    const auto check = [&](const string &pattern, const regex &std_regex, const bool multi_matched,
+                           const string &text) {
+        checked++;
+        const auto std_matched = regex_search(text, std_regex);
+        if (std_matched != multi_matched) {
+            if (++mismatches <= 20) {
+                cerr << "mismatch: /" << escape(pattern) << "/ on \"" << escape(text) << "\": std::regex "
+                     << std_matched << ", MultiRegex " << multi_matched << endl;
+            }
+        }
+    };
+
+    // each fixed case alone
+    for (const auto &c : FIXED_CASES) {
+        MultiRegex multi;
+        const auto compiled = compile_all({c.pattern}, multi, unsupported);
+        if (compiled.empty()) {
+            cerr << "not accepted by MultiRegex: /" << escape(c.pattern) << "/" << endl;
+            mismatches++;
+            continue;
+        }
+        check(c.pattern, compiled.front().std_regex, search_multi(multi, c.text).front(), c.text);
+    }
+
+    // random regexes in sets of 16, searched at once like the text rules of a field
+    Generator gen(seed);
+    for (size_t done = 0; done < n_cases;) {
+        vector<string> patterns;
+        for (auto i = 0; i < 16; i++) {
+            patterns.push_back(gen.pattern());
+        }
+        MultiRegex multi;
+        const auto compiled = compile_all(patterns, multi, unsupported);
+        for (auto t = 0; t < 8; t++) {
+            const auto text = gen.text();
+            const auto matched = search_multi(multi, text);
+            for (size_t id = 0; id < compiled.size(); id++) {
+                check(compiled[id].pattern, compiled[id].std_regex, matched[id], text);
+            }
+            done += compiled.size();
+        }
+    }
+
+    cout << "checked:     " << checked << " (regex, text) pairs, " << unsupported << " regexes left to std::regex"
+         << endl;
+    cout << "mismatches:  " << mismatches << endl;
+
+    // the moderation rules of a group, on a chat message
+    const vector<string> patterns = {
+        u8"加.{0,4}群", u8"(?:免费|低价)领取", u8"[0-9]{5,}", "https?://\\S+", u8"代[练刷]", u8"^\\s*广告",
+        u8"私聊.*有惊喜", "\\b(?:vx|wx)\\b", u8"兼职.{0,10}日结", u8"点击.{0,6}链接",
+    };
+    const string text = u8"[CQ:at,qq=10000] 你好，这是一条测试消息，明天下午三点在会议室开会，请大家准时参加。";
+    MultiRegex multi;
+    const auto compiled = compile_all(patterns, multi, unsupported);
+
+    size_t sink = 0;
+    const auto start = chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (const auto &c : compiled) {
+            sink += regex_search(text, c.std_regex);
+        }
+    }
+    const auto std_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / rounds;
+
+    const auto multi_start = chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        multi.search(text, [&](size_t) {
+            sink++;
+            return true;
+        });
+    }
+    const auto multi_ns = chrono::duration<double, nano>(chrono::steady_clock::now() - multi_start).count() / rounds;
+
+    cout << "std::regex:  " << std_ns / 1000 << " us per message (" << compiled.size() << " regexes)" << endl;
+    cout << "MultiRegex:  " << multi_ns / 1000 << " us per message" << endl;
+    cout << "(sink " << sink << ")" << endl;
+
+    return mismatches > 0 ? 1 : 0;
+}
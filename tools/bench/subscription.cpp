@@ -0,0 +1,304 @@
+// Checks of the event subscriptions of WebSocket clients: parsing, matching, replacing, unsubscribing
+// and empty filters. The recipients found by SubscriptionIndex must be those found by checking every
+// subscription one by one. Then a microbenchmark of finding the recipients among many subscribers.
+//
+// Usage: cqhttp-bench-subscription [--subscribers N] [--events N] [--seed N]
+//
+// Exit with 1 if any check fails.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "cqhttp/plugins/web/subscription.h"
+
+using namespace std;
+using namespace cqhttp;
+using namespace cqhttp::plugins;
+using PostType = EventPayload::PostType;
+
+static size_t failures = 0;
+
+static void expect(const bool ok, const string &what) {
+    if (!ok && ++failures <= 20) {
+        cerr << "failed: " << what << endl;
+    }
+}
+
+struct TestEvent {
+    PostType post_type;
+    cq::message::Type message_type;
+    optional<int64_t> group_id;
+    string raw_message;
+
+    unique_ptr<EventPayload> payload() const {
+        json data = {{"raw_message", raw_message}};
+        switch (post_type) {
+        case PostType::MESSAGE:
+            if (message_type == cq::message::GROUP) {
+                cq::GroupMessageEvent e;
+                e.group_id = *group_id;
+                e.raw_message = raw_message;
+                return make_unique<EventPayload>(e, move(data));
+            } else {
+                cq::PrivateMessageEvent e;
+                e.raw_message = raw_message;
+                return make_unique<EventPayload>(e, move(data));
+            }
+        case PostType::NOTICE: {
+            cq::GroupUploadEvent e;
+            e.group_id = *group_id;
+            return make_unique<EventPayload>(e, move(data));
+        }
+        case PostType::REQUEST: {
+            cq::FriendRequestEvent e;
+            return make_unique<EventPayload>(e, move(data));
+        }
+        default: {
+            HeartbeatMetaEvent e;
+            return make_unique<EventPayload>(e, move(data));
+        }
+        }
+    }
+};
+
+// what a subscription means, as documented, checked without any index
+static bool wants(const Subscription &s, const TestEvent &event) {
+    const auto has = [](const auto &v, const auto x) { return find(v.cbegin(), v.cend(), x) != v.cend(); };
+    if (!s.post_types.empty() && !has(s.post_types, event.post_type)) {
+        return false;
+    }
+    if (!s.group_ids.empty() && event.post_type != PostType::META_EVENT
+        && !(event.group_id && has(s.group_ids, *event.group_id))) {
+        return false;
+    }
+    if (!s.message_types.empty() && event.post_type == PostType::MESSAGE && !has(s.message_types, event.message_type)) {
+        return false;
+    }
+    return !s.filter || event.raw_message.find("hello") != string::npos;
+}
+
+static vector<int> recipients(const SubscriptionIndex<int> &index, const TestEvent &event) {
+    auto result = index.recipients(*event.payload());
+    sort(result.begin(), result.end());
+    return result;
+}
+
+static vector<int> expected_recipients(const map<int, Subscription> &subscriptions, const TestEvent &event) {
+    vector<int> result;
+    for (const auto &[subscriber, subscription] : subscriptions) {
+        if (wants(subscription, event)) {
+            result.push_back(subscriber);
+        }
+    }
+    return result;
+}
+
+class Generator {
+public:
+    explicit Generator(const unsigned seed) : rng_(seed) {}
+
+    json spec() {
+        json spec = json::object();
+        static const vector<string> post_types = {"message", "notice", "request", "meta_event"};
+        static const vector<string> message_types = {"private", "group", "discuss"};
+        if (chance(0.5)) {
+            spec["post_types"] = subset(post_types);
+        }
+        if (chance(0.3)) {
+            spec["message_types"] = subset(message_types);
+        }
+        if (chance(0.5)) {
+            json group_ids = json::array();
+            for (auto i = uniform(1, 3); i > 0; i--) {
+                group_ids.push_back(uniform(1, 20));
+            }
+            spec["group_ids"] = group_ids;
+        }
+        if (chance(0.2)) {
+            spec["filter"] = {{"raw_message", {{".contains", "hello"}}}};
+        }
+        return spec;
+    }
+
+    TestEvent event() {
+        TestEvent event;
+        event.post_type = static_cast<PostType>(uniform(1, 4));
+        event.message_type = chance(0.5) ? cq::message::GROUP : cq::message::PRIVATE;
+        if (event.post_type == PostType::NOTICE
+            || (event.post_type == PostType::MESSAGE && event.message_type == cq::message::GROUP)) {
+            event.group_id = uniform(1, 20);
+        }
+        event.raw_message = chance(0.3) ? "hello, world" : "bye";
+        return event;
+    }
+
+private:
+    mt19937 rng_;
+
+    int uniform(const int lo, const int hi) { return uniform_int_distribution<int>(lo, hi)(rng_); }
+
+    bool chance(const double p) { return bernoulli_distribution(p)(rng_); }
+
+    json subset(const vector<string> &names) {
+        json result = json::array();
+        for (const auto &name : names) {
+            if (chance(0.5)) {
+                result.push_back(name);
+            }
+        }
+        if (result.empty()) {
+            result.push_back(names[uniform(0, static_cast<int>(names.size()) - 1)]);
+        }
+        return result;
+    }
+};
+
+static void check_parse() {
+    const auto from_json = Subscription::parse(
+        {{"post_types", {"message", "notice", "message"}}, {"group_ids", {123, 456}}, {"message_types", {"group"}}});
+    const auto from_query = Subscription::parse(
+        {{"post_types", "message, notice"}, {"group_ids", "456,123"}, {"message_types", "group"}});
+    expect(from_json.post_types == from_query.post_types, "post types given in JSON and in the query string");
+    expect(from_json.group_ids == from_query.group_ids, "group ids given in JSON and in the query string");
+    expect(from_json.post_types.size() == 2, "duplicate post types are merged");
+
+    for (const auto &invalid : vector<json>{
+             json::array(),
+             {{"post_types", {"messages"}}},
+             {{"post_types", 1}},
+             {{"message_types", "private,channel"}},
+             {{"group_ids", "12a"}},
+             {{"group_ids", {1.5}}},
+             {{"filter", "{not json"}},
+             {{"filter", "[]"}},
+             {{"filter", {{".nonexistent", 1}}}},
+         }) {
+        auto thrown = false;
+        try {
+            Subscription::parse(invalid);
+        } catch (invalid_argument &) {
+            thrown = true;
+        }
+        expect(thrown, "invalid subscription " + invalid.dump() + " is rejected");
+    }
+}
+
+static void check_empty() {
+    // no restriction at all, in all the ways it can be written
+    for (const auto &spec : vector<json>{
+             json::object(),
+             {{"post_types", json::array()}, {"group_ids", ""}},
+             {{"filter", nullptr}},
+             {{"filter", json::object()}},
+             {{"filter", "{}"}},
+         }) {
+        SubscriptionIndex<int> index;
+        index.subscribe(1, Subscription::parse(spec));
+        Generator gen(1);
+        for (auto i = 0; i < 100; i++) {
+            const auto event = gen.event();
+            expect(recipients(index, event) == vector<int>{1}, "subscription " + spec.dump() + " wants every event");
+        }
+    }
+
+    SubscriptionIndex<int> index;
+    expect(index.recipients(*TestEvent{PostType::NOTICE, cq::message::PRIVATE, 1, ""}.payload()).empty(),
+           "an empty index has no recipients");
+}
+
+static void check_matching(const size_t n_subscribers, const size_t n_events, const unsigned seed) {
+    Generator gen(seed);
+    SubscriptionIndex<int> index;
+    map<int, Subscription> subscriptions;
+    const auto subscribe = [&](const int subscriber) {
+        const auto spec = gen.spec();
+        index.subscribe(subscriber, Subscription::parse(spec));
+        subscriptions[subscriber] = Subscription::parse(spec);
+    };
+    const auto check_events = [&](const string &stage) {
+        for (size_t i = 0; i < n_events; i++) {
+            const auto event = gen.event();
+            expect(recipients(index, event) == expected_recipients(subscriptions, event),
+                   "recipients of an event " + stage);
+        }
+        expect(index.size() == subscriptions.size(), "number of subscribers " + stage);
+    };
+
+    for (size_t i = 0; i < n_subscribers; i++) {
+        subscribe(static_cast<int>(i));
+    }
+    check_events("after subscribing");
+
+    // replacing the subscription of a subscriber must drop the old one entirely
+    for (size_t i = 0; i < n_subscribers; i += 3) {
+        subscribe(static_cast<int>(i));
+    }
+    check_events("after replacing");
+
+    for (size_t i = 0; i < n_subscribers; i += 2) {
+        index.unsubscribe(static_cast<int>(i));
+        subscriptions.erase(static_cast<int>(i));
+    }
+    index.unsubscribe(-1); // never subscribed
+    check_events("after unsubscribing");
+
+    index.clear();
+    subscriptions.clear();
+    check_events("after clearing");
+}
+
+int main(const int argc, char **argv) {
+    size_t n_subscribers = 200, n_events = 2000;
+    unsigned seed = 42;
+    for (auto i = 1; i + 1 < argc; i += 2) {
+        const string arg = argv[i];
+        if (arg == "--subscribers") {
+            n_subscribers = stoul(argv[i + 1]);
+        } else if (arg == "--events") {
+            n_events = stoul(argv[i + 1]);
+        } else if (arg == "--seed") {
+            seed = static_cast<unsigned>(stoul(argv[i + 1]));
+        }
+    }
+
+    check_parse();
+    check_empty();
+    check_matching(n_subscribers, n_events, seed);
+    cout << "failures:    " << failures << endl;
+
+    // clients each watching a few of many groups, as a bot dashboard would
+    SubscriptionIndex<int> index;
+    map<int, Subscription> subscriptions;
+    for (auto i = 0; i < 1000; i++) {
+        json spec = {{"post_types", {"message"}}, {"group_ids", {i % 500 + 1, (i * 7) % 500 + 1}}};
+        index.subscribe(i, Subscription::parse(spec));
+        subscriptions[i] = Subscription::parse(spec);
+    }
+    vector<TestEvent> events;
+    for (auto i = 0; i < 1000; i++) {
+        events.push_back({PostType::MESSAGE, cq::message::GROUP, i % 500 + 1, "hello"});
+    }
+
+    size_t sink = 0;
+    const auto start = chrono::steady_clock::now();
+    for (const auto &event : events) {
+        sink += index.recipients(*event.payload()).size();
+    }
+    const auto index_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    const auto scan_start = chrono::steady_clock::now();
+    for (const auto &event : events) {
+        const auto payload = event.payload();
+        for (const auto &[subscriber, subscription] : subscriptions) {
+            sink += wants(subscription, event) && subscription.accepts(*payload);
+        }
+    }
+    const auto scan_us = chrono::duration<double, micro>(chrono::steady_clock::now() - scan_start).count();
+
+    cout << "index:       " << index_us / events.size() << " us per event (1000 subscribers)" << endl;
+    cout << "scan:        " << scan_us / events.size() << " us per event" << endl;
+    cout << "(sink " << sink << ")" << endl;
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+// An in-memory implementation of the "CQ_*" functions that CoolQ exports from CQP.dll.
+// Signatures mirror src/cqsdk/api_funcs.h, and cq::api::__init() looks them up from the host executable.
+
+#include "./coolq.h"
+
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "cqsdk/utils/base64.h"
+#include "cqsdk/utils/string.h"
+
+using namespace std;
+using cq::utils::string_from_coolq;
+using cq::utils::string_to_coolq;
+
+namespace mock_host::coolq {
+    string app_directory;
+    bool print_logs = false;
+    Counters counters;
+
+    /**
+     * Write data the way BinPack reads it (big-endian integers, length-prefixed GB18030 strings).
+     */
+    class BinPackWriter {
+    public:
+        template <typename IntType>
+        BinPackWriter &int_(const IntType i) {
+            for (auto shift = static_cast<int>(sizeof(IntType) - 1) * 8; shift >= 0; shift -= 8) {
+                bytes_.push_back(static_cast<char>((static_cast<uint64_t>(i) >> shift) & 0xFF));
+            }
+            return *this;
+        }
+
+        BinPackWriter &string_(const string &s) { return token(string_to_coolq(s)); }
+
+        BinPackWriter &token(const string &t) {
+            int_(static_cast<int16_t>(t.size()));
+            bytes_ += t;
+            return *this;
+        }
+
+        BinPackWriter &bool_(const bool b) { return int_(static_cast<int32_t>(b)); }
+
+        const string &bytes() const { return bytes_; }
+
+    private:
+        string bytes_;
+    };
+
+    /**
+     * CoolQ keeps ownership of the returned strings, here they live until the next call on the same thread.
+     */
+    static const char *hold(string s) {
+        thread_local string buffer;
+        buffer = move(s);
+        return buffer.c_str();
+    }
+
+    static const char *hold_base64(const string &bytes) {
+        return hold(cq::utils::base64::encode(reinterpret_cast<const unsigned char *>(bytes.data()),
+                                              static_cast<unsigned int>(bytes.size())));
+    }
+
+    static string stranger_bytes(const int64_t qq) {
+        return BinPackWriter()
+            .int_<int64_t>(qq)
+            .string_(u8"用户" + to_string(qq))
+            .int_<int32_t>(static_cast<int32_t>(qq % 2))
+            .int_<int32_t>(18 + static_cast<int32_t>(qq % 30))
+            .bytes();
+    }
+
+    static string group_member_bytes(const int64_t group_id, const int64_t qq) {
+        return BinPackWriter()
+            .int_<int64_t>(group_id)
+            .int_<int64_t>(qq)
+            .string_(u8"用户" + to_string(qq))
+            .string_(u8"群名片" + to_string(qq))
+            .int_<int32_t>(static_cast<int32_t>(qq % 2))
+            .int_<int32_t>(18 + static_cast<int32_t>(qq % 30))
+            .string_(u8"地球")
+            .int_<int32_t>(1500000000)
+            .int_<int32_t>(1550000000)
+            .string_(u8"活跃")
+            .int_<int32_t>(qq == LOGIN_USER_ID ? 3 : 1)
+            .bool_(false)
+            .string_("")
+            .int_<int32_t>(-1)
+            .bool_(true)
+            .bytes();
+    }
+
+    static string group_bytes(const int64_t group_id, const bool with_count) {
+        BinPackWriter w;
+        w.int_<int64_t>(group_id).string_(u8"群" + to_string(group_id));
+        if (with_count) {
+            w.int_<int32_t>(100).int_<int32_t>(200);
+        }
+        return w.bytes();
+    }
+
+    static string list_bytes(const vector<string> &items) {
+        BinPackWriter w;
+        w.int_<int32_t>(static_cast<int32_t>(items.size()));
+        for (const auto &item : items) {
+            w.token(item);
+        }
+        return w.bytes();
+    }
+} // namespace mock_host::coolq
+
+using namespace mock_host::coolq;
+
+#define MOCK_API extern "C" __attribute__((visibility("default")))
+
+// Message
+
+MOCK_API int32_t CQ_sendPrivateMsg(int32_t, int64_t, const char *) {
+    return static_cast<int32_t>(++counters.sent_private_msg);
+}
+
+MOCK_API int32_t CQ_sendGroupMsg(int32_t, int64_t, const char *) {
+    return static_cast<int32_t>(++counters.sent_group_msg);
+}
+
+MOCK_API int32_t CQ_sendDiscussMsg(int32_t, int64_t, const char *) {
+    return static_cast<int32_t>(++counters.sent_discuss_msg);
+}
+
+MOCK_API int32_t CQ_deleteMsg(int32_t, int64_t) { return 0; }
+
+// Send Like
+
+MOCK_API int32_t CQ_sendLike(int32_t, int64_t) { return 0; }
+MOCK_API int32_t CQ_sendLikeV2(int32_t, int64_t, int32_t) { return 0; }
+
+// Group & Discuss Operation
+
+MOCK_API int32_t CQ_setGroupKick(int32_t, int64_t, int64_t, int32_t) { return 0; }
+MOCK_API int32_t CQ_setGroupBan(int32_t, int64_t, int64_t, int64_t) { return 0; }
+MOCK_API int32_t CQ_setGroupAnonymousBan(int32_t, int64_t, const char *, int64_t) { return 0; }
+MOCK_API int32_t CQ_setGroupWholeBan(int32_t, int64_t, int32_t) { return 0; }
+MOCK_API int32_t CQ_setGroupAdmin(int32_t, int64_t, int64_t, int32_t) { return 0; }
+MOCK_API int32_t CQ_setGroupAnonymous(int32_t, int64_t, int32_t) { return 0; }
+MOCK_API int32_t CQ_setGroupCard(int32_t, int64_t, int64_t, const char *) { return 0; }
+MOCK_API int32_t CQ_setGroupLeave(int32_t, int64_t, int32_t) { return 0; }
+MOCK_API int32_t CQ_setGroupSpecialTitle(int32_t, int64_t, int64_t, const char *, int64_t) { return 0; }
+MOCK_API int32_t CQ_setDiscussLeave(int32_t, int64_t) { return 0; }
+
+// Request Operation
+
+MOCK_API int32_t CQ_setFriendAddRequest(int32_t, const char *, int32_t, const char *) { return 0; }
+MOCK_API int32_t CQ_setGroupAddRequest(int32_t, const char *, int32_t, int32_t) { return 0; }
+MOCK_API int32_t CQ_setGroupAddRequestV2(int32_t, const char *, int32_t, int32_t, const char *) { return 0; }
+
+// Get QQ Information
+
+MOCK_API int64_t CQ_getLoginQQ(int32_t) { return LOGIN_USER_ID; }
+
+MOCK_API const char *CQ_getLoginNick(int32_t) { return hold(string_to_coolq(LOGIN_NICKNAME)); }
+
+MOCK_API const char *CQ_getStrangerInfo(int32_t, int64_t qq, int32_t) {
+    ++counters.info_queries;
+    return hold_base64(stranger_bytes(qq));
+}
+
+MOCK_API const char *CQ_getFriendList(int32_t, int32_t) {
+    ++counters.info_queries;
+    vector<string> friends;
+    for (int64_t qq = 20000; qq < 20010; qq++) {
+        friends.push_back(BinPackWriter().int_<int64_t>(qq).string_(u8"好友" + to_string(qq)).string_("").bytes());
+    }
+    return hold_base64(list_bytes(friends));
+}
+
+MOCK_API const char *CQ_getGroupList(int32_t) {
+    ++counters.info_queries;
+    vector<string> groups;
+    for (int64_t group_id = 30000; group_id < 30010; group_id++) {
+        groups.push_back(group_bytes(group_id, false));
+    }
+    return hold_base64(list_bytes(groups));
+}
+
+MOCK_API const char *CQ_getGroupInfo(int32_t, int64_t group_id, int32_t) {
+    ++counters.info_queries;
+    return hold_base64(group_bytes(group_id, true));
+}
+
+MOCK_API const char *CQ_getGroupMemberList(int32_t, int64_t group_id) {
+    ++counters.info_queries;
+    vector<string> members;
+    for (int64_t qq = 20000; qq < 20010; qq++) {
+        members.push_back(group_member_bytes(group_id, qq));
+    }
+    return hold_base64(list_bytes(members));
+}
+
+MOCK_API const char *CQ_getGroupMemberInfoV2(int32_t, int64_t group_id, int64_t qq, int32_t) {
+    ++counters.info_queries;
+    return hold_base64(group_member_bytes(group_id, qq));
+}
+
+// Get CoolQ Information
+
+MOCK_API const char *CQ_getCookies(int32_t) { return ""; }
+MOCK_API const char *CQ_getCookiesV2(int32_t, const char *) { return ""; }
+MOCK_API int32_t CQ_getCsrfToken(int32_t) { return 0; }
+MOCK_API const char *CQ_getAppDirectory(int32_t) { return hold(string_to_coolq(app_directory)); }
+MOCK_API const char *CQ_getRecord(int32_t, const char *file, const char *) { return hold(file); }
+MOCK_API const char *CQ_getRecordV2(int32_t, const char *file, const char *) { return hold(file); }
+MOCK_API const char *CQ_getImage(int32_t, const char *file) { return hold(file); }
+MOCK_API int CQ_canSendImage(int32_t) { return 1; }
+MOCK_API int CQ_canSendRecord(int32_t) { return 1; }
+
+MOCK_API int32_t CQ_addLog(int32_t, int32_t log_level, const char *category, const char *log_msg) {
+    ++counters.logs;
+    if (print_logs) {
+        static mutex mtx;
+        lock_guard<mutex> lock(mtx);
+        clog << "[" << log_level << "] [" << string_from_coolq(category) << "] " << string_from_coolq(log_msg)
+             << endl;
+    }
+    return 0;
+}
+
+MOCK_API int32_t CQ_setFatal(int32_t, const char *error_info) {
+    cerr << "[FATAL] " << string_from_coolq(error_info) << endl;
+    return 0;
+}
+
+MOCK_API int32_t CQ_setRestart(int32_t) { return 0; }
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace mock_host::coolq {
+    const int64_t LOGIN_USER_ID = 10000;
+    const std::string LOGIN_NICKNAME = u8"模拟酷Q";
+
+    /**
+     * Directory returned by CQ_getAppDirectory, must end with a path separator.
+     */
+    extern std::string app_directory;
+
+    /**
+     * Whether to print logs sent through CQ_addLog.
+     */
+    extern bool print_logs;
+
+    struct Counters {
+        std::atomic<int64_t> sent_private_msg{0};
+        std::atomic<int64_t> sent_group_msg{0};
+        std::atomic<int64_t> sent_discuss_msg{0};
+        std::atomic<int64_t> info_queries{0};
+        std::atomic<int64_t> logs{0};
+    };
+
+    extern Counters counters;
+} // namespace mock_host::coolq
@@ -0,0 +1,137 @@
+// A mock CoolQ host, which loads the plugin in-process and drives its exported event functions,
+// so that the event pipeline can be run, profiled and benchmarked outside CoolQ.
+//
+// Usage: cqhttp-mock-host [--events N] [--config FILE] [--app-dir DIR] [--wait SECONDS] [--verbose]
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "./coolq.h"
+#include "./plugins.h"
+#include "cqhttp/core/event_ingestion.h"
+#include "cqhttp/core/info_cache.h"
+#include "cqsdk/utils/string.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+namespace coolq = mock_host::coolq;
+
+extern "C" {
+int32_t Initialize(int32_t auth_code);
+int32_t cq_app_enable();
+int32_t cq_app_disable();
+int32_t cq_coolq_start();
+int32_t cq_coolq_exit();
+int32_t cq_event_private_msg(int32_t sub_type, int32_t msg_id, int64_t from_qq, const char *msg, int32_t font);
+int32_t cq_event_group_msg(int32_t sub_type, int32_t msg_id, int64_t from_group, int64_t from_qq,
+                           const char *from_anonymous, const char *msg, int32_t font);
+}
+
+static const auto DEFAULT_CONFIG = R"({
+    "general": {
+        "use_http": false,
+        "use_ws": false,
+        "use_ws_reverse": false,
+        "enable_heartbeat": false,
+        "show_log_console": false,
+        "log_level": "warning"
+    }
+})";
+
+struct Options {
+    int64_t events = 100000;
+    string config_file;
+    string app_dir;
+    double wait = 0; // before emitting events, e.g. for WebSocket clients to connect
+    bool verbose = false;
+};
+
+static Options parse_options(const int argc, char **argv) {
+    Options opts;
+    for (auto i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        const auto has_value = i + 1 < argc;
+        if (arg == "--events" && has_value) {
+            opts.events = stoll(argv[++i]);
+        } else if (arg == "--config" && has_value) {
+            opts.config_file = argv[++i];
+        } else if (arg == "--app-dir" && has_value) {
+            opts.app_dir = argv[++i];
+        } else if (arg == "--wait" && has_value) {
+            opts.wait = stod(argv[++i]);
+        } else if (arg == "--verbose") {
+            opts.verbose = true;
+        } else {
+            cerr << "usage: " << argv[0] << " [--events N] [--config FILE] [--app-dir DIR] [--wait SECONDS] [--verbose]" << endl;
+            exit(1);
+        }
+    }
+    return opts;
+}
+
+static void prepare_app_directory(const Options &opts) {
+    const auto app_dir = opts.app_dir.empty() ? fs::temp_directory_path() / "cqhttp-mock-host" : fs::path(opts.app_dir);
+    fs::create_directories(app_dir);
+    coolq::app_directory = app_dir.string() + "/";
+
+    const auto config_path = app_dir / "config.json";
+    if (!opts.config_file.empty()) {
+        fs::copy_file(opts.config_file, config_path, fs::copy_options::overwrite_existing);
+    } else {
+        ofstream(config_path) << DEFAULT_CONFIG;
+    }
+}
+
+int main(const int argc, char **argv) {
+    const auto opts = parse_options(argc, argv);
+    coolq::print_logs = opts.verbose;
+    prepare_app_directory(opts);
+
+    // what DllMain does when CoolQ loads the plugin
+    mock_host::use_plugins();
+
+    Initialize(1);
+    cq_coolq_start();
+    cq_app_enable();
+    this_thread::sleep_for(chrono::duration<double>(opts.wait));
+
+    const auto group_msg = cq::utils::string_to_coolq(
+        u8"[CQ:at,qq=10000] 你好，这是一条测试消息 [CQ:face,id=14][CQ:image,file=3A1F0C.jpg]");
+    const auto private_msg = cq::utils::string_to_coolq(u8"hello, world &#91;不是CQ码&#93;");
+
+    int64_t blocked = 0;
+    const auto start = chrono::steady_clock::now();
+    for (int64_t i = 0; i < opts.events; i++) {
+        const auto msg_id = static_cast<int32_t>(i);
+        if (i % 2 == 0) {
+            blocked += cq_event_group_msg(1, msg_id, 30000 + i % 10, 20000 + i % 100, "", group_msg.c_str(), 0);
+        } else {
+            blocked += cq_event_private_msg(11, msg_id, 20000 + i % 100, private_msg.c_str(), 0);
+        }
+    }
+    const auto ingested = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    // the events are handled on the worker threads, unless the event queue is turned off
+    while (cqhttp::event_ingestion::pending() > 0) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cq_app_disable();
+    cq_coolq_exit();
+
+    cout << "events:        " << opts.events << endl;
+    cout << "elapsed:       " << elapsed << " s" << endl;
+    cout << "ingested in:   " << ingested << " s" << endl;
+    cout << "throughput:    " << (elapsed > 0 ? opts.events / elapsed : 0) << " events/s" << endl;
+    cout << "blocked:       " << blocked << endl;
+    cout << "info queries:  " << coolq::counters.info_queries << endl;
+    cout << "info cache:    " << cqhttp::info_cache::stats().dump() << endl;
+    cout << "messages sent: "
+         << coolq::counters.sent_private_msg + coolq::counters.sent_group_msg + coolq::counters.sent_discuss_msg
+         << endl;
+    return 0;
+}
@@ -0,0 +1,62 @@
+// Same plugin chain as src/main.cpp, minus the plugins that only work inside CoolQ on Windows.
+
+#include "./plugins.h"
+
+#include "cqhttp/core/core.h"
+
+#include "cqhttp/plugins/config_loader/default_config_generator.h"
+#include "cqhttp/plugins/config_loader/ini_config_loader.h"
+#include "cqhttp/plugins/config_loader/json_config_loader.h"
+
+#include "cqhttp/plugins/heartbeat_generator/heartbeat_generator.h"
+#include "cqhttp/plugins/worker_pool_resizer/worker_pool_resizer.h"
+
+#include "cqhttp/plugins/event_data_patcher/event_data_patcher.h"
+#include "cqhttp/plugins/info_cache_invalidator/info_cache_invalidator.h"
+#include "cqhttp/plugins/message_enhancer/message_enhancer.h"
+
+#include "cqhttp/plugins/async_actions/async_actions.h"
+#include "cqhttp/plugins/rate_limited_actions/rate_limited_actions.h"
+#include "cqhttp/plugins/restarter/restarter.h"
+
+#include "cqhttp/plugins/backward_compatibility/backward_compatibility.h"
+#include "cqhttp/plugins/event_filter/event_filter.h"
+#include "cqhttp/plugins/post_message_formatter/post_message_formatter.h"
+#include "cqhttp/plugins/web/http.h"
+#include "cqhttp/plugins/web/websocket.h"
+#include "cqhttp/plugins/web/websocket_reverse.h"
+
+using namespace cqhttp;
+
+// Not using CQ_MAIN here: inside a single executable its static initializer may run
+// before the SDK's own globals (cq::app::__main among them) are constructed.
+void mock_host::use_plugins() {
+    init();
+
+    // load configurations
+    use(plugins::ini_config_loader);
+    use(plugins::json_config_loader);
+    use(plugins::default_config_generator);
+
+    // config global things
+    use(plugins::worker_pool_resizer);
+    use(plugins::heartbeat_generator);
+
+    // extend the Context object
+    use(plugins::info_cache_invalidator);
+    use(plugins::event_data_patcher);
+    use(plugins::message_enhancer);
+
+    // extend actions
+    use(plugins::restarter);
+    use(plugins::rate_limited_actions);
+    use(plugins::async_actions);
+
+    // handle api and event, must in order and at the end
+    use(plugins::event_filter);
+    use(plugins::backward_compatibility);
+    use(plugins::post_message_formatter);
+    use(plugins::http);
+    use(plugins::websocket);
+    use(plugins::websocket_reverse);
+}
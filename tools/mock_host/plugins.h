@@ -0,0 +1,8 @@
+#pragma once
+
+namespace mock_host {
+    /**
+     * Register the same plugins as the real app does, what CQ_MAIN would do in the DLL.
+     */
+    void use_plugins();
+} // namespace mock_host